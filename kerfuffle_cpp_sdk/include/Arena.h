@@ -0,0 +1,106 @@
+#pragma once
+
+#include "Bot.h"
+#include "LatencyHistogram.h"
+#include "Simulator.h"
+
+#include <chrono>
+#include <functional>
+#include <iosfwd>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**********************************************************************************************************************
+ * Arena plays bots against each other offline, with Simulator for the server and no networking, so changes can be
+ * compared over thousands of games instead of a few live ones. Games are like the lobby's open games: a full-size
+ * board, players starting evenly spaced, batches of Moves::MOVES_PER_TURN moves, and the game over when one player is
+ * left or time runs out (here, after Options::maxBatches batches). They run side by side, one per core.
+ *
+ * Each batch, every bot gets its view of the board and returns its moves. Like the server, the arena waits
+ * Options::turnTime for them; moves that come back later miss the batch, and too many missed batches in a row kill the
+ * player. The deadline in the bot's GameInfo is a little sooner, leaving the headroom GameClient leaves for sending.
+ * Which bots play in each game and where they start is drawn from the seed and the game's number, so every bot plays
+ * every seat about as often.
+ *
+ * In each game, players still alive at the end rank above those who died, by score, and those who died rank by how long
+ * they lasted. Every pair of players of different types counts as a game between them for the standings: a win, a loss,
+ * or a draw if they ranked the same. Elo comes from all of those at once (a Bradley-Terry fit), so it doesn't depend on
+ * the order the games finished in, with the mean rating at 0.
+ *********************************************************************************************************************/
+class Arena
+{
+public: // Types
+	typedef std::chrono::steady_clock Clock;
+	typedef std::function<Bot*()> BotFactory;
+
+	struct Options
+	{
+		int games = 100;
+		int playersPerGame = 2;                      // Drawn from the bots added; a bot can play itself if there are fewer.
+		int maxBatches = 300;                        // About a two-minute game with bots that take 400 ms a batch.
+		std::chrono::milliseconds turnTime{ 100 };   // How long each getMoves() can take.
+		int threads = 0;                             // Games played at once. 0 uses every core.
+		int width = Simulator::DEFAULT_WIDTH;
+		int height = Simulator::DEFAULT_HEIGHT;
+		int viewRadius = 0;                          // 0 uses the server's formula.
+		unsigned seed = 0;
+	};
+
+	struct Standing
+	{
+		std::string name;
+		int games;            // Seats played. A bot playing itself has two seats in the game.
+		int wins;             // Games it ranked first in, alone.
+		int deaths;
+		long long totalScore; // At the end of each game, with 0 for deaths.
+		int pairGames;        // Against other bots, counting each opponent in each game.
+		double pairPoints;    // Of those: 1 for a win, 0.5 for a draw.
+		double elo;
+		double eloError;      // Half the 95% confidence interval.
+		int lateBatches;      // Batches it missed by answering after the deadline.
+		LatencyHistogram decisions; // getMoves(), every batch.
+	};
+
+public: // Methods
+	explicit Arena(const Options& options);
+
+	// Bots play under the name they're added with. Factories are called from several threads at once.
+	void addBot(const std::string& name, const BotFactory& factory);
+
+	// Plays the games and works out the standings. If progress is given, a line goes to it every so often.
+	void run(std::ostream* progress = nullptr);
+
+	const std::vector<Standing>& getStandings() const { return m_standings; }
+	void printStandings(std::ostream& out) const;
+
+private: // Types
+	// How a player did in one game.
+	struct Seat
+	{
+		int bot;         // Index into m_bots.
+		int score;
+		bool alive;
+		int lastBatch;   // The last batch they played.
+		int lateBatches;
+	};
+
+	struct Entrant
+	{
+		std::string name;
+		BotFactory factory;
+	};
+
+private: // Methods
+	void playGame(int game, std::vector<Seat>& seats, std::vector<LatencyHistogram>& decisions) const;
+	static int compare(const Seat& a, const Seat& b);
+	void tally(const std::vector<std::vector<Seat> >& results);
+	void fitElo(const std::vector<std::vector<double> >& points, const std::vector<std::vector<int> >& games);
+
+private: // Data
+	Options m_options;
+	std::vector<Entrant> m_bots;
+	std::vector<Standing> m_standings;
+	std::mutex m_progressMutex;
+	double m_seconds;     // How long run() took.
+};
@@ -0,0 +1,145 @@
+#pragma once
+
+#include "GameInfo.h"
+
+#include <cstdint>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+/**********************************************************************************************************************
+ * BitBoard is a set of spaces on the board, one bit per space. Set operations, counting, and growing or shrinking the
+ * set by a space work on 64 spaces at a time, and on 256 or 128 at a time when built with AVX2 or SSE2 (see
+ * KERFUFFLE_NATIVE in CMakeLists.txt). There's a plain C++ version of each for other builds.
+ *
+ * Rows are padded to whole 64 bit words, with at least one unused bit at the end of each row, and there's an empty row
+ * above and below the board. That lets a whole board shift by a space at once. The unused bits are always 0.
+ *
+ * Operations between two BitBoards require them to be the same size, except that the out parameters are resized to
+ * match.
+ *********************************************************************************************************************/
+class BitBoard
+{
+public: // Methods
+	BitBoard();
+	BitBoard(int width, int height);
+
+	// Sizes the board and clears it. It only allocates when the board gets bigger.
+	void resize(int width, int height);
+	void clear();
+
+	int getWidth() const { return m_width; }
+	int getHeight() const { return m_height; }
+
+	bool isSet(int x, int y) const { return (getRow(y)[x >> 6] >> (x & 63)) & 1; }
+	bool isSet(const Position& pos) const { return isSet(pos.x, pos.y); }
+	void set(int x, int y) { getRow(y)[x >> 6] |= (uint64_t)1 << (x & 63); }
+	void set(const Position& pos) { set(pos.x, pos.y); }
+	void reset(int x, int y) { getRow(y)[x >> 6] &= ~((uint64_t)1 << (x & 63)); }
+	void reset(const Position& pos) { reset(pos.x, pos.y); }
+
+	int count() const; // The number of spaces in the set.
+	bool isEmpty() const;
+
+	BitBoard& operator|=(const BitBoard& other);
+	BitBoard& operator&=(const BitBoard& other);
+	BitBoard& operator^=(const BitBoard& other);
+	BitBoard& andNot(const BitBoard& other); // Removes the spaces in other.
+	bool intersects(const BitBoard& other) const;
+
+	// out gets these spaces plus every space next to one (not diagonally). Spaces off the board are dropped.
+	void dilate(BitBoard& out) const;
+	// out gets the spaces whose four neighbors are all in the set. Spaces on the edge of the board are never kept.
+	void erode(BitBoard& out) const;
+	// out gets the spaces outside the set that are next to it: where the set can grow.
+	void getFrontier(BitBoard& out) const;
+	// out gets the spaces in the set that are next to a space that isn't, or to the edge of the board.
+	void getBorder(BitBoard& out) const;
+	// The four above can be given this set as out, at the cost of copying it first.
+
+	// Calls f(x, y) for each space in the set, by row.
+	template<typename F>
+	void forEach(F f) const;
+
+	// The words holding row y. Bit x % 64 of word x / 64 is space x.
+	const uint64_t* getRow(int y) const { return &m_words[(y + 1) * m_wordsPerRow]; }
+	uint64_t* getRow(int y) { return &m_words[(y + 1) * m_wordsPerRow]; }
+	int getWordsPerRow() const { return m_wordsPerRow; }
+
+private: // Methods
+	const uint64_t* begin() const { return getRow(0); }
+	uint64_t* begin() { return getRow(0); }
+	int getWordCount() const { return m_height * m_wordsPerRow; }
+	void matchSize(const BitBoard& other);
+	void clearPadding();
+
+	static int findFirstBit(uint64_t word);
+
+private: // Data
+	int m_width;
+	int m_height;
+	int m_wordsPerRow;
+	uint64_t m_lastWordMask;       // The bits of the last word in each row that are on the board.
+	std::vector<uint64_t> m_words; // The rows, with an empty row before and after.
+};
+
+/**********************************************************************************************************************
+ * PlayerBitBoards holds a territory and a trail BitBoard for each player on a Board (a PartialBoard, or a WorldMap's
+ * board). Call update() with the board each turn; it reuses its BitBoards, so it doesn't allocate once they've grown to
+ * the size of the board.
+ *********************************************************************************************************************/
+class PlayerBitBoards
+{
+public: // Methods
+	void update(const Board& board);
+
+	// The spaces owned by, or holding the trail of, a player. Empty if the player isn't on the board.
+	const BitBoard& getTerritory(int playerId) const;
+	const BitBoard& getTrail(int playerId) const;
+
+	// Every player's territory, or trails, together.
+	const BitBoard& getAllTerritory() const { return m_allTerritory; }
+	const BitBoard& getAllTrails() const { return m_allTrails; }
+
+private: // Methods
+	int findSlot(int playerId) const;
+
+private: // Data
+	std::vector<int> m_playerIds;        // The board's player ID for each slot.
+	std::vector<BitBoard> m_territories; // By slot.
+	std::vector<BitBoard> m_trails;      // By slot.
+	BitBoard m_allTerritory;
+	BitBoard m_allTrails;
+	BitBoard m_empty;
+};
+
+/**********************************************************************************************************************
+ *********************************************************************************************************************/
+template<typename F>
+void BitBoard::forEach(F f) const
+{
+	for (int y = 0; y < m_height; y++)
+	{
+		const uint64_t* row = getRow(y);
+		for (int i = 0; i < m_wordsPerRow; i++)
+		{
+			for (uint64_t word = row[i]; word != 0; word &= word - 1)
+			{
+				f(i * 64 + findFirstBit(word), y);
+			}
+		}
+	}
+}
+
+inline int BitBoard::findFirstBit(uint64_t word)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward64(&index, word);
+	return (int)index;
+#else
+	return __builtin_ctzll(word);
+#endif
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "Bot.h"
+#include "GameClient.h"
+
+#include <chrono>
+#include <functional>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+//---------------------------------------------------------------------------------------------------------------------
+// BotRunner plays many bots, of any mix of Bot subclasses, in one process. Each bot has its own GameClient, but they
+// share one io_context and a few threads, so hundreds of bots don't need hundreds of threads. Bots compute their moves
+// on those same threads. It reports each bot's turn times and round trips as it goes.
+//---------------------------------------------------------------------------------------------------------------------
+class BotRunner
+{
+public: // Types
+	typedef std::function<Bot*()> BotFactory;
+
+public: // Methods
+	BotRunner(const char* host, const char* port, int threads);
+	~BotRunner();
+
+	// Adds count bots made by factory, named <type><n>.
+	void addBots(const std::string& type, int count, BotFactory factory, bool persistent);
+
+	// Plays until stop() is called, reporting every reportInterval (never if it's zero).
+	void run(std::chrono::seconds reportInterval);
+	void stop();
+
+	void report(std::ostream& out) const;
+
+private: // Types
+	struct Runner
+	{
+		std::string type;
+		std::string name;
+		std::unique_ptr<Bot> bot;
+		std::unique_ptr<GameClient> client;
+	};
+
+private: // Methods
+	void scheduleReport();
+
+private: // Data
+	std::string m_host;
+	std::string m_port;
+	int m_threads;
+	boost::asio::io_context m_ioc;
+	boost::asio::steady_timer m_reportTimer{ m_ioc };
+	std::chrono::seconds m_reportInterval;
+	std::vector<std::unique_ptr<Runner> > m_runners;
+	std::vector<std::thread> m_pool;
+	std::chrono::steady_clock::time_point m_start;
+};
@@ -0,0 +1,139 @@
+#pragma once
+
+#include "BitBoard.h"
+#include "GameInfo.h"
+
+#include <cstdint>
+#include <vector>
+
+/**********************************************************************************************************************
+ * CaptureFinder works out what a player gets for returning to their territory, the way the server does in claim() and
+ * fillEnclosedAreas() (lobby/src/games/paperio/paperiogame.ts), without touching the board.
+ *
+ * The server traces the outline of each area the player owns or has a trail on and fills it. That's every space that
+ * can't reach the edge of the board without crossing the player's spaces, so this floods the outside in from the edge
+ * instead, on BitBoards a row at a time, and takes what's left. Only the rows the player is on are searched. The
+ * outline hugs the player's spaces, so where two of them touch only at a corner, the outside gets through diagonally.
+ *
+ * The server counts a space again for each area it finds after the one being returned to, and the whole capture fails
+ * if that count is over a fifth of the board: no spaces are taken and the trail is lost. find() returns false in that
+ * case, and getServerCount() gives the count.
+ *
+ * To try out a path before taking it, add its spaces to the trail. Reuse a CaptureFinder to avoid allocating.
+ *********************************************************************************************************************/
+class CaptureFinder
+{
+public: // Methods
+	CaptureFinder();
+
+	/**
+	 * Finds the spaces the player would take by moving onto pos (a space they own), with the board's trails as they
+	 * are. captured gets every enclosed space the player doesn't already own, including their trail. Returns whether
+	 * the server would allow it.
+	 */
+	bool find(const Board& board, int playerId, const Position& pos, BitBoard& captured);
+	// The same, with the player's spaces as BitBoards. The trail can include spaces the player hasn't been to yet.
+	bool find(const BitBoard& owned, const BitBoard& trail, const Position& pos, BitBoard& captured);
+
+	// Every space inside the player's outlines, found by the last find(). Includes what they already own.
+	const BitBoard& getEnclosed() const { return m_enclosed; }
+	// The number the server compares against its limit, from the last find().
+	int getServerCount() const { return m_serverCount; }
+
+private: // Methods
+	void floodOutside(int top, int bottom);
+	void floodFrom(BitBoard& reach, const BitBoard& open, int top, int bottom, bool diagonal);
+	void countAreas(const BitBoard& owned, const Position& pos, int top, int bottom);
+	static void fillRow(uint64_t* reach, const uint64_t* open, int words);
+
+private: // Data
+	PlayerBitBoards m_bitBoards; // For find() on a Board.
+	BitBoard m_walls;            // The player's territory and trail.
+	BitBoard m_open;             // Everything else.
+	BitBoard m_outside;          // What reaches the edge of the board.
+	BitBoard m_enclosed;
+	BitBoard m_remaining;        // Scratch for counting areas.
+	BitBoard m_area;
+	std::vector<uint64_t> m_row; // Scratch for filling a row.
+	int m_serverCount;
+};
+
+// What following a path home is worth, from CaptureEstimator.
+struct CaptureGain
+{
+	int moves;    // How many moves it takes to get home, or 0 if the path doesn't (or goes back over the trail).
+	int captured; // At least this many spaces are captured on getting home, counting the trail.
+	bool allowed; // False if the capture is certainly over the server's limit, so would lose the trail instead.
+};
+
+/**********************************************************************************************************************
+ * CaptureEstimator scores many ways home from the same trail, e.g., every sequence of moves for the next turn, without
+ * filling the board for each one. It counts the spaces inside the loop the trail and path make with our territory,
+ * using running sums along the path instead of a fill:
+ *   - Each row has sums of its spaces from the right, so a vertical step adds or takes away the spaces to its right,
+ *     and going around a loop leaves the spaces inside it. That's the shoelace formula, counting spaces instead of area.
+ *   - The loop closes through our territory, where those steps add up to the same thing whichever way it goes, so
+ *     update() works out each territory space's total from one place in it and the loop needs no path back.
+ *
+ * What it gives is never more than the server would capture. It's exact when the trail and path only touch our
+ * territory at their ends and don't touch themselves; otherwise the server can enclose more pockets than the one
+ * loop, and CaptureFinder gives the exact answer.
+ *
+ * Call update() once a turn, then estimate() for each path.
+ *********************************************************************************************************************/
+class CaptureEstimator
+{
+public: // Methods
+	CaptureEstimator();
+
+	/**
+	 * Sets up for the turn. trail is our path since we were last on our territory, starting from the last space we
+	 * owned and ending at our head. If we're on our territory, it's just our position.
+	 */
+	void update(const BitBoard& owned, const std::vector<Position>& trail);
+
+	// The gain from following the path from our head. It stops at the first move that gets home.
+	CaptureGain estimate(const Moves& moves);
+	CaptureGain estimate(const std::vector<DirectionCode>& path);
+
+private: // Types
+	// Running sums along a loop, from the space it left our territory at.
+	struct Loop
+	{
+		int sum;            // Of getStepSum() along the way.
+		int weight;         // The loop's spaces that count.
+		int belowInside[2]; // Of those, how many have the space below them inside, if the loop turns out to go
+		                    // counterclockwise [0] or clockwise [1].
+		Position start;
+		DirectionCode lastMove;
+		bool crossed;       // The trail went back over itself, so there's no one loop to sum.
+	};
+
+private: // Methods
+	CaptureGain estimate(const DirectionCode* path, int count);
+	void findPotentials();
+	int getIndex(const Position& pos) const { return pos.y * m_width + pos.x; }
+	bool isOnBoard(const Position& pos) const { return pos.x >= 0 && pos.y >= 0 && pos.x < m_width && pos.y < m_height; }
+	int getWeight(const Position& pos) const { return m_enclosed.isSet(pos) ? 0 : 1; }
+	int getStepSum(const Position& from, const Position& to) const;
+	void addSpace(Loop& loop, const Position& pos, DirectionCode out) const;
+	int close(const Loop& loop, const Position& home) const;
+
+private: // Data
+	int m_width;
+	int m_height;
+	CaptureFinder m_finder;
+	BitBoard m_owned;
+	BitBoard m_enclosed;           // Our territory and the pockets it already holds, which count for nothing.
+	BitBoard m_trailSpaces;
+	BitBoard m_captured;           // Scratch for m_finder.
+	int m_pocketCount;             // Captured on any return.
+	std::vector<int> m_rowSums;    // Spaces that count at x and to its right, by row, with width + 1 per row.
+	std::vector<int> m_potentials; // By space in m_enclosed: the sum of steps to it from its area's first space.
+	std::vector<int> m_areas;      // By space: which area of m_enclosed it's in, or -1.
+	std::vector<int> m_queue;
+	Position m_head;
+	bool m_onTrail;
+	Loop m_trailLoop;              // Everything but the head's next move.
+	std::vector<Position> m_path;  // Scratch for estimate().
+};
@@ -0,0 +1,153 @@
+#pragma once
+
+#include "GameInfo.h"
+
+#include <cstdint>
+#include <vector>
+
+class WorldMap;
+
+/**********************************************************************************************************************
+ * DistanceField holds the number of moves from each space to the nearest of a set of sources, moving up, down, left and
+ * right and never entering a blocked space. It's a breadth-first search from every source at once, kept up to date as
+ * sources and blocked spaces change: update() repairs only the spaces whose distances depend on what changed.
+ *
+ * Each source has a label (e.g., a player ID), and getNearest() says which source a space is closest to. When sources
+ * are tied, it's one of them.
+ *
+ * Sources are always at distance 0, even when blocked; blocked only keeps paths from entering a space. So a player's
+ * head can be a source with the player's trail blocked.
+ *
+ * Distances are two bytes each and the grid has a blocked border, so a full board's field is about 100 KB and the
+ * search never checks for edges.
+ *********************************************************************************************************************/
+class DistanceField
+{
+public: // Methods
+	DistanceField();
+
+	// Sizes the field and clears it: no sources, nothing blocked, and every space UNREACHABLE.
+	void resize(int width, int height);
+	void clear();
+
+	int getWidth() const { return m_width; }
+	int getHeight() const { return m_height; }
+	bool isOnBoard(int x, int y) const { return x >= 0 && y >= 0 && x < m_width && y < m_height; }
+
+	// Changes to the sources and blocked spaces. They take effect at the next update().
+	void addSource(int x, int y, int label = 0); // Changes the label if it's already a source.
+	void removeSource(int x, int y);
+	void setBlocked(int x, int y, bool blocked);
+	bool isSource(int x, int y) const { return m_sources[getIndex(x, y)] != NO_SOURCE; }
+	bool isBlocked(int x, int y) const { return m_blocked[getIndex(x, y)] != 0; }
+
+	/**
+	 * Brings the distances up to date with the changes since the last update. Spaces whose shortest path went through a
+	 * change are cleared and searched again from the spaces around them; the rest are left alone. If a lot changed, or
+	 * the changes cut off much of the field, it's faster to start over, so it calls recompute() instead.
+	 */
+	void update();
+	void recompute(); // Searches the whole field again.
+
+	// The distance to the nearest source, or UNREACHABLE. And that source's label, or NO_SOURCE.
+	int getDistance(int x, int y) const { return m_distances[getIndex(x, y)]; }
+	int getDistance(const Position& pos) const { return getDistance(pos.x, pos.y); }
+	int getNearest(int x, int y) const { return m_labels[getIndex(x, y)]; }
+	int getNearest(const Position& pos) const { return getNearest(pos.x, pos.y); }
+
+	enum { UNREACHABLE = 0xffff, NO_SOURCE = -1 };
+
+private: // Types
+	struct Entry
+	{
+		int index;
+		int distance;
+
+		bool operator<(const Entry& other) const { return distance < other.distance; }
+	};
+
+private: // Methods
+	int getIndex(int x, int y) const { return (y + 1) * m_stride + x + 1; }
+	void markChanged(int index);
+	bool isSupported(int index) const;
+	bool invalidate();
+	void repair();
+	void search();
+	bool popEntry(Entry& entry);
+
+private: // Data
+	int m_width;
+	int m_height;
+	int m_stride;                     // The width plus the border on each side.
+	int m_offsets[4];                 // From a space's index to its neighbors'.
+	std::vector<uint16_t> m_distances;
+	std::vector<int> m_labels;        // The label of the nearest source, by space.
+	std::vector<int> m_sources;       // The label of the source at each space, or NO_SOURCE.
+	std::vector<uint8_t> m_blocked;   // The border is always blocked.
+	std::vector<int> m_changed;       // Spaces changed since the last update.
+	std::vector<uint8_t> m_isChanged; // So each is listed once.
+	std::vector<int> m_invalid;       // Spaces cleared by the current update.
+	std::vector<Entry> m_seeds;       // Where a search starts, sorted by distance.
+	std::vector<Entry> m_queue;       // What invalidate() has found, in the order found.
+	std::vector<int> m_found;         // What search() has found, in the order found.
+	size_t m_nextSeed;
+	size_t m_nextQueued;
+};
+
+/**********************************************************************************************************************
+ * PlayerDistances keeps the distance fields most decisions need, updated from the board each turn:
+ *   - for each player in view, the distance from their head to every space without crossing their own trail,
+ *   - for our own player, the distance from every space back to our territory without crossing our trail, and
+ *   - for every space, the nearest enemy head and how far it is. This one ignores trails, so it's never more than
+ *     the real distance, which is what safety checks want.
+ *
+ * Positions are on the whole board. Updating from a WorldMap keeps the fields the same size from turn to turn, so only
+ * the spaces that changed are repaired; updating from a PartialBoard works too, but each new view size starts over.
+ *********************************************************************************************************************/
+class PlayerDistances
+{
+public: // Methods
+	PlayerDistances();
+
+	void update(const WorldMap& world, const Players& players, int selfId);
+	void update(const PartialBoard& view, const Players& players, int selfId);
+
+	// From the player's head. UNREACHABLE if the player's head isn't known, or the space isn't in the fields.
+	int getDistance(int playerId, const Position& pos) const;
+	// From the space back to our territory.
+	int getDistanceHome(const Position& pos) const { return getFrom(m_home, pos, DistanceField::UNREACHABLE); }
+	// The nearest enemy head to the space, or Player::NO_PLAYER, and how far.
+	int getNearestEnemy(const Position& pos) const { return getFrom(m_enemies, pos, Player::NO_PLAYER, true); }
+	int getNearestEnemyDistance(const Position& pos) const { return getFrom(m_enemies, pos, DistanceField::UNREACHABLE); }
+
+	// The fields themselves, in the board's coordinates (see getOffset()). getField() returns null for unknown players.
+	const DistanceField* getField(int playerId) const;
+	const DistanceField& getHomeField() const { return m_home; }
+	const DistanceField& getEnemyField() const { return m_enemies; }
+	const Position& getOffset() const { return m_offset; }
+
+private: // Types
+	struct Head
+	{
+		int playerId;
+		Position pos;         // In the fields' coordinates, or UNKNOWN_POS.
+		DistanceField field;
+		bool seen;            // In this update.
+	};
+
+private: // Methods
+	void update(const Board& board, const Position& offset, const Players& players, int selfId);
+	void resize(int width, int height);
+	void updateSpace(int x, int y, int oldOwner, int oldTrail, int newOwner, int newTrail);
+	Head* findHead(int playerId);
+	int getFrom(const DistanceField& field, const Position& pos, int otherwise, bool nearest = false) const;
+
+private: // Data
+	int m_selfId;
+	Position m_offset;
+	DistanceField m_home;
+	DistanceField m_enemies;
+	std::vector<Head> m_heads;
+	std::vector<int> m_owners; // The owner and trail of each space at the last update, by row.
+	std::vector<int> m_trails;
+};
@@ -1,9 +1,17 @@
 #pragma once
 
 #include "GameInfo.h"
+#include "GameRecorder.h"
+#include "GameStateParser.h"
+#include "LatencyHistogram.h"
+#include "MoveRequests.h"
 #include "Bot.h"
 
+#include <chrono>
+#include <functional>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -14,34 +22,125 @@
 
 #include <boost/asio/connect.hpp>
 #include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/asio/thread_pool.hpp>
+#include <boost/beast/core/flat_buffer.hpp>
+#include <boost/beast/http.hpp>
 
 //---------------------------------------------------------------------------------------------------------------------
 //---------------------------------------------------------------------------------------------------------------------
 class GameClient
 {
-public:
+public: // Types
+	typedef std::chrono::steady_clock Clock;
+
+	// Totals since the client was created. Bot times are for Bot::getMoves(); round trips are from sending moves to
+	// receiving the next game state.
+	struct Stats
+	{
+		int games;                     // Games joined.
+		int turns;                     // Turns the bot was asked for moves.
+		int turnsLate;                 // Turns where the bot missed the deadline (playAsync() only).
+		Clock::duration botTime;       // Wall clock time.
+		Clock::duration maxBotTime;
+		std::chrono::nanoseconds botCpu; // CPU time used by the thread running the bot.
+		int roundTrips;
+		Clock::duration roundTripTime;
+		Clock::duration maxRoundTrip;
+	};
+
+public: // Methods
 	GameClient(const char* host, const char* port);
+	// Shares an io_context with other clients. The bot runs on whichever thread is running the io_context.
+	GameClient(boost::asio::io_context& ioc, const char* host, const char* port);
 	~GameClient();
 	void play(Bot* bot, const char* botName, bool persistent);
 
+	/**
+	 * Plays like play(), but with asynchronous I/O. The bot runs on its own thread while this thread services the
+	 * connection. If the bot hasn't returned by GameInfo::deadline, the client sends no moves (the bot continues in
+	 * its current direction) so the server doesn't count the turn as missed.
+	 */
+	void playAsync(Bot* bot, const char* botName, bool persistent);
+
+	/**
+	 * Starts playing like playAsync(), but returns right away. Something else has to run the io_context.
+	 *
+	 * With a shared io_context, the bot runs on one of the threads running it, which meanwhile can't service the other
+	 * clients: their deadline timers and replies wait until it's done. Run the io_context on at least as many threads as
+	 * there are bots thinking at once (botrunner's threads option), or a slow bot can make the others miss turns.
+	 */
+	void startAsync(Bot* bot, const char* botName, bool persistent);
+
+	// Thread safe.
+	Stats getStats() const;
+	// Histograms of each part of the turns played so far. The first game state of each game, which waits for the game
+	// to start, isn't counted. Thread safe.
+	TurnLatency getLatency() const;
+
+	// Quiet clients only report errors. Useful when there are many in one process.
+	void setQuiet(bool quiet) { m_quiet = quiet; }
+
+	// Records every game state received and every move sent to a file, for the replay tool. Throws if it can't open it.
+	void recordTo(const std::string& path) { m_recorder.reset(new GameRecorder(path)); }
+
+	// The longest the server waits for moves each turn (the max of the InputWaiter in lobby/src/games/paperio.ts).
+	void setMaxTurnWait(std::chrono::milliseconds maxTurnWait) { m_maxTurnWait = maxTurnWait; }
+
+private: // Types
+	typedef boost::beast::http::request<boost::beast::http::string_body> Request;
+	typedef boost::beast::http::response<boost::beast::http::string_body> Response;
+	typedef std::function<void(std::string& body)> ResponseHandler;
+
 private: // Methods
+	GameClient(boost::asio::io_context* ioc, bool ownIoc, const char* host, const char* port);
 	void connect();
 	void close();
-	std::string getMessage(const char* target, bool useAuthorization);
-	std::string postMessage(const char* target, const char* body, bool useAuthorization);
+	void prepareRequest(Request& req, boost::beast::http::verb verb, const char* target, const std::string& body, bool useAuthorization);
+	void prepareResponse();
+	std::string& getMessage(const char* target, bool useAuthorization);
+	std::string& postMessage(const char* target, const std::string& body, bool useAuthorization);
+	std::string& readMessage();
 
 	std::vector<std::string> getPlayers();
-	void joinLobby(Bot* bot, const char* requestedBotName, bool persistent);
+	void joinLobby(const char* requestedBotName, bool persistent);
 	void playGame(Bot* bot);
 	std::string joinFirstAvailableGame();
 	std::vector<std::string> listGames();
 	void sendMoves(Moves& moves);
 
+	std::string serializeJoinRequest(const char* requestedBotName, bool persistent);
+	void processJoinResponse(const std::string& jsonLobby);
+	std::vector<std::string> parseGames(const std::string& jsonGames);
+	std::string serializeMoves(const Moves& moves);
+	void processGameState(std::string& jsonGameInfo); // Parses in place, so the text is modified.
+	void onGameStateReceived(Clock::time_point movesSent);
+	void recordTurnLatency(Clock::time_point parseStart); // Call once the game state is parsed.
+	Moves callBot(Bot* bot, const GameInfo& gameInfo); // Calls getMoves() and keeps stats.
+	void countGame();
+
+	// Asynchronous play. Each step runs on m_strand and starts the next one when its I/O completes.
+	void asyncConnect();
+	void asyncJoinLobby();
+	void asyncFindGame();
+	void asyncStartGame();
+	void asyncStartTurn();
+	void asyncSendMoves(const Moves& moves);
+	void asyncProcessGameState();
+	void onBotMoves(unsigned turn, const Moves& moves, const std::string& error);
+	void onTurnDeadline(unsigned turn);
+	void asyncRequest(boost::beast::http::verb verb, const char* target, const std::string& body, bool useAuthorization, ResponseHandler handler);
+	void asyncReadResponse(ResponseHandler handler);
+	void asyncFail(const std::string& what);
+	void asyncRetry(std::function<void()> step);
+
 	std::string encodeUri(const std::string& value);
 
 private:
 	bool m_connected; // Whether or not the client is connected to the server.
-	boost::asio::io_context m_ioc; // Required for all I/O
+	std::unique_ptr<boost::asio::io_context> m_ownIoc; // Set unless the io_context is shared.
+	boost::asio::io_context& m_ioc; // Required for all I/O
 	boost::asio::ip::tcp::socket m_socket{ m_ioc };
 
 	std::string m_host;
@@ -50,7 +149,49 @@ private:
 
 	std::string m_token;    // A token used for authentication.
 	std::string m_gameName; // The name of the game.
+	std::string m_gameUri;  // The encoded URI to post moves to.
 	std::string m_botName;  // The assigned bot name, used to look up the player in the player map.
+	MoveRequests m_moveRequests; // Ready-made requests to post moves to m_gameUri.
+	std::unique_ptr<GameRecorder> m_recorder; // Set if recording.
 
 	GameInfo m_gameInfo;
+	GameStateParser m_parser;
+
+	// Turn timing, used to give the bot a deadline.
+	std::chrono::milliseconds m_maxTurnWait; // How long the server waits for moves.
+	Clock::duration m_minRoundTrip;          // The fastest observed time from sending moves to the next game state.
+	Clock::time_point m_stateReceived;       // When the current game state arrived.
+
+	// When each part of sending the current moves finished, for the latency histograms.
+	Clock::time_point m_turnStart;           // The moves were ready to send.
+	Clock::time_point m_requestReady;        // The request was ready to write.
+	Clock::time_point m_requestWritten;      // The request was written to the socket.
+
+	// Reused for every message so their memory is kept from turn to turn.
+	boost::beast::flat_buffer m_buffer;
+	Request m_request;
+	Response m_response;
+
+	// Asynchronous play.
+	boost::asio::strand<boost::asio::io_context::executor_type> m_strand{ m_ioc.get_executor() };
+	boost::asio::steady_timer m_retryTimer{ m_ioc };
+	boost::asio::steady_timer m_deadlineTimer{ m_ioc };
+	std::unique_ptr<boost::asio::thread_pool> m_botThread; // Runs Bot::getMoves() so the I/O thread is free. Made by startAsync(), unless the io_context is shared.
+
+	Bot* m_bot;
+	std::string m_requestedBotName;
+	bool m_persistent;
+	unsigned m_turn;            // Counts game states handed to the bot, so late results can be recognized.
+	bool m_botBusy;             // The bot is working on a turn. It reads m_gameInfo, so don't touch that until it's done.
+	bool m_movesSent;           // Moves (or the fallback) have been sent for the current turn.
+	bool m_gameStarting;        // The game state being waited for is the first one of the game.
+	bool m_statePending;        // A game state arrived while the bot was busy.
+	std::string m_pendingState; // The body of that game state.
+	int m_turnsPlayed;
+	int m_turnsLate;            // Turns where the bot missed the deadline and the fallback was sent.
+	bool m_quiet;
+
+	mutable std::mutex m_statsMutex;
+	Stats m_stats;
+	TurnLatency m_latency;
 };
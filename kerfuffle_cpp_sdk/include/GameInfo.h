@@ -1,8 +1,12 @@
 #pragma once
 
-#include <map>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <iterator>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 
@@ -22,6 +26,19 @@ public:
 	enum {UNKNOWN_POS = -1};
 };
 
+/**********************************************************************************************************************
+ * The four legal directions in two bits, clockwise from up, for code that stores or searches a lot of moves.
+ * DIRECTION_X and DIRECTION_Y give the step for each.
+ *********************************************************************************************************************/
+enum DirectionCode : uint8_t { DIR_UP = 0, DIR_RIGHT = 1, DIR_DOWN = 2, DIR_LEFT = 3 };
+
+constexpr int DIRECTION_X[4] = { 0, 1, 0, -1 };
+constexpr int DIRECTION_Y[4] = { -1, 0, 1, 0 };
+
+constexpr DirectionCode getOpposite(DirectionCode code) { return (DirectionCode)(code ^ 2); }
+constexpr DirectionCode turnRight(DirectionCode code) { return (DirectionCode)((code + 1) & 3); }
+constexpr DirectionCode turnLeft(DirectionCode code) { return (DirectionCode)((code + 3) & 3); }
+
 /**********************************************************************************************************************
  * The direction to move. Must always have a length of 1 in a cardinal direction.
  *********************************************************************************************************************/
@@ -29,8 +46,16 @@ class Direction
 {
 public:
 	Direction(int _x = 0, int _y = 0);
+	Direction(DirectionCode code) : x(DIRECTION_X[code]), y(DIRECTION_Y[code]) {}
 	Direction& set(int _x, int _y) { x = _x; y = _y; return *this; }
 	bool operator==(const Position& src) const { return src.x == x && src.y == y; }
+	bool operator==(const Direction& src) const { return src.x == x && src.y == y; }
+	bool operator!=(const Direction& src) const { return !(*this == src); }
+
+	// Whether this is one of the four directions the server accepts, and if so, its code.
+	bool isLegal() const { return (x == 0) != (y == 0) && x >= -1 && x <= 1 && y >= -1 && y <= 1; }
+	DirectionCode getCode() const { return (DirectionCode)(y != 0 ? 1 + y : 2 - x); }
+
 	int x;
 	int y;
 
@@ -46,6 +71,8 @@ public:
 class Player
 {
 public:
+	Player();
+
 	int id;              // The player's ID. This is used in the board data.
 	std::string name;    // The name of the player as assigned by the server (e.g., after name conflict resolution).
 	int score;           // The number of spaces owned by the player.
@@ -57,37 +84,122 @@ public:
 
 /**********************************************************************************************************************
  * Holds the best-known data for the player, updated each turn. Maps the assigned bot name to the Player.
+ *
+ * The players are kept in a flat table, in the order the server lists them, and each turn's state is written over the
+ * last one's: a Player object lasts as long as the player stays in the game, so pointers to it stay valid, and updating
+ * doesn't touch the heap or the shared_ptrs. findPlayerById() looks a player up in a table indexed by ID.
+ *
+ * Iterating gives pairs of the name (first) and the Player (second), as a map would.
  *********************************************************************************************************************/
-class Players : public std::map< std::string, std::shared_ptr< Player> >
+class Players
 {
-public:
+public: // Types
+	typedef std::pair<std::string, std::shared_ptr<Player> > Entry;
+	typedef std::vector<Entry>::iterator iterator;
+	typedef std::vector<Entry>::const_iterator const_iterator;
+
+public: // Methods
+	Players();
+
+	iterator begin() { return m_entries.begin(); }
+	iterator end() { return m_entries.end(); }
+	const_iterator begin() const { return m_entries.begin(); }
+	const_iterator end() const { return m_entries.end(); }
+	size_t size() const { return m_entries.size(); }
+	bool empty() const { return m_entries.empty(); }
+	void clear();
+
+	iterator find(const std::string& name);
+	const_iterator find(const std::string& name) const;
+	size_t count(const std::string& name) const { return find(name) != end() ? 1 : 0; }
+
+	// The player with the name, which is added (with an ID of NO_PLAYER) if it isn't in the game.
+	std::shared_ptr<Player>& operator[](const std::string& name);
+
 	Player* findPlayerById(int playerId) const;
+
+	/**
+	 * Updating for a new turn: call beginUpdate(), then update() with each player in the game, then endUpdate(), which
+	 * drops the players that weren't updated. update() returns the Player to fill in.
+	 */
+	void beginUpdate();
+	Player& update(const std::string& name);
+	void endUpdate();
+
+private: // Methods
+	int findSlot(const std::string& name) const;
+	int addSlot(const std::string& name);
+	void indexIds(bool moved);
+
+private: // Data
+	std::vector<Entry> m_entries;
+	std::vector<unsigned> m_updates;                    // The update each player was last in, by slot.
+	std::unordered_map<std::string, int> m_slotsByName; // Slots in m_entries.
+	std::vector<int> m_slotsById;                       // Slots by ID - m_firstId, or -1.
+	int m_firstId;
+	unsigned m_update;
+	int m_nextSlot;                                     // Where the next update() expects to find its player.
+};
+
+/**********************************************************************************************************************
+ * A single space on a Board, packed into two bytes. The values are the board's slots for the player IDs (see
+ * Board::getPlayerId()); 0 means no player.
+ *********************************************************************************************************************/
+struct Cell
+{
+	uint8_t owner; // The slot of the player who owns this space.
+	uint8_t trail; // The slot of the player whose trail is on this space.
 };
 
 /**********************************************************************************************************************
  * BoardData represents an incomplete view of the board.
+ *
+ * Spaces are stored as packed Cells, a row at a time, so a whole board fits in a few dozen KB. The server's player IDs
+ * only grow, so each board maps the IDs it holds to small slots. The ID getters and setters hide the slots; code that
+ * scans the board can use getRow() and compare slots instead, translating with getSlot()/getPlayerId().
  *********************************************************************************************************************/
 class Board
 {
 public: // Methods
 	Board();
 	void reset();
-	int getOwnerId(int x, int y) const { return ownerIDs[getIndex(x, y)]; }
-	int getOwnerId(const Position& pos) const { return ownerIDs[getIndex(pos)]; }
-	void setOwnerId(int x, int y, int ownerId) { ownerIDs[getIndex(x, y)] = ownerId; }
-	void setOwnerId(const Position& pos, int ownerId) { ownerIDs[getIndex(pos)] = ownerId; }
-	int getTrailId(int x, int y) const { return trailIDs[getIndex(x, y)]; }
-	int getTrailId(const Position& pos) const { return trailIDs[getIndex(pos)]; }
-	void setTrailId(int x, int y, int trailId) { trailIDs[getIndex(x, y)] = trailId; }
-	void setTrailId(const Position& pos, int trailId) { trailIDs[getIndex(pos)] = trailId; }
+	void resize(int width, int height); // Sizes the board. Existing spaces aren't cleared.
+	int getOwnerId(int x, int y) const { return getPlayerId(cells[getIndex(x, y)].owner); }
+	int getOwnerId(const Position& pos) const { return getPlayerId(cells[getIndex(pos)].owner); }
+	void setOwnerId(int x, int y, int ownerId) { cells[getIndex(x, y)].owner = getSlot(ownerId); }
+	void setOwnerId(const Position& pos, int ownerId) { cells[getIndex(pos)].owner = getSlot(ownerId); }
+	int getTrailId(int x, int y) const { return getPlayerId(cells[getIndex(x, y)].trail); }
+	int getTrailId(const Position& pos) const { return getPlayerId(cells[getIndex(pos)].trail); }
+	void setTrailId(int x, int y, int trailId) { cells[getIndex(x, y)].trail = getSlot(trailId); }
+	void setTrailId(const Position& pos, int trailId) { cells[getIndex(pos)].trail = getSlot(trailId); }
 	int getIndex(int x, int y) const { return y * width + x; }
 	int getIndex(const Position& pos) const { return pos.y * width + pos.x; }
 
+	// Row y, width Cells long.
+	const Cell* getRow(int y) const { return &cells[y * width]; }
+	Cell* getRow(int y) { return &cells[y * width]; }
+
+	// Slots. getSlot() adds the player if it isn't on the board yet; findSlot() returns NO_SLOT instead.
+	int getPlayerId(int slot) const { return m_playerIds[slot]; }
+	uint8_t getSlot(int playerId) { return playerId == Player::NO_PLAYER ? 0 : addSlot(playerId); }
+	int findSlot(int playerId) const;
+	int getSlotCount() const { return m_slotCount; }
+	void clearSlots();   // Forgets every player. Only for when every space is about to be written again.
+	void compactSlots(); // Frees the slots of players no longer on the board.
+
+	enum { MAX_SLOTS = 256, NO_SLOT = -1 };
+
+private: // Methods
+	uint8_t addSlot(int playerId);
+
 public: // Data
-	int width;                 // The width of this data. Likely a subset of the entire board. May change each time.
-	int height;                // The height of this data. Likely a subset of the entire board. May change each time.
-	std::vector<int> ownerIDs; // A two dimensional array of player IDs for who owns each position.
-	std::vector<int> trailIDs; // A two dimensional array of player IDs for who is trying to take each position.
+	int width;               // The width of this data. Likely a subset of the entire board. May change each time.
+	int height;              // The height of this data. Likely a subset of the entire board. May change each time.
+	std::vector<Cell> cells; // A two dimensional array of who owns and who is trying to take each position.
+
+private: // Data
+	std::array<int, MAX_SLOTS> m_playerIds; // The player ID for each slot. Slot 0 is Player::NO_PLAYER.
+	int m_slotCount;
 };
 
 /**********************************************************************************************************************
@@ -105,12 +217,119 @@ public: // Data
 /**********************************************************************************************************************
  * The player makes 5 moves at a time (unless this comment is old).
    Additional will be ignored. Too few, and the player will continue in the previous direction.
+ *
+ * The moves are packed into 16 bits: two bits for each move's DirectionCode, first move lowest, and the count in the
+ * top bits. So Moves never allocates, and a plan can be copied, compared or hashed as a number (see getPacked()).
+ * Like the server, it ignores moves that aren't legal directions and moves past MOVES_PER_TURN.
+ *********************************************************************************************************************/
+class Moves
+{
+public: // Types
+	class const_iterator
+	{
+	public:
+		typedef std::input_iterator_tag iterator_category;
+		typedef Direction value_type;
+		typedef int difference_type;
+		typedef const Direction* pointer;
+		typedef Direction reference;
+
+		const_iterator(const Moves* moves, int index) : m_moves(moves), m_index(index) {}
+		Direction operator*() const { return (*m_moves)[m_index]; }
+		const_iterator& operator++() { m_index++; return *this; }
+		const_iterator operator++(int) { const_iterator old = *this; m_index++; return old; }
+		bool operator==(const const_iterator& other) const { return m_index == other.m_index; }
+		bool operator!=(const const_iterator& other) const { return m_index != other.m_index; }
+
+	private:
+		const Moves* m_moves;
+		int m_index;
+	};
+	typedef const_iterator iterator;
+
+public: // Methods
+	Moves() : m_packed(0) {}
+
+	void addMove(Direction direction) { if (direction.isLegal()) addMove(direction.getCode()); }
+	void addMove(DirectionCode code) { if (size() < MOVES_PER_TURN) m_packed = (uint16_t)((m_packed | code << (2 * size())) + (1 << COUNT_SHIFT)); }
+	void push_back(Direction direction) { addMove(direction); }
+	void clear() { m_packed = 0; }
+
+	size_t size() const { return m_packed >> COUNT_SHIFT; }
+	bool empty() const { return size() == 0; }
+	DirectionCode getCode(size_t index) const { return (DirectionCode)((m_packed >> (2 * index)) & 3); }
+	Direction operator[](size_t index) const { return Direction(getCode(index)); }
+	Direction front() const { return (*this)[0]; }
+	Direction back() const { return (*this)[size() - 1]; }
+	const_iterator begin() const { return const_iterator(this, 0); }
+	const_iterator end() const { return const_iterator(this, (int)size()); }
+
+	bool operator==(const Moves& other) const { return m_packed == other.m_packed; }
+	bool operator!=(const Moves& other) const { return m_packed != other.m_packed; }
+
+	// The whole plan as a number, and back. Different plans always give different numbers. fromPacked() keeps at most
+	// MOVES_PER_TURN moves and drops any bits past the last one, so any number gives a plan that packs the same way.
+	uint16_t getPacked() const { return m_packed; }
+	static Moves fromPacked(uint16_t packed)
+	{
+		int count = packed >> COUNT_SHIFT;
+		count = count < MOVES_PER_TURN ? count : MOVES_PER_TURN;
+		Moves moves;
+		moves.m_packed = (uint16_t)(count << COUNT_SHIFT | (packed & ((1 << (2 * count)) - 1)));
+		return moves;
+	}
+
+	enum {MOVES_PER_TURN = 5, COUNT_SHIFT = 12};
+
+private: // Data
+	uint16_t m_packed;
+};
+
+/**********************************************************************************************************************
+ * What changed since the last turn, so a bot can do work in proportion to the changes rather than to the view.
+ * GameStateParser fills it in with each turn it reads, comparing against what GameInfo held before.
+ *
+ * Spaces are only compared where this turn's view overlaps the last one's. Spaces that came into view are new, not
+ * changed; previousOffset and the last view's size say which those are. A player joining or leaving the game is
+ * different from one coming into or going out of view (the server lists every player, but only gives the position of
+ * the ones in view).
  *********************************************************************************************************************/
-class Moves : public std::vector<Direction>
+class TurnChanges
 {
+public: // Types
+	struct SpaceChange
+	{
+		Position pos;   // On the whole board, not the view.
+		int oldOwnerId;
+		int newOwnerId;
+		int oldTrailId;
+		int newTrailId;
+	};
+
+	struct ScoreChange
+	{
+		int playerId;
+		int oldScore;
+		int newScore;
+	};
+
 public: // Methods
-	void addMove(Direction direction) { push_back(direction); }
-	enum {MOVES_PER_TURN = 5};
+	TurnChanges();
+	void clear();
+
+	bool empty() const { return spaces.empty() && joined.empty() && left.empty() && enteredView.empty() && leftView.empty() && scores.empty(); }
+
+public: // Data
+	bool hasPrevious;                 // Whether there was a last turn to compare with. If not, the whole view is new.
+	Position previousOffset;          // The last view's offset in the board.
+	int previousWidth;                // The last view's size.
+	int previousHeight;
+	std::vector<SpaceChange> spaces;  // Spaces in both views whose owner or trail changed, by row.
+	std::vector<int> joined;          // IDs of the players that joined the game.
+	std::vector<int> left;            // IDs of the players no longer in the game: dead, or gone.
+	std::vector<int> enteredView;     // IDs of the players whose positions became known, including those that joined.
+	std::vector<int> leftView;        // IDs of the players whose positions stopped being known, including those that left.
+	std::vector<ScoreChange> scores;  // The players still in the game whose scores changed.
 };
 
 /**********************************************************************************************************************
@@ -127,5 +346,7 @@ public: // Data
 	int boardHeight;           // The height of the entire board. This remains constant while the bot is in the game.
 	PartialBoard partialBoard; // The state of the board. This is not the complete board.
 	Players players;           // The players currently in the game.
+	TurnChanges changes;       // What changed since the last turn.
 	bool gameOver;             // Whether or not the game is over.
+	std::chrono::steady_clock::time_point deadline; // When getMoves() must return for the moves to make this turn.
 };
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "GameInfo.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/**********************************************************************************************************************
+ * The record types in a game recording.
+ *
+ * A recording starts with the 8 byte header "KGRL" and a 32 bit version. Each record follows: a one byte type, a 32 bit
+ * payload size, a 64 bit time in nanoseconds since the recording started, then the payload. Numbers are little endian.
+ *********************************************************************************************************************/
+enum RecordType
+{
+	RECORD_GAME = 1,  // Joined a game. The payload is the bot's name and the game's name, separated by a null.
+	RECORD_STATE = 2, // A response from the server, exactly as received.
+	RECORD_MOVES = 3, // Moves sent to the server. The payload is a signed byte for x, then y, for each move.
+};
+
+/**********************************************************************************************************************
+ * GameRecorder appends what GameClient sends and receives to a file, so games can be replayed offline (see the replay
+ * tool). Writes are buffered and flushed at the end of each game.
+ *********************************************************************************************************************/
+class GameRecorder
+{
+public: // Methods
+	// Opens the file for appending. Throws if it can't be opened.
+	explicit GameRecorder(const std::string& path);
+	~GameRecorder();
+
+	void recordGame(const std::string& botName, const std::string& gameName);
+	void recordState(const std::string& json);
+	void recordMoves(const Moves& moves);
+	void flush();
+
+	enum { VERSION = 1, HEADER_SIZE = 8, RECORD_HEADER_SIZE = 13 };
+
+private: // Methods
+	void write(RecordType type, const char* data, size_t size);
+
+private: // Data
+	std::FILE* m_file;
+	std::chrono::steady_clock::time_point m_start;
+	std::vector<char> m_fileBuffer; // Given to setvbuf().
+	std::string m_moves;            // Reused to encode moves.
+};
+
+/**********************************************************************************************************************
+ * GameRecording reads a file written by GameRecorder. It maps the file into memory and hands out records that point
+ * straight into it, so reading a recording doesn't copy it.
+ *********************************************************************************************************************/
+class GameRecording
+{
+public: // Types
+	struct Record
+	{
+		RecordType type;
+		int64_t time;     // Nanoseconds since the recording started.
+		const char* data; // Points into the mapped file. Not null terminated.
+		uint32_t size;
+	};
+
+public: // Methods
+	GameRecording();
+	~GameRecording();
+
+	// Maps the file. Throws if it can't be read or isn't a recording.
+	void open(const std::string& path);
+	void close();
+
+	// Gets the next record. Returns false at the end, including when the last record was cut off.
+	bool next(Record& record);
+	void rewind() { m_offset = HEADER_SIZE; }
+
+	// Reads the moves in a RECORD_MOVES record.
+	static void getMoves(const Record& record, Moves& moves);
+
+	enum { HEADER_SIZE = GameRecorder::HEADER_SIZE };
+
+private: // Data
+	const char* m_data;
+	size_t m_size;
+	size_t m_offset;
+#ifdef _WIN32
+	void* m_fileHandle;
+	void* m_mappingHandle;
+#endif
+};
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "GameInfo.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rapidjson/document.h"
+
+/**********************************************************************************************************************
+ * GameStateParser turns the game state the server sends each turn into GameInfo.
+ *
+ * The JSON is parsed in place: strings point into the text, which the parser modifies. parse() reads it in a single
+ * streaming pass and writes straight into GameInfo. parseDom() builds a DOM first, as GameClient used to; it's kept for
+ * comparison. Either way, the memory used is kept from turn to turn, so once it's grown to fit the largest state seen,
+ * parsing doesn't touch the heap.
+ *
+ * Both also fill in GameInfo::changes, comparing the new state with what GameInfo held before. Keep passing the same
+ * GameInfo each turn, and reset() it when a new game starts.
+ *********************************************************************************************************************/
+class GameStateParser
+{
+public: // Types
+	typedef rapidjson::MemoryPoolAllocator<> Allocator;
+	typedef rapidjson::GenericDocument<rapidjson::UTF8<>, Allocator, Allocator> Document;
+
+public: // Methods
+	GameStateParser();
+
+	/**
+	 * Parses a game state into gameInfo. The JSON must be null terminated, and is modified. Returns false if it isn't
+	 * a game state (e.g., "Not Found" once the game has ended). If it's cut short, gameInfo may be partly updated.
+	 */
+	bool parse(char* json, GameInfo& gameInfo);
+	// Same as parse(), by way of a DOM.
+	bool parseDom(char* json, GameInfo& gameInfo);
+
+	// The memory set aside for the DOM and the parser's stack.
+	size_t getCapacity() const { return m_valueBuffer.size() + m_stackBuffer.size(); }
+
+private: // Methods
+	void clear();
+	void allocate(size_t valueSize, size_t stackSize);
+	void readPlayers(const rapidjson::Value& playersVal, Players& players);
+	void readBoard(const rapidjson::Value& rows, PartialBoard& board);
+	void saveTurn(const GameInfo& gameInfo);
+	void findChanges(GameInfo& gameInfo) const;
+	void findSpaceChanges(const PartialBoard& board, TurnChanges& changes) const;
+
+	enum { INITIAL_VALUE_SIZE = 64 * 1024, INITIAL_STACK_SIZE = 16 * 1024, DOCUMENT_STACK_CAPACITY = 4 * 1024 };
+
+private: // Types
+	struct LastPlayer
+	{
+		int id;
+		int score;
+		bool inView;
+
+		bool operator<(const LastPlayer& other) const { return id < other.id; }
+	};
+
+private: // Data
+	std::vector<char> m_valueBuffer;  // Holds the DOM.
+	std::vector<char> m_stackBuffer;  // Holds the parser's stacks.
+	std::unique_ptr<Allocator> m_valueAllocator;
+	std::unique_ptr<Allocator> m_stackAllocator;
+	std::unique_ptr<Document> m_doc;
+	std::string m_name;               // The name of the player being read.
+	PartialBoard m_lastBoard;         // The view before the turn being read.
+	std::vector<LastPlayer> m_lastPlayers; // The players before the turn being read, by ID.
+};
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+
+/**********************************************************************************************************************
+ * LatencyHistogram counts times in buckets that grow with the time, like an HDR histogram: the first 64 nanoseconds
+ * get a bucket each, then every power of two is split into 32 buckets. Percentiles are accurate to about 3% of the
+ * time, from nanoseconds up to minutes, in a fixed 5 KB. Recording is a bit scan and an increment, so it's cheap
+ * enough to leave on.
+ *********************************************************************************************************************/
+class LatencyHistogram
+{
+public: // Methods
+	LatencyHistogram() { reset(); }
+	void reset();
+
+	void record(std::chrono::nanoseconds time);
+	void add(const LatencyHistogram& other);
+
+	uint64_t getCount() const { return m_count; }
+	std::chrono::nanoseconds getMax() const { return std::chrono::nanoseconds(m_max); }
+	std::chrono::nanoseconds getMean() const;
+	// The time that percent of the recorded times are at or below, e.g. getPercentile(99) for p99.
+	std::chrono::nanoseconds getPercentile(double percent) const;
+
+	enum { SUB_BUCKET_BITS = 6, SUB_BUCKETS = 1 << SUB_BUCKET_BITS, HALF_SUB_BUCKETS = SUB_BUCKETS / 2 };
+	enum { MAX_SHIFT = 36, BUCKETS = SUB_BUCKETS + MAX_SHIFT * HALF_SUB_BUCKETS }; // Up to 2^42 ns, over an hour.
+
+private: // Methods
+	static int getBucket(uint64_t time);
+	static uint64_t getBucketEnd(int bucket); // The largest time in the bucket.
+
+private: // Data
+	std::array<uint32_t, BUCKETS> m_counts;
+	uint64_t m_count;
+	uint64_t m_total;
+	uint64_t m_max;
+};
+
+/**********************************************************************************************************************
+ * Where the time goes in each turn, as GameClient sees it. A turn starts when the bot returns its moves and ends when
+ * the next game state has been parsed; the bot's own time is separate.
+ *********************************************************************************************************************/
+struct TurnLatency
+{
+	LatencyHistogram serialize; // Turning the moves into a request.
+	LatencyHistogram write;     // Writing the request to the socket.
+	LatencyHistogram wait;      // From the request being written to the game state being read: network and server.
+	LatencyHistogram parse;     // Parsing the game state.
+	LatencyHistogram bot;       // Bot::getMoves().
+
+	void reset();
+	void add(const TurnLatency& other);
+	// Prints a row for each phase, with its count, p50, p99, and max in milliseconds.
+	void print(std::ostream& out, const std::string& title) const;
+};
@@ -0,0 +1,148 @@
+#pragma once
+
+#include "GameInfo.h"
+#include "Simulator.h"
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+// Define the Win32 version to be Windows 10; boost::asio complains if it's not defined.
+#if defined(_MSC_VER) && !defined(_WIN32_WINNT)
+#define _WIN32_WINNT 0x0A00
+#endif
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+//---------------------------------------------------------------------------------------------------------------------
+// LoopbackLobby stands in for the Node lobby (lobby/src/lobby.ts) so GameClient can be run and measured on one machine.
+// It serves the endpoints the client uses with the same JSON: POST /players, GET /players, GET /games, and
+// POST /games/<name>. Games are played by Simulator and paced like PaperIO, so each batch of moves waits for every
+// player (but at least the min turn wait) or the max turn wait, whichever comes first. It can also serve canned game
+// states from a file instead, which takes the simulator out of the measurement.
+//
+// Non-persistent players get a new open game, which starts when enough players have joined. Persistent players join
+// the one persistent game, which always runs. There is no admin API, visualization, or history.
+//
+// Everything runs on the io_context's thread, so only one thread may run it.
+//---------------------------------------------------------------------------------------------------------------------
+class LoopbackLobby
+{
+public: // Types
+	typedef std::chrono::steady_clock Clock;
+
+	struct Options
+	{
+		unsigned short port = 8080;                        // 0 picks a free port; see getPort().
+		int playersPerGame = 2;                            // Open games start when this many players have joined,
+		std::chrono::milliseconds startWait{ 5000 };       // or after this long if at least two have.
+		std::chrono::milliseconds minTurnWait{ 40 };       // The InputWaiter in lobby/src/games/paperio.ts.
+		std::chrono::milliseconds maxTurnWait{ 500 };
+		std::chrono::milliseconds gameLength{ 120000 };    // Games shut down after this long, like the server.
+		int width = Simulator::DEFAULT_WIDTH;
+		int height = Simulator::DEFAULT_HEIGHT;
+		int viewRadius = 0;                                // The view around each player. 0 uses the server's formula.
+		unsigned seed = 0;
+		std::vector<std::string> cannedStates;             // If set, sent round robin instead of simulated states.
+		bool quiet = false;                                // Only report errors.
+	};
+
+public: // Methods
+	LoopbackLobby(boost::asio::io_context& ioc, const Options& options);
+	~LoopbackLobby();
+
+	// Starts accepting connections. The io_context has to be run to serve them.
+	void start();
+	void stop();
+	unsigned short getPort() const;
+
+private: // Types
+	class Session;
+	struct Game;
+
+	// A registered player. Players are looked up by their token.
+	struct Client
+	{
+		std::string name;
+		bool persistent;
+		Game* game;                   // The game they're in, if any.
+		Clock::time_point lastKilled; // Persistent players wait a bit before rejoining.
+	};
+
+	// A player in a game.
+	struct GamePlayer
+	{
+		Client* client;
+		int id;                             // The simulator ID. 0 until the game starts.
+		std::shared_ptr<Session> waiting;   // Where to send the next game state.
+		std::vector<Direction> moves;       // Moves queued for the next batch.
+		bool sentMoves;                     // Sent moves during the current batch.
+		int movesMissed;
+	};
+
+	struct Game
+	{
+		Game(boost::asio::io_context& ioc, const std::string& name, bool persistent, const Options& options);
+
+		std::string name;
+		bool persistent;
+		bool started;
+		bool over;
+		bool firstTurn;                 // The first batch after starting runs no turns.
+		unsigned batch;                 // Counts batches, so timers from an earlier batch can be ignored.
+		bool minTimeElapsed;
+		bool inputArrived;
+		Clock::time_point created;
+		Clock::time_point deadline;
+		Simulator sim;
+		std::vector<GamePlayer> players; // In the order they joined.
+		boost::asio::steady_timer startTimer;
+		boost::asio::steady_timer minTimer;
+		boost::asio::steady_timer maxTimer;
+	};
+
+	typedef std::shared_ptr<Session> SessionPtr;
+	typedef std::shared_ptr<Game> GamePtr; // Timer handlers hold on to their game.
+
+private: // Methods
+	void accept();
+	void handleRequest(const SessionPtr& session);
+
+	void registerPlayer(const SessionPtr& session);
+	void listPlayers(const SessionPtr& session);
+	void listGames(const SessionPtr& session, Client& client);
+	void processMove(const SessionPtr& session, Client& client, const std::string& gameName);
+	Client* authenticate(const SessionPtr& session);
+
+	GamePtr createGame(bool persistent);
+	GamePtr findGame(const std::string& name);
+	bool isEligible(const Game& game, const Client& client) const;
+	void removeOverGames();
+
+	// The game flow, from PaperIO in lobby/src/games/paperio.ts.
+	void waitToStart(const GamePtr& game);
+	void startGame(const GamePtr& game);
+	void queueMoves(const GamePtr& game, GamePlayer& player, const std::string& body);
+	void waitForInput(const GamePtr& game);
+	void allInputArrived(const GamePtr& game);
+	void runQueuedMoves(const GamePtr& game);
+	void removePlayer(Game& game, size_t index);
+	void sendGameState(Game& game, GamePlayer& player);
+
+private: // Data
+	boost::asio::io_context& m_ioc;
+	boost::asio::ip::tcp::acceptor m_acceptor;
+	Options m_options;
+
+	std::map<std::string, std::unique_ptr<Client> > m_clients; // Token => Client
+	std::vector<GamePtr> m_games;
+	int m_nextGame;
+	std::mt19937_64 m_random; // For tokens.
+	size_t m_nextCanned;
+	std::string m_state; // Reused for each game state sent.
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "GameInfo.h"
+
+#include <array>
+#include <string>
+#include <vector>
+
+#include <boost/asio/buffer.hpp>
+
+/**********************************************************************************************************************
+ * MoveRequests holds ready-to-send HTTP requests for posting moves to a game. There are only 1365 legal move lists
+ * (up to Moves::MOVES_PER_TURN moves in four directions), so every body is serialized once, up front, with its
+ * Content-Length header. The request line and the rest of the headers are built once per game. Sending moves is then
+ * a matter of writing two existing buffers to the socket.
+ *********************************************************************************************************************/
+class MoveRequests
+{
+public: // Types
+	typedef std::array<boost::asio::const_buffer, 2> Buffers;
+
+public: // Methods
+	// Builds the request line and headers for posting moves to the game at target (an encoded URI).
+	void prepare(const std::string& host, const std::string& target, const std::string& token);
+	bool isPrepared() const { return !m_head.empty(); }
+	void clear() { m_head.clear(); }
+
+	// Gets the request that sends moves. Returns false if prepare() hasn't been called.
+	bool getRequest(const Moves& moves, Buffers& buffers) const;
+
+	// The position of the moves in the table. Moves only holds legal moves, so every list is in it.
+	static int getIndex(const Moves& moves);
+
+private: // Methods
+	static const std::vector<std::string>& getBodies();
+
+private: // Data
+	std::string m_head; // The request line and every header except Content-Length.
+};
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "GameInfo.h"
+#include "WorldMap.h"
+
+#include <string>
+#include <unordered_map>
+
+/**********************************************************************************************************************
+ * The odds for an opponent's next batch of moves. Each move goes straight, right, or left (never back). home is the
+ * chance they're back in their territory by the end of the batch, which a rollout can play by heading there.
+ *********************************************************************************************************************/
+struct MoveOdds
+{
+	float straight;
+	float right;
+	float left;
+	float home;
+};
+
+/**********************************************************************************************************************
+ * OpponentModel learns how each opponent moves by watching them from turn to turn: how often they turn, which way, and
+ * how long they stay out of their territory before heading back. getOdds() turns that into MoveOdds for the next batch,
+ * so a search can play out what an opponent is likely to do rather than anything at all.
+ *
+ * Each turn only shows where a player ended up after a batch of Moves::MOVES_PER_TURN moves, not the moves themselves.
+ * A batch that ends where going straight would have went straight, and one that turned once shows which way, but
+ * there's no telling how many times the rest turned. So the chance of going straight on each move comes from how many
+ * batches went straight all the way (it's that chance to the fifth power), and which way they turn comes from the
+ * batches that turned once. Only batches seen from start to end count, so players that come and go from view teach it
+ * less.
+ *
+ * Profiles are kept by name, since that's what stays the same when a player dies and rejoins a persistent game. Until
+ * a player has been seen for MIN_BATCHES batches, getOdds() gives the defaults.
+ *********************************************************************************************************************/
+class OpponentModel
+{
+public: // Types
+	enum { MIN_BATCHES = 10, MAX_TRIP_BATCHES = 12 };
+
+	struct Profile
+	{
+		Profile();
+
+		// From every batch seen.
+		int batches;
+		int straightBatches; // Batches that didn't turn at all.
+		int rightTurns;     // In the batches that turned once.
+		int leftTurns;
+
+		// From every trip seen from leaving their territory to getting back.
+		int trips;
+		int tripBatches;    // All of the trips' batches, for their average length.
+		int tripEnds[MAX_TRIP_BATCHES + 1]; // How many trips took each number of batches, the last for that many or more.
+
+		// Where they were when we last saw them.
+		int lastSeen;       // The update() that was.
+		Position pos;
+		DirectionCode dir;
+		int trip;           // Batches out of their territory so far, or -1 if we didn't see them leave.
+
+		// What getOdds() gives, by batches out of their territory. Worked out when they're seen.
+		MoveOdds odds[MAX_TRIP_BATCHES + 1];
+	};
+
+public: // Methods
+	OpponentModel();
+
+	// Forgets everyone, as when a new game starts.
+	void clear();
+
+	// Learns from this turn. Call once a turn, after updating the world map with it. selfId is skipped.
+	void update(const GameInfo& gameInfo, const WorldMap& world, int selfId);
+
+	// What we know about the player, or null if we've never seen them.
+	const Profile* find(const std::string& name) const;
+
+	// The odds for the player's next batch, given how many batches they've been out of their territory (0 if they're
+	// in it). Finding the profile once and keeping it is faster when asking about the same player many times.
+	MoveOdds getOdds(const std::string& name, int tripBatches) const { return getOdds(find(name), tripBatches); }
+	static MoveOdds getOdds(const Profile* profile, int tripBatches);
+
+	// What getOdds() gives for players it doesn't know.
+	static MoveOdds getDefaultOdds(int tripBatches);
+
+private: // Methods
+	void learnBatch(Profile& profile, const Player& player) const;
+	void updateOdds(Profile& profile) const;
+
+private: // Data
+	std::unordered_map<std::string, Profile> m_profiles;
+	int m_turn;             // Counts update()s.
+};
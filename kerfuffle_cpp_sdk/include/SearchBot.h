@@ -0,0 +1,181 @@
+#pragma once
+
+#include "BitBoard.h"
+#include "Bot.h"
+#include "CaptureFinder.h"
+#include "GameInfo.h"
+#include "OpponentModel.h"
+#include "Simulator.h"
+#include "TranspositionTable.h"
+#include "WorldMap.h"
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+
+/**********************************************************************************************************************
+ * RolloutPolicy picks a player's next batch of moves in SearchBot's simulations: the opponents' moves all the way
+ * through, and ours past the end of the tree. Better guesses make for better searches, but it runs for every player in
+ * every simulated batch, so it has to be cheap.
+ *********************************************************************************************************************/
+class RolloutPolicy
+{
+public: // Methods
+	virtual ~RolloutPolicy() {}
+
+	// Called with the board at the start of each turn's search, for anything better worked out once than in every
+	// simulation. The simulations are copies of this board, so its player IDs hold for all of them.
+	virtual void prepare(const Simulator& /*sim*/, int /*searcherId*/) {}
+
+	// The moves for playerId in the simulation. searcherId is the player searching, in case opponents treat it specially.
+	virtual Moves getMoves(const Simulator& sim, int playerId, int searcherId, std::mt19937& random) = 0;
+};
+
+/**********************************************************************************************************************
+ * The rollout SearchBot uses unless it's given another. Players wander, mostly in straight lines; head home, more
+ * likely the longer their trail; and, if they're an opponent close to the searcher's trail, go for it. That last part
+ * is what makes long trips look as dangerous as they are.
+ *
+ * How often each player turns and when they head home come from an OpponentModel if it's given one and knows them, and
+ * from OpponentModel::getDefaultOdds() otherwise.
+ *********************************************************************************************************************/
+class DefaultRollout : public RolloutPolicy
+{
+public: // Methods
+	explicit DefaultRollout(const OpponentModel* model = nullptr) : m_model(model) {}
+
+	virtual void prepare(const Simulator& sim, int searcherId);
+	virtual Moves getMoves(const Simulator& sim, int playerId, int searcherId, std::mt19937& random);
+
+	// The searcher heads home for sure by this many batches out; opponents go by their odds.
+	enum { ATTACK_RANGE = 8, SELF_TRIP_BATCHES = 5 };
+
+private: // Methods
+	bool findAttack(const Simulator& sim, const SimPlayer& player, int searcherId, Position& target) const;
+	bool findHome(const Simulator& sim, const SimPlayer& player, Position& target) const;
+
+private: // Data
+	const OpponentModel* m_model;
+	std::vector<const OpponentModel::Profile*> m_profiles; // By simulator ID, from prepare().
+};
+
+/**********************************************************************************************************************
+ * SearchBot plans with Monte Carlo tree search, taking each batch of Moves::MOVES_PER_TURN moves as one action. Each
+ * simulation copies the board into a Simulator (the server's rules), walks down the tree picking our batches by UCT,
+ * picks everyone else's with the RolloutPolicy, plays on for a few more batches with the policy, and scores how our
+ * territory changed and how exposed we were left.
+ *
+ * The tree only branches on our moves; the opponents' are drawn again in each simulation, so a node's statistics
+ * average over what they might do. Our own moves are deterministic, so each node knows where we'd be, and batches that
+ * leave the board or turn straight back are never considered. Nodes reveal their children a few at a time as they're
+ * visited more (progressive widening), best first: at the root, by CaptureEstimator's guess at what each batch gains,
+ * and elsewhere, straightest first.
+ *
+ * It searches until the turn's deadline (or Settings::thinkTime, if that's sooner), then plays the most visited batch.
+ * If we end up where that batch said we would, the next turn starts from its subtree instead of from scratch, with the
+ * root given every batch again as it would be at a new root. Rewards count from our score when the search starts, so
+ * if that's changed (we captured, or lost territory), what the subtree learned is rebased onto the new score.
+ *
+ * It watches the opponents with an OpponentModel, which the default rollout plays them by. Custom rollouts can use it
+ * too, from getOpponentModel().
+ *
+ * Different batches often lead to the same place: around our territory, RRDD and DDRR end up the same, and a batch from
+ * last turn's tree can meet one from this turn's. So the statistics are also kept in a TranspositionTable, keyed by our
+ * part of the simulator's Zobrist hash (our territory, trail, position and direction) and how many batches ahead it
+ * is. Our part only, since the opponents play differently in every simulation anyway. A node uses the table's numbers
+ * when they're from more simulations than its own, and a new node whose state the table already knows well takes its
+ * value from there instead of playing a rollout.
+ *********************************************************************************************************************/
+class SearchBot : public Bot
+{
+public: // Types
+	struct Settings
+	{
+		Settings();
+
+		std::chrono::milliseconds thinkTime; // The most to spend on a turn. 0 means until GameInfo::deadline.
+		int rolloutBatches;                  // How many batches to play past the tree.
+		double exploration;                  // UCT's exploration constant.
+		bool useTable;                       // Whether to keep statistics in a TranspositionTable too.
+		unsigned seed;
+	};
+
+	struct Stats
+	{
+		int simulations; // In the last getMoves().
+		int nodes;       // In the tree after it.
+		bool reused;     // Whether it started from last turn's tree.
+		int transpositions; // Simulations that ended at a state the transposition table knew, without a rollout.
+	};
+
+public: // Methods
+	SearchBot();
+	// Without a table, it makes its own of the default size, unless Settings::useTable is off. init() clears it, and
+	// each getMoves() starts a new search.
+	explicit SearchBot(const Settings& settings, std::shared_ptr<RolloutPolicy> rollout = nullptr,
+		std::shared_ptr<TranspositionTable> table = nullptr);
+
+	virtual void init(int boardWidth, int boardHeight);
+	virtual Moves getMoves(const GameInfo& gameInfo);
+
+	const Stats& getStats() const { return m_stats; }
+	const OpponentModel& getOpponentModel() const { return m_opponents; }
+
+	enum { MAX_NODES = 1 << 18, MAX_CHILDREN = 24 };
+
+private: // Types
+	typedef std::chrono::steady_clock Clock;
+
+	struct Node
+	{
+		uint16_t moves;     // The packed batch that led here.
+		uint8_t dir;        // Our DirectionCode after it.
+		int16_t x;          // Our position after it.
+		int16_t y;
+		uint16_t childCount;
+		int firstChild;     // Children are contiguous, best first. -1 until expanded.
+		int visits;
+		float total;        // Of the rewards.
+		uint64_t key;       // For the transposition table, from the last time the batch was played. 0 until then.
+		TranspositionTable::Entry pooled; // The table's entry for key, as of the last visit.
+	};
+
+private: // Methods
+	void updateTrail(const Player& player);
+	void loadState(const GameInfo& gameInfo);
+	bool reuseTree(const Player& player);
+	void rebaseRewards(int scoreChange);
+	void expand(int nodeIndex, bool useEstimator);
+	int select(const Node& node);
+	uint64_t getKey(int depth) const;
+	double simulate(bool& fromTable);
+	bool playBatch(Moves moves);
+	double evaluate() const;
+	int addNode(Moves moves, const Position& pos, DirectionCode dir);
+
+private: // Data
+	Settings m_settings;
+	OpponentModel m_opponents;
+	std::shared_ptr<RolloutPolicy> m_rollout;
+	std::shared_ptr<TranspositionTable> m_table;
+	std::mt19937 m_random;
+	WorldMap m_world;
+	PlayerBitBoards m_bitBoards;
+	CaptureEstimator m_estimator;
+	std::vector<Position> m_trail;       // Ours since we left our territory, starting with the last space we owned.
+	std::vector<Position> m_plannedPath; // Where last turn's batch should have taken us.
+
+	Simulator m_root;                    // The board as we last saw it. Persistent, so it plays on with one player.
+	Simulator m_sim;                     // Scratch for each simulation.
+	int m_selfId;                        // Our ID in the simulators.
+	int m_startScore;
+	int m_turn;                          // Counts getMoves(), so table keys from different turns line up.
+
+	std::vector<Node> m_nodes;           // m_nodes[0] is the root.
+	std::vector<Node> m_oldNodes;        // Scratch for reusing the tree.
+	std::vector<int> m_path;             // The nodes visited by the current simulation.
+	int m_played;                        // The node for the batch we played last turn, or -1.
+	Stats m_stats;
+};
@@ -0,0 +1,140 @@
+#pragma once
+
+#include "GameInfo.h"
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+/**********************************************************************************************************************
+ * A single space on the simulated board. IDs are simulator player IDs; 0 means no player.
+ *********************************************************************************************************************/
+struct SimCell
+{
+	uint8_t owner; // The player who owns this space.
+	uint8_t trail; // The player whose trail is on this space.
+};
+
+/**********************************************************************************************************************
+ * The state of one player in the simulator.
+ *********************************************************************************************************************/
+class SimPlayer
+{
+public:
+	int id;                   // The simulator ID, used in the board data. Between 1 and Simulator::MAX_PLAYERS.
+	std::string name;         // The name of the player.
+	int score;                // The number of spaces owned by the player.
+	Position pos;             // The player's current position.
+	Direction dir;            // The player's current direction.
+	int movesMissed;          // The number of batches in a row the player failed to send moves for.
+	bool alive;               // Whether or not the player is still in the game.
+	std::vector<int> trail;   // Board indices where this player laid its trail. May contain stale entries.
+	int minX, minY;           // A bounding box around every space the player has owned or had a trail on. It only
+	int maxX, maxY;           // grows, so it may be larger than needed, but it limits the board scans in a capture.
+};
+
+/**********************************************************************************************************************
+ * Simulator is an in-process port of the server's game rules (PaperIOState in lobby/src/games/paperio/paperiogame.ts).
+ * It reproduces the server turn by turn: players move in score order, heads that meet outside their owner's territory
+ * die, running over a trail kills its owner, returning home captures the enclosed area, and players with no area
+ * left or too many missed batches are removed.
+ *
+ * The simulator runs single turns. To mirror the server, set each player's direction from its queued moves before
+ * every turn, and run Moves::MOVES_PER_TURN turns per batch.
+ *********************************************************************************************************************/
+class Simulator
+{
+public: // Methods
+	Simulator(int width = DEFAULT_WIDTH, int height = DEFAULT_HEIGHT, bool persistent = false, unsigned seed = 0);
+	void reset();
+
+	// Adds the players the game starts with, spaced evenly on an ellipse around the center of the board.
+	void addStartingPlayers(const std::vector<std::string>& names);
+	// Adds a player at a random open location, as when joining a persistent game. Returns the player ID.
+	int addPlayer(const std::string& name);
+	// Adds a player at the given location and gives them the 5x5 starting area. Returns the player ID.
+	int addPlayer(const std::string& name, int x, int y);
+	// Adds a player without claiming any spaces. Use with setCell() and recomputeScores() to load a saved state.
+	int restorePlayer(const std::string& name, const Position& pos, const Direction& dir);
+
+	void setDirection(int playerId, const Direction& dir);
+	void setMovesMissed(int playerId, int movesMissed);
+	void setTurnLimit(int turns) { m_turnLimit = turns; }
+	void setViewRadius(int radius) { m_viewRadius = radius; } // 0 uses the server's formula.
+
+	// Runs a single turn. This is PaperIOState.turn().
+	void turn();
+	void kill(int playerId);
+	void shutdown();
+
+	// Fills in the data a player receives from the server, including the limited view around the player.
+	void getGameInfo(int playerId, GameInfo& gameInfo) const;
+	// Writes the JSON the server sends a player each turn. This is playerStatusString() on the server.
+	void getGameState(int playerId, std::string& json) const;
+	int getViewRadius(int playerId) const;
+
+	int getWidth() const { return m_width; }
+	int getHeight() const { return m_height; }
+	int getTurn() const { return m_turn; }
+	bool isOver() const { return m_over; }
+	int getIndex(int x, int y) const { return y * m_width + x; }
+	const SimCell& getCell(int x, int y) const { return m_cells[getIndex(x, y)]; }
+	const std::vector<SimCell>& getCells() const { return m_cells; }
+	void setCell(int x, int y, int ownerId, int trailId);
+	void recomputeScores();
+
+	// A Zobrist hash of the game: each space's owner and trail, and each live player's position and direction. It's
+	// kept up to date as they change, so reading it costs nothing. getPlayerHash() is the part that's the player's own
+	// (their territory, trail, position and direction); getHash() is all of them together.
+	uint64_t getHash() const { return m_hash; }
+	uint64_t getPlayerHash(int playerId) const { return m_playerHashes[playerId]; }
+
+	bool isAlive(int playerId) const { return playerId > 0 && playerId <= MAX_PLAYERS && m_players[playerId].alive; }
+	const SimPlayer& getPlayer(int playerId) const { return m_players[playerId]; }
+	const std::vector<int>& getPlayerIds() const { return m_order; } // The live players in the order they joined.
+	int getPlayerCount() const { return (int)m_order.size(); }
+
+	enum { DEFAULT_WIDTH = 162, DEFAULT_HEIGHT = 108, MAX_PLAYERS = 254, MAX_MOVES_MISSED = 5 };
+
+private: // Methods
+	int allocatePlayer(const std::string& name);
+	void claimStartingArea(const SimPlayer& player);
+	void getViewBounds(int playerId, int& left, int& top, int& right, int& bottom) const;
+	bool isEmpty(int x, int y) const;
+	void setOwner(int index, int playerId);
+	void setTrail(int index, int playerId);
+	void toggleHash(int playerId, uint64_t key);
+	void toggleHead(const SimPlayer& player);
+	void extendBounds(SimPlayer& player, int index);
+	void claim(SimPlayer& player, const Position& nextPos);
+	bool fillEnclosedAreas(const SimPlayer& player, const Position& pos);
+	int getFillSource(int x, int y, int playerId) const;
+	void fillPoly(int startX, int startY, int playerId);
+	void addVerticalEdge(int x, int y);
+
+private: // Data
+	int m_width;
+	int m_height;
+	bool m_persistent;          // Persistent games keep running when players die.
+	bool m_over;
+	int m_turn;                 // The number of turns run so far.
+	int m_turnLimit;            // Stands in for the server's two minute deadline. 0 means no limit.
+	int m_viewRadius;           // Overrides the server's view radius. 0 means no override.
+	int m_nextId;               // The next ID to try when adding a player.
+	std::mt19937 m_random;
+
+	std::vector<SimCell> m_cells;      // width * height spaces.
+	std::vector<SimPlayer> m_players;  // Indexed by player ID. Index 0 is unused.
+	std::vector<int> m_order;          // IDs of live players in the order they joined.
+	uint64_t m_hash;
+	std::vector<uint64_t> m_playerHashes; // Indexed by player ID.
+
+	// Scratch space reused each turn so turns don't allocate.
+	std::vector<int> m_sorted;
+	std::vector<int> m_targets;
+	std::vector<uint8_t> m_toKill;
+	std::vector<std::vector<int> > m_verticalEdges; // Y => sorted X values of polygon edges, as in fillEnclosedAreas().
+	std::vector<std::pair<int, int> > m_polyEdges;
+	std::vector<int> m_spacesToClaim;
+};
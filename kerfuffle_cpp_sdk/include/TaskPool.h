@@ -0,0 +1,211 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**********************************************************************************************************************
+ * TaskPool spreads a loop over several threads, for a bot that wants to score many candidates (or run several searches)
+ * inside one getMoves(). The thread calling parallelFor() works too, so a pool of N workers starts N - 1 threads.
+ *
+ * Work is shared by stealing. The whole range starts with the calling thread; whoever holds a range bigger than the
+ * grain splits it, keeping the first half and leaving the second where idle workers can steal it. That keeps workers
+ * busy when some indices take much longer than others, without guessing a chunk size up front.
+ *
+ * Indices that haven't started by the deadline, or after cancel(), are skipped, so a loop finishes in time for the
+ * turn even if there was more work than time. parallelFor() returns how many ran. mapReduce() combines the results in
+ * index order on the calling thread, so the answer doesn't depend on which worker ran what.
+ *
+ * Loops don't nest, and one pool runs one loop at a time. Make the pool once (e.g. in the bot's constructor); its threads
+ * sleep between loops. Within a loop, a worker with nothing to steal tries again for a moment, then sleeps until there's
+ * a range to steal or the loop is done, so it doesn't take the core from one that's working.
+ *********************************************************************************************************************/
+class TaskPool
+{
+public: // Types
+	typedef std::chrono::steady_clock Clock;
+
+	// Called with the index and the worker running it, from 0 to getWorkerCount() - 1. See PerWorker.
+	typedef std::function<void(int index, int worker)> Body;
+
+public: // Methods
+	// 0 workers means one per core.
+	explicit TaskPool(int workers = 0);
+	~TaskPool();
+
+	int getWorkerCount() const { return (int)m_workers.size(); }
+
+	// Runs body for each index in [0, count), returning how many ran. Ranges of grain indices or fewer aren't split.
+	int parallelFor(int count, const Body& body, Clock::time_point deadline = Clock::time_point::max(), int grain = 1);
+
+	// Runs map(index, worker) for each index and folds the results into init with reduce(total, result), in index order.
+	// Skipped indices are left out. ran, if given, is set to how many weren't.
+	template<typename T, typename Map, typename Reduce>
+	T mapReduce(int count, T init, Map map, Reduce reduce, Clock::time_point deadline = Clock::time_point::max(),
+		int* ran = nullptr);
+
+	// Skips the rest of the current loop. Safe to call from the body.
+	void cancel() { m_cancelled = true; }
+
+	enum { SPIN_TRIES = 64 }; // Yields while waiting before a thread sleeps.
+
+private: // Types
+	struct Range
+	{
+		int begin;
+		int end;
+	};
+
+	// Each worker's ranges. It takes from the back; thieves take from the front, where the biggest ranges are.
+	struct Worker
+	{
+		std::mutex mutex;
+		std::deque<Range> ranges;
+	};
+
+	// What mapReduce() keeps between loops, so it only allocates when the count grows or the result type changes.
+	struct ResultsBase
+	{
+		virtual ~ResultsBase() {}
+	};
+
+	template<typename T>
+	struct Results : ResultsBase
+	{
+		// Each result has its own flag, in its own bytes. A std::vector<bool> packs them into shared words, which
+		// workers can't write at once.
+		struct Entry
+		{
+			T value;
+			bool done;
+		};
+		std::vector<Entry> entries;
+	};
+
+private: // Methods
+	void work(int worker);
+	void runLoop(int worker);
+	bool takeRange(int worker, Range& range);
+	void runRange(int worker, Range range);
+	template<typename Ready>
+	void waitUntil(Ready ready);
+	void notifyIdle();
+
+private: // Data
+	std::vector<std::unique_ptr<Worker> > m_workers;
+	std::vector<std::thread> m_threads;
+
+	std::mutex m_wakeMutex;
+	std::condition_variable m_wake;
+	unsigned m_generation;            // Counts loops, so sleeping workers can tell a new one started.
+	bool m_stopping;
+
+	// The current loop.
+	const Body* m_body;
+	Clock::time_point m_deadline;
+	int m_grain;
+	std::atomic<int> m_remaining;     // Indices not yet run or skipped.
+	std::atomic<int> m_ran;
+	std::atomic<int> m_active;        // Workers inside runLoop().
+	std::atomic<bool> m_cancelled;
+	std::atomic<unsigned> m_pushes;   // Ranges split off, so sleeping workers can tell there's something to steal.
+
+	// Workers waiting for something to steal, and parallelFor() waiting for them to finish, sleep on m_idle.
+	std::condition_variable m_idle;
+	std::atomic<int> m_sleeping;
+
+	std::unique_ptr<ResultsBase> m_results;
+};
+
+/**********************************************************************************************************************
+ * PerWorker holds one T for each of a pool's workers, for scratch a loop body reuses from index to index, e.g. a
+ * Simulator to play candidates in. Index it with the worker the body was given. Each T gets its own cache lines, so
+ * workers writing to theirs don't slow each other down.
+ *********************************************************************************************************************/
+template<typename T>
+class PerWorker
+{
+public: // Methods
+	explicit PerWorker(const TaskPool& pool) : m_slots(pool.getWorkerCount()) {}
+	PerWorker(const TaskPool& pool, const T& value) : m_slots(pool.getWorkerCount(), Slot{ value, {} }) {}
+
+	T& operator[](int worker) { return m_slots[worker].value; }
+	const T& operator[](int worker) const { return m_slots[worker].value; }
+	int size() const { return (int)m_slots.size(); }
+
+private: // Types
+	struct Slot
+	{
+		T value;
+		char padding[64];
+	};
+
+private: // Data
+	std::vector<Slot> m_slots;
+};
+
+/**********************************************************************************************************************
+ *********************************************************************************************************************/
+template<typename T, typename Map, typename Reduce>
+T TaskPool::mapReduce(int count, T init, Map map, Reduce reduce, Clock::time_point deadline, int* ran)
+{
+	Results<T>* results = dynamic_cast<Results<T>*>(m_results.get());
+	if (!results)
+	{
+		results = new Results<T>();
+		m_results.reset(results);
+	}
+	std::vector<typename Results<T>::Entry>& entries = results->entries;
+	if ((int)entries.size() < count)
+	{
+		entries.resize(count);
+	}
+	for (int i = 0; i < count; i++)
+	{
+		entries[i].done = false;
+	}
+
+	int total = parallelFor(count, [&](int index, int worker)
+	{
+		entries[index].value = map(index, worker);
+		entries[index].done = true;
+	}, deadline);
+
+	for (int i = 0; i < count; i++)
+	{
+		if (entries[i].done)
+		{
+			init = reduce(init, entries[i].value);
+		}
+	}
+	if (ran)
+	{
+		*ran = total;
+	}
+	return init;
+}
+
+template<typename Ready>
+void TaskPool::waitUntil(Ready ready)
+{
+	// Whatever we're waiting on is usually moments away, so try a few times before paying to sleep and be woken.
+	for (int tries = 0; tries < SPIN_TRIES; tries++)
+	{
+		if (ready())
+		{
+			return;
+		}
+		std::this_thread::yield();
+	}
+
+	std::unique_lock<std::mutex> lock(m_wakeMutex);
+	m_sleeping++;
+	m_idle.wait(lock, ready);
+	m_sleeping--;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "DistanceField.h"
+#include "GameInfo.h"
+
+#include <vector>
+
+/**********************************************************************************************************************
+ * How a plan fares in the race between us getting home and an enemy getting to our trail. margin is how many moves we
+ * have to spare; at zero or below, an enemy can cut our trail before we're home.
+ *********************************************************************************************************************/
+struct SafetyMargin
+{
+	int margin;       // enemyArrival - homeTime, or SAFE if the plan never leaves our territory.
+	int enemyArrival; // The fewest moves for an enemy to reach our trail, or DistanceField::UNREACHABLE.
+	int homeTime;     // The moves until we're back in our territory, or DistanceField::UNREACHABLE.
+	bool legal;       // False if the plan leaves the board or turns straight back. The rest is meaningless then.
+
+	enum { SAFE = DistanceField::UNREACHABLE };
+};
+
+/**********************************************************************************************************************
+ * TrailSafety checks plans for our next moves against the enemies: for each one, how soon an enemy could reach a space
+ * of our trail (what we have now plus what the plan lays), and how soon we'd be back home to claim it. The enemies'
+ * times come from PlayerDistances' nearest-enemy field, which ignores trails, so they're never later than the truth;
+ * ours come from its home field, following the plan and then the shortest way back. If the plan gets home and leaves
+ * again, each trip is its own race and the margin is the worse of them.
+ *
+ * Update the PlayerDistances from the turn's GameInfo (players and partialBoard) or a WorldMap, then call update() with
+ * our trail, then analyze() each plan. The trail's own race is worked out once in update(), so each plan only looks at
+ * the spaces it moves through; analyzeAll() does every plan for a turn, sharing the work for plans that start the same
+ * way.
+ *
+ * Enemies we can't see aren't in the field, so they can't be counted.
+ *********************************************************************************************************************/
+class TrailSafety
+{
+public: // Methods
+	TrailSafety();
+
+	// trail runs from the last space we owned to our head, as for CaptureEstimator; dir is the way we're heading. When
+	// we're home, it's just our position.
+	void update(const PlayerDistances& distances, const std::vector<Position>& trail, DirectionCode dir);
+
+	SafetyMargin analyze(const Moves& moves) const;
+
+	// Every plan of Moves::MOVES_PER_TURN moves, indexed by Moves::getPacked() without the count (the low 10 bits).
+	void analyzeAll(std::vector<SafetyMargin>& margins) const;
+
+	// The race for the trail we have now, if we went straight home from here.
+	SafetyMargin getCurrent() const;
+
+private: // Types
+	// Following a plan: where we are, and the race so far.
+	struct Race
+	{
+		Position pos;
+		DirectionCode dir;
+		bool out;          // Off our territory, laying trail.
+		int arrival;       // For the current trip.
+		SafetyMargin worst; // Of the trips finished so far.
+	};
+
+private: // Methods
+	bool step(Race& race, DirectionCode code, int moves) const;
+	SafetyMargin finish(const Race& race, int moves) const;
+	void analyzeFrom(const Race& race, int depth, int packed, std::vector<SafetyMargin>& margins) const;
+	static void keepWorse(SafetyMargin& worst, int arrival, int homeTime);
+
+private: // Data
+	const PlayerDistances* m_distances;
+	Race m_start;
+};
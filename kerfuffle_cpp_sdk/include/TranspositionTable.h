@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/**********************************************************************************************************************
+ * TranspositionTable keeps search statistics by state, so a state reached by different orders of moves (or found again
+ * next turn) is only worked out once. Keys are 64-bit hashes, like Simulator::getHash(); what's kept for each is a
+ * Monte Carlo tree search's visit count and reward total.
+ *
+ * The table has a fixed size, set when it's made, in buckets of two entries. The first keeps whichever state has had
+ * the most visits, since that's the most work to lose (replace-by-depth, with visits as the depth); the second always
+ * takes the newest, so new states get a chance to prove themselves. Entries from before the last newSearch() give way
+ * to anything.
+ *
+ * It can be shared between threads without locks. Each entry is two 64-bit words, the data and the key XORed with the
+ * data, each read and written atomically. A read that catches another thread's write halfway through gets a pair that
+ * doesn't check out, and counts as a miss. Two threads adding to the same entry at once can lose one of the adds; for
+ * statistics gathered by the thousand, that's cheaper than locking.
+ *********************************************************************************************************************/
+class TranspositionTable
+{
+public: // Types
+	struct Entry
+	{
+		int visits;
+		float total;  // Of the rewards.
+	};
+
+	enum { DEFAULT_MEGABYTES = 16, MAX_VISITS = (1 << 24) - 1 };
+
+public: // Methods
+	// The size is rounded down to a power of two buckets.
+	explicit TranspositionTable(size_t megabytes = DEFAULT_MEGABYTES);
+
+	void clear();
+
+	// Starts a new search, so entries from earlier ones can be replaced. Call while no other thread is using the table.
+	void newSearch();
+
+	// Fills in entry and returns true if the table has the key.
+	bool probe(uint64_t key, Entry& entry) const;
+
+	// Adds a visit with the given reward to the key's entry, making one if there isn't one, and returns the entry.
+	Entry add(uint64_t key, float reward);
+
+	size_t getEntryCount() const { return (m_mask + 1) * 2; }
+
+private: // Types
+	struct Slot
+	{
+		std::atomic<uint64_t> check; // The key XORed with data.
+		std::atomic<uint64_t> data;  // The total's bits, the generation, and the visits. 0 when it's empty.
+	};
+
+	struct Bucket
+	{
+		Slot slots[2]; // Replace-by-depth, then always-replace.
+	};
+
+private: // Methods
+	static uint64_t pack(const Entry& entry, unsigned generation);
+	static Entry unpack(uint64_t data);
+	static unsigned getGeneration(uint64_t data);
+	static bool read(const Slot& slot, uint64_t key, uint64_t& data);
+	static void write(Slot& slot, uint64_t key, uint64_t data);
+	void promote(Bucket& bucket) const;
+
+private: // Data
+	std::unique_ptr<Bucket[]> m_buckets;
+	size_t m_mask;         // Buckets - 1, for picking one from a key's low bits.
+	unsigned m_generation; // Counts newSearch()es, in 8 bits.
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "GameInfo.h"
+
+#include <vector>
+
+/**********************************************************************************************************************
+ * WorldMap remembers the whole board. Each turn the bot only sees the window in GameInfo::partialBoard; update() copies
+ * it in at its boardOffset and marks those spaces as seen this turn. Spaces outside the window keep whatever was last
+ * seen there, and getAge() says how old that is.
+ *
+ * Call init() when the game starts (from Bot::init()), then update() once per turn before using the map. Updates only
+ * touch the window, and nothing is reallocated after init().
+ *********************************************************************************************************************/
+class WorldMap
+{
+public: // Methods
+	WorldMap();
+
+	// Sizes the map for the board and forgets everything.
+	void init(int boardWidth, int boardHeight);
+
+	// Copies the view into the map, starting a new turn. Calls init() first if the board size changed. A view without
+	// its cells, as when the game is over, is skipped.
+	void update(const GameInfo& gameInfo);
+	void update(const PartialBoard& view);
+
+	int getWidth() const { return m_board.width; }
+	int getHeight() const { return m_board.height; }
+	bool isOnBoard(int x, int y) const { return x >= 0 && y >= 0 && x < m_board.width && y < m_board.height; }
+	bool isOnBoard(const Position& pos) const { return isOnBoard(pos.x, pos.y); }
+
+	// The number of updates so far. Spaces seen in the latest update have this as their last seen turn.
+	int getTurn() const { return m_turn; }
+
+	// The owner and trail last seen at the space. Player::NO_PLAYER if it's empty or was never seen.
+	int getOwnerId(int x, int y) const { return m_board.getOwnerId(x, y); }
+	int getOwnerId(const Position& pos) const { return m_board.getOwnerId(pos); }
+	int getTrailId(int x, int y) const { return m_board.getTrailId(x, y); }
+	int getTrailId(const Position& pos) const { return m_board.getTrailId(pos); }
+
+	// The turn the space was last seen, or NEVER_SEEN.
+	int getLastSeen(int x, int y) const { return m_lastSeen[m_board.getIndex(x, y)]; }
+	int getLastSeen(const Position& pos) const { return m_lastSeen[m_board.getIndex(pos)]; }
+
+	// How many turns ago the space was seen: 0 if it's in the current view. Never seen spaces are older than any other.
+	int getAge(int x, int y) const { return m_turn - getLastSeen(x, y); }
+	int getAge(const Position& pos) const { return m_turn - getLastSeen(pos); }
+	bool isVisible(int x, int y) const { return getLastSeen(x, y) == m_turn; }
+	bool isVisible(const Position& pos) const { return getLastSeen(pos) == m_turn; }
+	bool isKnown(int x, int y) const { return getLastSeen(x, y) != NEVER_SEEN; }
+	bool isKnown(const Position& pos) const { return getLastSeen(pos) != NEVER_SEEN; }
+
+	// The whole board as last seen, for code that works on a Board.
+	const Board& getBoard() const { return m_board; }
+
+	enum { NEVER_SEEN = -1 };
+
+private: // Data
+	Board m_board;               // Full board sized, indexed like any Board.
+	std::vector<int> m_lastSeen; // The turn each space was last seen, indexed like m_board.
+	int m_turn;
+};
@@ -0,0 +1,309 @@
+#include "Arena.h"
+#include "TaskPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <memory>
+#include <numeric>
+#include <ostream>
+#include <random>
+#include <stdexcept>
+
+namespace
+{
+	const int ELO_ITERATIONS = 10000;
+	const double ELO_TOLERANCE = 1e-10;
+	const double PRIOR_GAMES = 1;        // Drawn games added to each pairing played, so a clean sweep isn't infinite.
+	const double Z_95 = 1.96;
+	const std::chrono::milliseconds DEADLINE_MARGIN(20); // As in GameClient, or a quarter of a shorter turn.
+
+	double toMilliseconds(std::chrono::nanoseconds time)
+	{
+		return time.count() / 1e6;
+	}
+}
+
+Arena::Arena(const Options& options) :
+	m_options(options),
+	m_seconds(0)
+{
+}
+
+void Arena::addBot(const std::string& name, const BotFactory& factory)
+{
+	m_bots.push_back(Entrant{ name, factory });
+}
+
+void Arena::run(std::ostream* progress)
+{
+	if (m_bots.empty() || m_options.playersPerGame < 2)
+	{
+		throw std::runtime_error("an arena needs bots and at least two players a game");
+	}
+
+	Clock::time_point start = Clock::now();
+	TaskPool pool(m_options.threads);
+	PerWorker<std::vector<LatencyHistogram> > decisions(pool, std::vector<LatencyHistogram>(m_bots.size()));
+	std::vector<std::vector<Seat> > results(m_options.games);
+	int done = 0;
+	int reportEvery = std::max(m_options.games / 20, 1);
+
+	pool.parallelFor(m_options.games, [&](int game, int worker)
+	{
+		playGame(game, results[game], decisions[worker]);
+
+		std::lock_guard<std::mutex> lock(m_progressMutex);
+		done++;
+		if (progress && (done % reportEvery == 0 || done == m_options.games))
+		{
+			std::chrono::duration<double> elapsed = Clock::now() - start;
+			*progress << done << "/" << m_options.games << " games, " << std::fixed << std::setprecision(1)
+				<< elapsed.count() << " s" << std::endl;
+		}
+	});
+	m_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+	tally(results);
+	for (int worker = 0; worker < decisions.size(); worker++)
+	{
+		for (size_t bot = 0; bot < m_bots.size(); bot++)
+		{
+			m_standings[bot].decisions.add(decisions[worker][bot]);
+		}
+	}
+}
+
+void Arena::playGame(int game, std::vector<Seat>& seats, std::vector<LatencyHistogram>& decisions) const
+{
+	// Who plays, in what seat: every bot once in a random order, then again, until the seats are filled.
+	std::seed_seq seed{ m_options.seed, (unsigned)game };
+	std::mt19937 random(seed);
+	std::vector<int> order;
+	while ((int)order.size() < m_options.playersPerGame)
+	{
+		std::vector<int> round(m_bots.size());
+		std::iota(round.begin(), round.end(), 0);
+		std::shuffle(round.begin(), round.end(), random);
+		order.insert(order.end(), round.begin(), round.end());
+	}
+	order.resize(m_options.playersPerGame);
+	std::chrono::milliseconds margin = std::min(DEADLINE_MARGIN, m_options.turnTime / 4);
+
+	Simulator sim(m_options.width, m_options.height, false, m_options.seed + game);
+	sim.setViewRadius(m_options.viewRadius);
+	sim.setTurnLimit(m_options.maxBatches * Moves::MOVES_PER_TURN);
+
+	const int count = (int)order.size();
+	std::vector<std::string> names;
+	for (int seat = 0; seat < count; seat++)
+	{
+		names.push_back(m_bots[order[seat]].name + "#" + std::to_string(seat + 1));
+	}
+	sim.addStartingPlayers(names);
+	const std::vector<int> ids = sim.getPlayerIds();
+
+	std::vector<std::unique_ptr<Bot> > bots;
+	std::vector<GameInfo> views(count);
+	std::vector<Moves> moves(count);
+	std::vector<int> movesMissed(count);
+	seats.resize(count);
+	for (int seat = 0; seat < count; seat++)
+	{
+		seats[seat] = Seat{ order[seat], 0, true, 0, 0 };
+		bots.emplace_back(m_bots[order[seat]].factory());
+		sim.getGameInfo(ids[seat], views[seat]);
+		bots[seat]->setPlayer(views[seat].players[names[seat]]);
+		bots[seat]->init(m_options.width, m_options.height);
+	}
+
+	for (int batch = 1; !sim.isOver(); batch++)
+	{
+		for (int seat = 0; seat < count; seat++)
+		{
+			if (!sim.isAlive(ids[seat]))
+			{
+				continue;
+			}
+			seats[seat].lastBatch = batch;
+
+			sim.getGameInfo(ids[seat], views[seat]);
+			Clock::time_point before = Clock::now();
+			views[seat].deadline = before + m_options.turnTime - margin;
+			moves[seat] = bots[seat]->getMoves(views[seat]);
+			Clock::duration took = Clock::now() - before;
+			decisions[seats[seat].bot].record(took);
+
+			// Late moves miss the batch, which counts toward being kicked out.
+			bool late = took > m_options.turnTime;
+			if (late)
+			{
+				moves[seat] = Moves();
+				seats[seat].lateBatches++;
+			}
+			movesMissed[seat] = late ? movesMissed[seat] + 1 : 0;
+			sim.setMovesMissed(ids[seat], movesMissed[seat]);
+		}
+
+		for (int turn = 0; turn < Moves::MOVES_PER_TURN && !sim.isOver(); turn++)
+		{
+			for (int seat = 0; seat < count; seat++)
+			{
+				if (turn < (int)moves[seat].size() && sim.isAlive(ids[seat]))
+				{
+					sim.setDirection(ids[seat], moves[seat][turn]);
+				}
+			}
+			sim.turn();
+		}
+	}
+
+	for (int seat = 0; seat < count; seat++)
+	{
+		seats[seat].alive = sim.isAlive(ids[seat]);
+		seats[seat].score = seats[seat].alive ? sim.getPlayer(ids[seat]).score : 0;
+	}
+}
+
+int Arena::compare(const Seat& a, const Seat& b)
+{
+	// Positive if a ranked above b. The living by score, then the dead by how long they lasted.
+	if (a.alive != b.alive)
+	{
+		return a.alive ? 1 : -1;
+	}
+	int difference = a.alive ? a.score - b.score : a.lastBatch - b.lastBatch;
+	return (difference > 0) - (difference < 0);
+}
+
+void Arena::tally(const std::vector<std::vector<Seat> >& results)
+{
+	const size_t count = m_bots.size();
+	m_standings.assign(count, Standing());
+	for (size_t bot = 0; bot < count; bot++)
+	{
+		m_standings[bot].name = m_bots[bot].name;
+	}
+
+	// Points and games between each pair of bots, for the Elo fit.
+	std::vector<std::vector<double> > points(count, std::vector<double>(count));
+	std::vector<std::vector<int> > games(count, std::vector<int>(count));
+	for (const std::vector<Seat>& seats : results)
+	{
+		for (size_t i = 0; i < seats.size(); i++)
+		{
+			const Seat& seat = seats[i];
+			Standing& standing = m_standings[seat.bot];
+			standing.games++;
+			standing.deaths += seat.alive ? 0 : 1;
+			standing.totalScore += seat.score;
+			standing.lateBatches += seat.lateBatches;
+
+			bool first = true;
+			for (size_t j = 0; j < seats.size(); j++)
+			{
+				int result = j == i ? 1 : compare(seat, seats[j]);
+				first = first && result > 0;
+				if (seats[j].bot != seat.bot)
+				{
+					double point = result > 0 ? 1 : result == 0 ? 0.5 : 0;
+					standing.pairGames++;
+					standing.pairPoints += point;
+					points[seat.bot][seats[j].bot] += point;
+					games[seat.bot][seats[j].bot]++;
+				}
+			}
+			standing.wins += first ? 1 : 0;
+		}
+	}
+
+	fitElo(points, games);
+}
+
+void Arena::fitElo(const std::vector<std::vector<double> >& points, const std::vector<std::vector<int> >& games)
+{
+	// Bradley-Terry: each bot has a strength, and beats another with the chance strength / (strength + theirs). The
+	// strengths that make the results most likely come from the usual fixed-point iteration (Hunter's MM algorithm).
+	const size_t count = points.size();
+	std::vector<double> strength(count, 1.0);
+	std::vector<double> next(count);
+	for (int iteration = 0; iteration < ELO_ITERATIONS; iteration++)
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			double won = 0;
+			double expected = 0;
+			for (size_t j = 0; j < count; j++)
+			{
+				if (games[i][j] > 0)
+				{
+					won += points[i][j] + PRIOR_GAMES / 2;
+					expected += (games[i][j] + PRIOR_GAMES) / (strength[i] + strength[j]);
+				}
+			}
+			next[i] = expected > 0 ? won / expected : strength[i];
+		}
+
+		// Scaled so the mean rating is 0.
+		double logMean = 0;
+		for (double value : next)
+		{
+			logMean += std::log(value) / count;
+		}
+		double change = 0;
+		for (size_t i = 0; i < count; i++)
+		{
+			next[i] /= std::exp(logMean);
+			change = std::max(change, std::abs(next[i] - strength[i]));
+		}
+		strength.swap(next);
+		if (change < ELO_TOLERANCE)
+		{
+			break;
+		}
+	}
+
+	const double scale = 400 / std::log(10.0);
+	for (size_t i = 0; i < count; i++)
+	{
+		double information = 0;
+		for (size_t j = 0; j < count; j++)
+		{
+			double p = strength[i] / (strength[i] + strength[j]);
+			information += games[i][j] * p * (1 - p);
+		}
+		m_standings[i].elo = scale * std::log(strength[i]);
+		m_standings[i].eloError = information > 0 ? Z_95 * scale / std::sqrt(information) : 0;
+	}
+}
+
+void Arena::printStandings(std::ostream& out) const
+{
+	std::vector<const Standing*> sorted;
+	for (const Standing& standing : m_standings)
+	{
+		sorted.push_back(&standing);
+	}
+	std::stable_sort(sorted.begin(), sorted.end(), [](const Standing* a, const Standing* b) { return a->elo > b->elo; });
+
+	out << std::left << std::setw(16) << "bot" << std::right << std::setw(8) << "games" << std::setw(8) << "won %"
+		<< std::setw(9) << "points %" << std::setw(8) << "elo" << std::setw(7) << "+/-" << std::setw(10) << "avg score"
+		<< std::setw(8) << "deaths" << std::setw(7) << "late" << std::setw(10) << "ms mean" << std::setw(9) << "ms p99"
+		<< std::setw(9) << "ms max" << std::endl;
+	for (const Standing* standing : sorted)
+	{
+		int games = std::max(standing->games, 1);
+		out << std::left << std::setw(16) << standing->name << std::right << std::setw(8) << standing->games
+			<< std::fixed << std::setprecision(1) << std::setw(8) << 100.0 * standing->wins / games
+			<< std::setw(9) << (standing->pairGames ? 100 * standing->pairPoints / standing->pairGames : 0.0)
+			<< std::setprecision(0) << std::setw(8) << standing->elo << std::setw(7) << standing->eloError
+			<< std::setprecision(1) << std::setw(10) << (double)standing->totalScore / games
+			<< std::setw(8) << standing->deaths << std::setw(7) << standing->lateBatches
+			<< std::setprecision(2) << std::setw(10) << toMilliseconds(standing->decisions.getMean())
+			<< std::setw(9) << toMilliseconds(standing->decisions.getPercentile(99))
+			<< std::setw(9) << toMilliseconds(standing->decisions.getMax()) << std::endl;
+	}
+
+	out << std::endl << m_options.games << " games in " << std::fixed << std::setprecision(1) << m_seconds << " s ("
+		<< std::setprecision(2) << m_options.games / std::max(m_seconds, 1e-9) << " games/s)" << std::endl;
+}
@@ -0,0 +1,514 @@
+#include "BitBoard.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define BITBOARD_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define BITBOARD_SSE2
+#endif
+
+// Each kernel handles what it can with vectors, then finishes the last few words one at a time.
+namespace
+{
+#if defined(BITBOARD_AVX2) || defined(BITBOARD_SSE2)
+	int findFirstBit(int bits)
+	{
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward(&index, (unsigned long)bits);
+		return (int)index;
+#else
+		return __builtin_ctz(bits);
+#endif
+	}
+#endif
+
+	int popcount(uint64_t word)
+	{
+#ifdef _MSC_VER
+		return (int)__popcnt64(word);
+#else
+		return __builtin_popcountll(word);
+#endif
+	}
+
+	void orWords(uint64_t* a, const uint64_t* b, int count)
+	{
+		int i = 0;
+#if defined(BITBOARD_AVX2)
+		for (; i + 4 <= count; i += 4)
+		{
+			__m256i v = _mm256_or_si256(_mm256_loadu_si256((const __m256i*)(a + i)), _mm256_loadu_si256((const __m256i*)(b + i)));
+			_mm256_storeu_si256((__m256i*)(a + i), v);
+		}
+#elif defined(BITBOARD_SSE2)
+		for (; i + 2 <= count; i += 2)
+		{
+			__m128i v = _mm_or_si128(_mm_loadu_si128((const __m128i*)(a + i)), _mm_loadu_si128((const __m128i*)(b + i)));
+			_mm_storeu_si128((__m128i*)(a + i), v);
+		}
+#endif
+		for (; i < count; i++)
+		{
+			a[i] |= b[i];
+		}
+	}
+
+	void andWords(uint64_t* a, const uint64_t* b, int count)
+	{
+		int i = 0;
+#if defined(BITBOARD_AVX2)
+		for (; i + 4 <= count; i += 4)
+		{
+			__m256i v = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)(a + i)), _mm256_loadu_si256((const __m256i*)(b + i)));
+			_mm256_storeu_si256((__m256i*)(a + i), v);
+		}
+#elif defined(BITBOARD_SSE2)
+		for (; i + 2 <= count; i += 2)
+		{
+			__m128i v = _mm_and_si128(_mm_loadu_si128((const __m128i*)(a + i)), _mm_loadu_si128((const __m128i*)(b + i)));
+			_mm_storeu_si128((__m128i*)(a + i), v);
+		}
+#endif
+		for (; i < count; i++)
+		{
+			a[i] &= b[i];
+		}
+	}
+
+	void xorWords(uint64_t* a, const uint64_t* b, int count)
+	{
+		int i = 0;
+#if defined(BITBOARD_AVX2)
+		for (; i + 4 <= count; i += 4)
+		{
+			__m256i v = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(a + i)), _mm256_loadu_si256((const __m256i*)(b + i)));
+			_mm256_storeu_si256((__m256i*)(a + i), v);
+		}
+#elif defined(BITBOARD_SSE2)
+		for (; i + 2 <= count; i += 2)
+		{
+			__m128i v = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(a + i)), _mm_loadu_si128((const __m128i*)(b + i)));
+			_mm_storeu_si128((__m128i*)(a + i), v);
+		}
+#endif
+		for (; i < count; i++)
+		{
+			a[i] ^= b[i];
+		}
+	}
+
+	void andNotWords(uint64_t* a, const uint64_t* b, int count)
+	{
+		int i = 0;
+#if defined(BITBOARD_AVX2)
+		for (; i + 4 <= count; i += 4)
+		{
+			__m256i v = _mm256_andnot_si256(_mm256_loadu_si256((const __m256i*)(b + i)), _mm256_loadu_si256((const __m256i*)(a + i)));
+			_mm256_storeu_si256((__m256i*)(a + i), v);
+		}
+#elif defined(BITBOARD_SSE2)
+		for (; i + 2 <= count; i += 2)
+		{
+			__m128i v = _mm_andnot_si128(_mm_loadu_si128((const __m128i*)(b + i)), _mm_loadu_si128((const __m128i*)(a + i)));
+			_mm_storeu_si128((__m128i*)(a + i), v);
+		}
+#endif
+		for (; i < count; i++)
+		{
+			a[i] &= ~b[i];
+		}
+	}
+
+	// Whether a & b has any bits, or a alone if b is null.
+	bool anyWords(const uint64_t* a, const uint64_t* b, int count)
+	{
+		int i = 0;
+#if defined(BITBOARD_AVX2)
+		for (; i + 4 <= count; i += 4)
+		{
+			__m256i v = _mm256_loadu_si256((const __m256i*)(a + i));
+			__m256i mask = b ? _mm256_loadu_si256((const __m256i*)(b + i)) : v;
+			if (!_mm256_testz_si256(v, mask))
+			{
+				return true;
+			}
+		}
+#elif defined(BITBOARD_SSE2)
+		for (; i + 2 <= count; i += 2)
+		{
+			__m128i v = _mm_loadu_si128((const __m128i*)(a + i));
+			if (b)
+			{
+				v = _mm_and_si128(v, _mm_loadu_si128((const __m128i*)(b + i)));
+			}
+			if (_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())) != 0xFFFF)
+			{
+				return true;
+			}
+		}
+#endif
+		for (; i < count; i++)
+		{
+			if (a[i] & (b ? b[i] : ~(uint64_t)0))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	int countWords(const uint64_t* a, int count)
+	{
+		int i = 0;
+		int total = 0;
+#if defined(BITBOARD_AVX2)
+		// Look up the count for each nibble with a shuffle, then add up the bytes (Mula's method).
+		const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+			0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+		const __m256i nibbles = _mm256_set1_epi8(0x0F);
+		__m256i sums = _mm256_setzero_si256();
+		for (; i + 4 <= count; i += 4)
+		{
+			__m256i v = _mm256_loadu_si256((const __m256i*)(a + i));
+			__m256i low = _mm256_shuffle_epi8(lookup, _mm256_and_si256(v, nibbles));
+			__m256i high = _mm256_shuffle_epi8(lookup, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibbles));
+			sums = _mm256_add_epi64(sums, _mm256_sad_epu8(_mm256_add_epi8(low, high), _mm256_setzero_si256()));
+		}
+		total = (int)(_mm256_extract_epi64(sums, 0) + _mm256_extract_epi64(sums, 1) + _mm256_extract_epi64(sums, 2) + _mm256_extract_epi64(sums, 3));
+#endif
+		for (; i < count; i++)
+		{
+			total += popcount(a[i]);
+		}
+		return total;
+	}
+
+	// Sets bits start to end of a row.
+	void setBits(uint64_t* row, int start, int end)
+	{
+		while (start < end)
+		{
+			int word = start >> 6;
+			int stop = std::min(end, (word + 1) * 64);
+			uint64_t bits = ~(uint64_t)0 << (start & 63);
+			if (stop & 63)
+			{
+				bits &= ((uint64_t)1 << (stop & 63)) - 1;
+			}
+			row[word] |= bits;
+			start = stop;
+		}
+	}
+
+	// The end of the run of spaces the same as row[start].
+	int findRunEnd(const Cell* row, int start, int width)
+	{
+		uint16_t first;
+		std::memcpy(&first, &row[start], sizeof(first));
+		int end = start + 1;
+#if defined(BITBOARD_AVX2) || defined(BITBOARD_SSE2)
+		// Compare 8 spaces at a time.
+		__m128i firsts = _mm_set1_epi16((short)first);
+		for (; end + 8 <= width; end += 8)
+		{
+			int same = _mm_movemask_epi8(_mm_cmpeq_epi16(_mm_loadu_si128((const __m128i*)(row + end)), firsts));
+			if (same != 0xFFFF)
+			{
+				return end + findFirstBit(~same) / 2;
+			}
+		}
+#endif
+		for (; end < width; end++)
+		{
+			uint16_t cell;
+			std::memcpy(&cell, &row[end], sizeof(cell));
+			if (cell != first)
+			{
+				break;
+			}
+		}
+		return end;
+	}
+
+	// Combines each word with its neighbors in the four directions: ORs them together to grow the set by a space, or
+	// ANDs them to shrink it. stride is the words per row; the words before and after in and must be readable.
+	template<bool Grow>
+	uint64_t spreadWord(const uint64_t* in, int i, int stride)
+	{
+		uint64_t word = in[i];
+		uint64_t fromLeft = (word << 1) | (in[i - 1] >> 63);
+		uint64_t fromRight = (word >> 1) | (in[i + 1] << 63);
+		return Grow ? word | fromLeft | fromRight | in[i - stride] | in[i + stride]
+			: word & fromLeft & fromRight & in[i - stride] & in[i + stride];
+	}
+
+	template<bool Grow>
+	void spreadWords(const uint64_t* in, uint64_t* out, int count, int stride)
+	{
+		int i = 0;
+#if defined(BITBOARD_AVX2)
+		for (; i + 4 <= count; i += 4)
+		{
+			__m256i word = _mm256_loadu_si256((const __m256i*)(in + i));
+			__m256i fromLeft = _mm256_or_si256(_mm256_slli_epi64(word, 1), _mm256_srli_epi64(_mm256_loadu_si256((const __m256i*)(in + i - 1)), 63));
+			__m256i fromRight = _mm256_or_si256(_mm256_srli_epi64(word, 1), _mm256_slli_epi64(_mm256_loadu_si256((const __m256i*)(in + i + 1)), 63));
+			__m256i above = _mm256_loadu_si256((const __m256i*)(in + i - stride));
+			__m256i below = _mm256_loadu_si256((const __m256i*)(in + i + stride));
+			__m256i v = Grow
+				? _mm256_or_si256(_mm256_or_si256(word, fromLeft), _mm256_or_si256(_mm256_or_si256(fromRight, above), below))
+				: _mm256_and_si256(_mm256_and_si256(word, fromLeft), _mm256_and_si256(_mm256_and_si256(fromRight, above), below));
+			_mm256_storeu_si256((__m256i*)(out + i), v);
+		}
+#elif defined(BITBOARD_SSE2)
+		for (; i + 2 <= count; i += 2)
+		{
+			__m128i word = _mm_loadu_si128((const __m128i*)(in + i));
+			__m128i fromLeft = _mm_or_si128(_mm_slli_epi64(word, 1), _mm_srli_epi64(_mm_loadu_si128((const __m128i*)(in + i - 1)), 63));
+			__m128i fromRight = _mm_or_si128(_mm_srli_epi64(word, 1), _mm_slli_epi64(_mm_loadu_si128((const __m128i*)(in + i + 1)), 63));
+			__m128i above = _mm_loadu_si128((const __m128i*)(in + i - stride));
+			__m128i below = _mm_loadu_si128((const __m128i*)(in + i + stride));
+			__m128i v = Grow
+				? _mm_or_si128(_mm_or_si128(word, fromLeft), _mm_or_si128(_mm_or_si128(fromRight, above), below))
+				: _mm_and_si128(_mm_and_si128(word, fromLeft), _mm_and_si128(_mm_and_si128(fromRight, above), below));
+			_mm_storeu_si128((__m128i*)(out + i), v);
+		}
+#endif
+		for (; i < count; i++)
+		{
+			out[i] = spreadWord<Grow>(in, i, stride);
+		}
+	}
+}
+
+/**********************************************************************************************************************
+ *********************************************************************************************************************/
+BitBoard::BitBoard() :
+	m_width(0),
+	m_height(0),
+	m_wordsPerRow(1),
+	m_lastWordMask(0),
+	m_words(2, 0)
+{
+}
+
+BitBoard::BitBoard(int width, int height) : BitBoard()
+{
+	resize(width, height);
+}
+
+void BitBoard::resize(int width, int height)
+{
+	m_width = std::max(width, 0);
+	m_height = std::max(height, 0);
+
+	// Always leave a spare bit at the end of each row, so shifting a row's last word left brings in a 0.
+	m_wordsPerRow = m_width / 64 + 1;
+	m_lastWordMask = ((uint64_t)1 << (m_width % 64)) - 1;
+	m_words.assign((m_height + 2) * m_wordsPerRow, 0);
+}
+
+void BitBoard::clear()
+{
+	std::fill(m_words.begin(), m_words.end(), 0);
+}
+
+int BitBoard::count() const
+{
+	return countWords(begin(), getWordCount());
+}
+
+bool BitBoard::isEmpty() const
+{
+	return !anyWords(begin(), nullptr, getWordCount());
+}
+
+BitBoard& BitBoard::operator|=(const BitBoard& other)
+{
+	orWords(begin(), other.begin(), getWordCount());
+	return *this;
+}
+
+BitBoard& BitBoard::operator&=(const BitBoard& other)
+{
+	andWords(begin(), other.begin(), getWordCount());
+	return *this;
+}
+
+BitBoard& BitBoard::operator^=(const BitBoard& other)
+{
+	xorWords(begin(), other.begin(), getWordCount());
+	return *this;
+}
+
+BitBoard& BitBoard::andNot(const BitBoard& other)
+{
+	andNotWords(begin(), other.begin(), getWordCount());
+	return *this;
+}
+
+bool BitBoard::intersects(const BitBoard& other) const
+{
+	return anyWords(begin(), other.begin(), getWordCount());
+}
+
+void BitBoard::dilate(BitBoard& out) const
+{
+	// Each word is worked out from the words around it, so reading and writing the same words would corrupt them.
+	if (&out == this)
+	{
+		BitBoard copy(*this);
+		copy.dilate(out);
+		return;
+	}
+
+	out.matchSize(*this);
+	spreadWords<true>(begin(), out.begin(), getWordCount(), m_wordsPerRow);
+	out.clearPadding();
+}
+
+void BitBoard::erode(BitBoard& out) const
+{
+	if (&out == this)
+	{
+		BitBoard copy(*this);
+		copy.erode(out);
+		return;
+	}
+
+	// The padding and the empty rows act as spaces outside the set, so nothing on the edge survives.
+	out.matchSize(*this);
+	spreadWords<false>(begin(), out.begin(), getWordCount(), m_wordsPerRow);
+}
+
+void BitBoard::getFrontier(BitBoard& out) const
+{
+	if (&out == this)
+	{
+		BitBoard copy(*this);
+		copy.getFrontier(out);
+		return;
+	}
+
+	dilate(out);
+	out.andNot(*this);
+}
+
+void BitBoard::getBorder(BitBoard& out) const
+{
+	if (&out == this)
+	{
+		BitBoard copy(*this);
+		copy.getBorder(out);
+		return;
+	}
+
+	// What erodes away is the border.
+	erode(out);
+	out ^= *this;
+}
+
+void BitBoard::matchSize(const BitBoard& other)
+{
+	if (m_width != other.m_width || m_height != other.m_height)
+	{
+		resize(other.m_width, other.m_height);
+	}
+}
+
+void BitBoard::clearPadding()
+{
+	// Growing to the right carries the last space of each row into the padding.
+	uint64_t* word = begin() + m_wordsPerRow - 1;
+	for (int y = 0; y < m_height; y++, word += m_wordsPerRow)
+	{
+		*word &= m_lastWordMask;
+	}
+}
+
+/**********************************************************************************************************************
+ *********************************************************************************************************************/
+void PlayerBitBoards::update(const Board& board)
+{
+	int slots = board.getSlotCount();
+	m_playerIds.resize(slots);
+	if ((int)m_territories.size() < slots)
+	{
+		m_territories.resize(slots);
+		m_trails.resize(slots);
+	}
+
+	// Slot 0 is no player. Its boards are built like the others but never handed out.
+	for (int slot = 0; slot < slots; slot++)
+	{
+		m_playerIds[slot] = board.getPlayerId(slot);
+		m_territories[slot].resize(board.width, board.height);
+		m_trails[slot].resize(board.width, board.height);
+	}
+	m_empty.resize(board.width, board.height);
+
+	// Keep a pointer to the current row of each board, rather than finding the row for every space.
+	uint64_t* territoryRows[Board::MAX_SLOTS];
+	uint64_t* trailRows[Board::MAX_SLOTS];
+	for (int slot = 0; slot < slots; slot++)
+	{
+		territoryRows[slot] = m_territories[slot].getRow(0);
+		trailRows[slot] = m_trails[slot].getRow(0);
+	}
+
+	int stride = m_empty.getWordsPerRow();
+	for (int y = 0; y < board.height; y++)
+	{
+		// Spaces mostly come in runs with the same owner and trail, so set each run's bits at once.
+		const Cell* row = board.getRow(y);
+		for (int x = 0; x < board.width;)
+		{
+			int end = findRunEnd(row, x, board.width);
+			setBits(territoryRows[row[x].owner], x, end);
+			setBits(trailRows[row[x].trail], x, end);
+			x = end;
+		}
+
+		for (int slot = 0; slot < slots; slot++)
+		{
+			territoryRows[slot] += stride;
+			trailRows[slot] += stride;
+		}
+	}
+
+	m_allTerritory = m_empty;
+	m_allTrails = m_empty;
+	for (int slot = 1; slot < slots; slot++)
+	{
+		m_allTerritory |= m_territories[slot];
+		m_allTrails |= m_trails[slot];
+	}
+}
+
+const BitBoard& PlayerBitBoards::getTerritory(int playerId) const
+{
+	int slot = findSlot(playerId);
+	return slot > 0 ? m_territories[slot] : m_empty;
+}
+
+const BitBoard& PlayerBitBoards::getTrail(int playerId) const
+{
+	int slot = findSlot(playerId);
+	return slot > 0 ? m_trails[slot] : m_empty;
+}
+
+int PlayerBitBoards::findSlot(int playerId) const
+{
+	for (int slot = 1; slot < (int)m_playerIds.size(); slot++)
+	{
+		if (m_playerIds[slot] == playerId)
+		{
+			return slot;
+		}
+	}
+	return Board::NO_SLOT;
+}
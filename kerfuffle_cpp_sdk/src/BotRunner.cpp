@@ -0,0 +1,175 @@
+#include "BotRunner.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <map>
+
+#include <boost/asio/executor_work_guard.hpp>
+
+namespace
+{
+	double toMilliseconds(std::chrono::nanoseconds time)
+	{
+		return time.count() / 1e6;
+	}
+
+	// Adds b's stats into a, for totals.
+	void addStats(GameClient::Stats& a, const GameClient::Stats& b)
+	{
+		a.games += b.games;
+		a.turns += b.turns;
+		a.turnsLate += b.turnsLate;
+		a.botTime += b.botTime;
+		a.maxBotTime = std::max(a.maxBotTime, b.maxBotTime);
+		a.botCpu += b.botCpu;
+		a.roundTrips += b.roundTrips;
+		a.roundTripTime += b.roundTripTime;
+		a.maxRoundTrip = std::max(a.maxRoundTrip, b.maxRoundTrip);
+	}
+
+	void printStats(std::ostream& out, const std::string& name, const GameClient::Stats& stats)
+	{
+		int turns = std::max(stats.turns, 1);
+		int roundTrips = std::max(stats.roundTrips, 1);
+		out << std::left << std::setw(20) << name << std::right
+			<< std::setw(7) << stats.games
+			<< std::setw(8) << stats.turns
+			<< std::setw(7) << stats.turnsLate
+			<< std::fixed << std::setprecision(2)
+			<< std::setw(10) << toMilliseconds(stats.botTime) / turns
+			<< std::setw(10) << toMilliseconds(stats.maxBotTime)
+			<< std::setw(10) << toMilliseconds(stats.botCpu) / turns
+			<< std::setw(10) << toMilliseconds(stats.roundTripTime) / roundTrips
+			<< std::setw(10) << toMilliseconds(stats.maxRoundTrip)
+			<< std::endl;
+	}
+}
+
+BotRunner::BotRunner(const char* host, const char* port, int threads) :
+	m_host(host),
+	m_port(port),
+	m_threads(std::max(threads, 1)),
+	m_reportInterval(0)
+{
+}
+
+BotRunner::~BotRunner()
+{
+	stop();
+	for (std::thread& thread : m_pool)
+	{
+		thread.join();
+	}
+}
+
+void BotRunner::addBots(const std::string& type, int count, BotFactory factory, bool persistent)
+{
+	int first = 1;
+	for (auto& runner : m_runners)
+	{
+		if (runner->type == type)
+		{
+			first++;
+		}
+	}
+
+	for (int i = 0; i < count; i++)
+	{
+		std::unique_ptr<Runner> runner(new Runner());
+		runner->type = type;
+		runner->name = type + std::to_string(first + i);
+		runner->bot.reset(factory());
+		runner->client.reset(new GameClient(m_ioc, m_host.c_str(), m_port.c_str()));
+		runner->client->setQuiet(true);
+		runner->client->startAsync(runner->bot.get(), runner->name.c_str(), persistent);
+		m_runners.push_back(std::move(runner));
+	}
+}
+
+void BotRunner::run(std::chrono::seconds reportInterval)
+{
+	// Keep the threads running while the clients are between games, waiting on timers, etc.
+	auto work = boost::asio::make_work_guard(m_ioc);
+	m_start = std::chrono::steady_clock::now();
+	m_reportInterval = reportInterval;
+	scheduleReport();
+
+	for (int i = 1; i < m_threads; i++)
+	{
+		m_pool.push_back(std::thread([this]() { m_ioc.run(); }));
+	}
+	m_ioc.run();
+}
+
+void BotRunner::stop()
+{
+	m_ioc.stop();
+}
+
+void BotRunner::scheduleReport()
+{
+	if (m_reportInterval.count() <= 0)
+	{
+		return;
+	}
+
+	m_reportTimer.expires_after(m_reportInterval);
+	m_reportTimer.async_wait([this](const boost::system::error_code& ec)
+	{
+		if (!ec)
+		{
+			report(std::cout);
+			scheduleReport();
+		}
+	});
+}
+
+void BotRunner::report(std::ostream& out) const
+{
+	auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - m_start);
+	out << std::endl << m_runners.size() << " bots on " << m_threads << " threads, " << elapsed.count() << " s" << std::endl;
+	out << std::left << std::setw(20) << "bot" << std::right << std::setw(7) << "games" << std::setw(8) << "turns"
+		<< std::setw(7) << "late" << std::setw(10) << "avg ms" << std::setw(10) << "max ms" << std::setw(10) << "cpu ms"
+		<< std::setw(10) << "rtt ms" << std::setw(10) << "max rtt" << std::endl;
+
+	// Each bot, then totals for each type and for everything.
+	std::map<std::string, GameClient::Stats> types;
+	std::map<std::string, TurnLatency> typeLatency;
+	GameClient::Stats all = GameClient::Stats();
+	TurnLatency allLatency;
+	for (auto& runner : m_runners)
+	{
+		GameClient::Stats stats = runner->client->getStats();
+		printStats(out, runner->name, stats);
+
+		auto type = types.find(runner->type);
+		if (type == types.end())
+		{
+			type = types.insert(std::make_pair(runner->type, GameClient::Stats())).first;
+		}
+		addStats(type->second, stats);
+		addStats(all, stats);
+
+		TurnLatency latency = runner->client->getLatency();
+		typeLatency[runner->type].add(latency);
+		allLatency.add(latency);
+	}
+
+	for (auto& type : types)
+	{
+		printStats(out, "[" + type.first + "]", type.second);
+	}
+	printStats(out, "[all]", all);
+
+	// Where the turns' time went, for each type of bot.
+	out << std::endl;
+	for (auto& latency : typeLatency)
+	{
+		latency.second.print(out, "[" + latency.first + "]");
+	}
+	if (typeLatency.size() > 1)
+	{
+		allLatency.print(out, "[all]");
+	}
+}
@@ -0,0 +1,499 @@
+#include "CaptureFinder.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace
+{
+	const double MAX_PERCENT_CAPTURE = 0.2; // Captures larger than this fraction of the board fail.
+
+	int findFirstBit(uint64_t word)
+	{
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward64(&index, word);
+		return (int)index;
+#else
+		return __builtin_ctzll(word);
+#endif
+	}
+
+	// The bits of word i of a row that are on the board.
+	uint64_t getRowMask(int width, int i)
+	{
+		int bits = width - i * 64;
+		return bits >= 64 ? ~(uint64_t)0 : bits > 0 ? ((uint64_t)1 << bits) - 1 : 0;
+	}
+
+	DirectionCode getStep(const Position& from, const Position& to)
+	{
+		return Direction(to.x - from.x, to.y - from.y).getCode();
+	}
+
+	/**
+	 * Whether the space below a space on a loop is inside it, going into the space by one move and out by another. The
+	 * inside is to the right of the way the loop goes when it's clockwise, and to the left when it isn't. Going down
+	 * along the loop counts as inside when the inside is to the left, the way the row sums count it.
+	 */
+	bool isBelowInside(DirectionCode in, DirectionCode out, bool clockwise)
+	{
+		if (out == DIR_DOWN)
+		{
+			return clockwise;
+		}
+		if (in == DIR_UP)
+		{
+			return !clockwise;
+		}
+		for (DirectionCode code = out;;)
+		{
+			code = clockwise ? turnRight(code) : turnLeft(code);
+			if (code == getOpposite(in))
+			{
+				return false;
+			}
+			if (code == DIR_DOWN)
+			{
+				return true;
+			}
+		}
+	}
+}
+
+/**********************************************************************************************************************
+ *********************************************************************************************************************/
+CaptureFinder::CaptureFinder() :
+	m_serverCount(0)
+{
+}
+
+bool CaptureFinder::find(const Board& board, int playerId, const Position& pos, BitBoard& captured)
+{
+	m_bitBoards.update(board);
+	return find(m_bitBoards.getTerritory(playerId), m_bitBoards.getTrail(playerId), pos, captured);
+}
+
+bool CaptureFinder::find(const BitBoard& owned, const BitBoard& trail, const Position& pos, BitBoard& captured)
+{
+	int width = owned.getWidth();
+	int height = owned.getHeight();
+	int words = owned.getWordsPerRow();
+	m_walls = owned;
+	m_walls |= trail;
+	m_outside.resize(width, height);
+	m_enclosed.resize(width, height);
+	m_serverCount = 0;
+
+	// Only the rows with the player's spaces, and one more above and below, need searching. Everything else is
+	// outside.
+	int top = height;
+	int bottom = -1;
+	for (int y = 0; y < height; y++)
+	{
+		const uint64_t* row = m_walls.getRow(y);
+		if (std::any_of(row, row + words, [](uint64_t word) { return word != 0; }))
+		{
+			top = std::min(top, y);
+			bottom = y;
+		}
+	}
+
+	if (bottom >= 0)
+	{
+		top = std::max(top - 1, 0);
+		bottom = std::min(bottom + 1, height - 1);
+
+		m_open.resize(width, height);
+		for (int y = top; y <= bottom; y++)
+		{
+			const uint64_t* walls = m_walls.getRow(y);
+			uint64_t* open = m_open.getRow(y);
+			for (int i = 0; i < words; i++)
+			{
+				open[i] = ~walls[i] & getRowMask(width, i);
+			}
+		}
+
+		floodOutside(top, bottom);
+		for (int y = top; y <= bottom; y++)
+		{
+			const uint64_t* outside = m_outside.getRow(y);
+			uint64_t* enclosed = m_enclosed.getRow(y);
+			for (int i = 0; i < words; i++)
+			{
+				enclosed[i] = ~outside[i] & getRowMask(width, i);
+			}
+		}
+		countAreas(owned, pos, top, bottom);
+	}
+
+	captured = m_enclosed;
+	captured.andNot(owned);
+	return m_serverCount <= width * height * MAX_PERCENT_CAPTURE;
+}
+
+void CaptureFinder::floodOutside(int top, int bottom)
+{
+	// The edges of the board are outside, and so are the rows above and below the player's spaces.
+	int width = m_open.getWidth();
+	int height = m_open.getHeight();
+	int words = m_open.getWordsPerRow();
+	for (int y = top; y <= bottom; y++)
+	{
+		const uint64_t* open = m_open.getRow(y);
+		uint64_t* outside = m_outside.getRow(y);
+		if (y == top || y == bottom || y == 0 || y == height - 1)
+		{
+			std::copy_n(open, words, outside);
+			continue;
+		}
+		outside[0] |= open[0] & 1;
+		outside[(width - 1) / 64] |= open[(width - 1) / 64] & ((uint64_t)1 << ((width - 1) % 64));
+	}
+
+	floodFrom(m_outside, m_open, top, bottom, true);
+}
+
+void CaptureFinder::floodFrom(BitBoard& reach, const BitBoard& open, int top, int bottom, bool diagonal)
+{
+	// Fill each row along its runs of open spaces, then carry it into the next row (and diagonally, if asked). Sweep
+	// down and back up until nothing changes; an area that twists back on itself takes more sweeps. BitBoards have an
+	// empty row above and below the board, so the first and last rows need no special case.
+	int words = reach.getWordsPerRow();
+	m_row.resize(words);
+	uint64_t* row = m_row.data();
+	auto spread = [&](int y, int from)
+	{
+		const uint64_t* openRow = open.getRow(y);
+		const uint64_t* next = reach.getRow(from);
+		uint64_t* current = reach.getRow(y);
+		for (int i = 0; i < words; i++)
+		{
+			uint64_t spill = next[i];
+			if (diagonal)
+			{
+				spill |= (next[i] << 1) | (next[i] >> 1);
+				spill |= i > 0 ? next[i - 1] >> 63 : 0;
+				spill |= i + 1 < words ? next[i + 1] << 63 : 0;
+			}
+			row[i] = current[i] | (spill & openRow[i]);
+		}
+		fillRow(row, openRow, words);
+		if (!std::equal(row, row + words, current))
+		{
+			std::copy_n(row, words, current);
+			return true;
+		}
+		return false;
+	};
+
+	for (bool changed = true; changed;)
+	{
+		changed = false;
+		for (int y = top; y <= bottom; y++)
+		{
+			changed = spread(y, y - 1) || changed;
+		}
+		for (int y = bottom; y >= top; y--)
+		{
+			changed = spread(y, y + 1) || changed;
+		}
+	}
+}
+
+void CaptureFinder::fillRow(uint64_t* reach, const uint64_t* open, int words)
+{
+	// Toward higher bits, adding the reached spaces to the open ones carries through each run that holds one. A carry
+	// out of the top of a word continues the run in the next word.
+	uint64_t carry = 0;
+	for (int i = 0; i < words; i++)
+	{
+		uint64_t seeds = (reach[i] | carry) & open[i];
+		uint64_t sum = open[i] + seeds;
+		reach[i] = ((sum ^ open[i]) | seeds) & open[i];
+		carry = sum < open[i] ? 1 : 0;
+	}
+
+	// Toward lower bits there's no such trick, so spread by 1, 2, 4... spaces through the open runs.
+	uint64_t borrow = 0;
+	for (int i = words - 1; i >= 0; i--)
+	{
+		uint64_t fill = reach[i] | (borrow & open[i]);
+		uint64_t through = open[i];
+		fill |= through & (fill >> 1);
+		through &= through >> 1;
+		fill |= through & (fill >> 2);
+		through &= through >> 2;
+		fill |= through & (fill >> 4);
+		through &= through >> 4;
+		fill |= through & (fill >> 8);
+		through &= through >> 8;
+		fill |= through & (fill >> 16);
+		through &= through >> 16;
+		fill |= through & (fill >> 32);
+		reach[i] = fill;
+		borrow = (fill & 1) ? (uint64_t)1 << 63 : 0;
+	}
+}
+
+void CaptureFinder::countAreas(const BitBoard& owned, const Position& pos, int top, int bottom)
+{
+	if (pos.x < 0 || pos.y < 0 || pos.x >= m_enclosed.getWidth() || pos.y >= m_enclosed.getHeight() || !m_enclosed.isSet(pos))
+	{
+		return;
+	}
+
+	// The server fills the player's areas one at a time, in the order of their top left spaces. After each, if the
+	// area holding pos has been filled, it adds everything filled so far.
+	int words = m_enclosed.getWordsPerRow();
+	m_remaining = m_enclosed;
+	int filled = 0;
+	bool found = false;
+	for (int y = top; y <= bottom; y++)
+	{
+		const uint64_t* row = m_remaining.getRow(y);
+		for (int i = 0; i < words;)
+		{
+			if (row[i] == 0)
+			{
+				i++;
+				continue;
+			}
+
+			m_area.resize(m_enclosed.getWidth(), m_enclosed.getHeight());
+			m_area.set(i * 64 + findFirstBit(row[i]), y);
+			floodFrom(m_area, m_remaining, y, bottom, false);
+			m_remaining.andNot(m_area);
+
+			found = found || m_area.isSet(pos);
+			m_area.andNot(owned);
+			filled += m_area.count();
+			if (found)
+			{
+				m_serverCount += filled;
+			}
+		}
+	}
+}
+
+/**********************************************************************************************************************
+ *********************************************************************************************************************/
+CaptureEstimator::CaptureEstimator() :
+	m_width(0),
+	m_height(0),
+	m_pocketCount(0),
+	m_onTrail(false),
+	m_trailLoop()
+{
+}
+
+void CaptureEstimator::update(const BitBoard& owned, const std::vector<Position>& trail)
+{
+	m_width = owned.getWidth();
+	m_height = owned.getHeight();
+	m_owned = owned;
+
+	// Pockets our territory already holds are captured by any return, so count them once and leave them out of the sums.
+	m_trailSpaces.resize(m_width, m_height);
+	m_finder.find(owned, m_trailSpaces, Position(Position::UNKNOWN_POS, Position::UNKNOWN_POS), m_captured);
+	m_enclosed = m_finder.getEnclosed();
+	m_pocketCount = m_captured.count();
+
+	int stride = m_width + 1;
+	m_rowSums.assign(stride * m_height, 0);
+	for (int y = 0; y < m_height; y++)
+	{
+		int* sums = &m_rowSums[y * stride];
+		for (int x = m_width - 1; x >= 0; x--)
+		{
+			sums[x] = sums[x + 1] + getWeight(Position(x, y));
+		}
+	}
+	findPotentials();
+
+	// Add up the trail, all but the head, which depends on the next move.
+	m_head = trail.empty() ? Position(Position::UNKNOWN_POS, Position::UNKNOWN_POS) : trail.back();
+	m_onTrail = trail.size() > 1;
+	m_trailLoop = Loop();
+	if (!m_onTrail)
+	{
+		return;
+	}
+	m_trailLoop.start = trail.front();
+	for (size_t i = 1; i < trail.size(); i++)
+	{
+		// A player can cross their own trail. Then there's no one loop, so only the trail itself is counted.
+		if (m_trailSpaces.isSet(trail[i]))
+		{
+			m_trailLoop.crossed = true;
+			continue;
+		}
+
+		DirectionCode move = getStep(trail[i - 1], trail[i]);
+		if (i > 1)
+		{
+			addSpace(m_trailLoop, trail[i - 1], move);
+		}
+		m_trailLoop.sum += getStepSum(trail[i - 1], trail[i]);
+		m_trailLoop.weight += getWeight(trail[i]);
+		m_trailLoop.lastMove = move;
+		m_trailSpaces.set(trail[i]);
+	}
+}
+
+CaptureGain CaptureEstimator::estimate(const Moves& moves)
+{
+	DirectionCode path[Moves::MOVES_PER_TURN];
+	for (size_t i = 0; i < moves.size(); i++)
+	{
+		path[i] = moves.getCode(i);
+	}
+	return estimate(path, (int)moves.size());
+}
+
+CaptureGain CaptureEstimator::estimate(const std::vector<DirectionCode>& path)
+{
+	return estimate(path.data(), (int)path.size());
+}
+
+CaptureGain CaptureEstimator::estimate(const DirectionCode* path, int count)
+{
+	CaptureGain gain = { 0, 0, true };
+	Loop loop = m_trailLoop;
+	bool onTrail = m_onTrail;
+	Position pos = m_head;
+	m_path.clear();
+	for (int i = 0; i < count; i++)
+	{
+		Position next(pos.x + DIRECTION_X[path[i]], pos.y + DIRECTION_Y[path[i]]);
+		if (!isOnBoard(next))
+		{
+			return gain;
+		}
+
+		if (!onTrail)
+		{
+			// Moving around our territory just changes where the loop starts.
+			if (!m_owned.isSet(next))
+			{
+				onTrail = true;
+				loop = Loop();
+				loop.start = pos;
+				loop.sum = getStepSum(pos, next);
+				loop.weight = getWeight(next);
+				loop.lastMove = path[i];
+				m_path.push_back(next);
+			}
+			pos = next;
+			continue;
+		}
+
+		addSpace(loop, pos, path[i]);
+		loop.sum += getStepSum(pos, next);
+		if (m_owned.isSet(next))
+		{
+			gain.moves = i + 1;
+			gain.captured = close(loop, next);
+			gain.allowed = gain.captured <= m_width * m_height * MAX_PERCENT_CAPTURE;
+			return gain;
+		}
+
+		// Going back over the trail doesn't make a simple loop.
+		if (m_trailSpaces.isSet(next) || std::find(m_path.begin(), m_path.end(), next) != m_path.end())
+		{
+			return gain;
+		}
+		loop.weight += getWeight(next);
+		loop.lastMove = path[i];
+		m_path.push_back(next);
+		pos = next;
+	}
+	return gain;
+}
+
+void CaptureEstimator::findPotentials()
+{
+	// Within our territory (and its pockets), the sum of the steps from one space to another is the same whichever way
+	// you go, since any loop there has nothing that counts inside it. So pick a space in each area and sum outward.
+	m_potentials.assign(m_width * m_height, 0);
+	m_areas.assign(m_width * m_height, -1);
+	int areaCount = 0;
+	for (int y = 0; y < m_height; y++)
+	{
+		for (int x = 0; x < m_width; x++)
+		{
+			if (!m_enclosed.isSet(x, y) || m_areas[y * m_width + x] >= 0)
+			{
+				continue;
+			}
+
+			m_queue.clear();
+			m_queue.push_back(y * m_width + x);
+			m_areas[y * m_width + x] = areaCount;
+			for (size_t next = 0; next < m_queue.size(); next++)
+			{
+				int index = m_queue[next];
+				Position pos(index % m_width, index / m_width);
+				for (int code = 0; code < 4; code++)
+				{
+					Position neighbor(pos.x + DIRECTION_X[code], pos.y + DIRECTION_Y[code]);
+					if (!isOnBoard(neighbor) || !m_enclosed.isSet(neighbor) || m_areas[getIndex(neighbor)] >= 0)
+					{
+						continue;
+					}
+					m_areas[getIndex(neighbor)] = areaCount;
+					m_potentials[getIndex(neighbor)] = m_potentials[index] + getStepSum(pos, neighbor);
+					m_queue.push_back(getIndex(neighbor));
+				}
+			}
+			areaCount++;
+		}
+	}
+}
+
+int CaptureEstimator::getStepSum(const Position& from, const Position& to) const
+{
+	// Stepping down between two rows counts the spaces to the right in the upper row; stepping up takes them away.
+	if (to.y > from.y)
+	{
+		return m_rowSums[from.y * (m_width + 1) + from.x + 1];
+	}
+	if (to.y < from.y)
+	{
+		return -m_rowSums[to.y * (m_width + 1) + to.x + 1];
+	}
+	return 0;
+}
+
+void CaptureEstimator::addSpace(Loop& loop, const Position& pos, DirectionCode out) const
+{
+	if (getWeight(pos))
+	{
+		loop.belowInside[0] += isBelowInside(loop.lastMove, out, false);
+		loop.belowInside[1] += isBelowInside(loop.lastMove, out, true);
+	}
+}
+
+int CaptureEstimator::close(const Loop& loop, const Position& home) const
+{
+	// The trail and pockets are captured however the loop closes. The loop's sum counts the spaces that count below
+	// each of its spaces: the ones inside it, and some of its own. Clockwise loops count negative.
+	int captured = loop.weight + m_pocketCount;
+	int area = m_areas[getIndex(loop.start)];
+	if (loop.crossed)
+	{
+		return captured;
+	}
+	if (area < 0 || area != m_areas[getIndex(home)])
+	{
+		// It came home to a different piece of territory, so there's no way back through ours to close the loop.
+		return captured;
+	}
+
+	int sum = loop.sum + m_potentials[getIndex(loop.start)] - m_potentials[getIndex(home)];
+	if (sum != 0)
+	{
+		captured += std::abs(sum) - loop.belowInside[sum < 0 ? 1 : 0];
+	}
+	return captured;
+}
@@ -0,0 +1,507 @@
+#include "DistanceField.h"
+
+#include "WorldMap.h"
+
+#include <algorithm>
+
+/**********************************************************************************************************************
+ *********************************************************************************************************************/
+DistanceField::DistanceField() :
+	m_width(0),
+	m_height(0),
+	m_stride(2),
+	m_nextSeed(0),
+	m_nextQueued(0)
+{
+	resize(0, 0);
+}
+
+void DistanceField::resize(int width, int height)
+{
+	m_width = std::max(width, 0);
+	m_height = std::max(height, 0);
+	m_stride = m_width + 2;
+	m_offsets[0] = -m_stride;
+	m_offsets[1] = 1;
+	m_offsets[2] = m_stride;
+	m_offsets[3] = -1;
+	clear();
+}
+
+void DistanceField::clear()
+{
+	size_t size = (size_t)m_stride * (m_height + 2);
+	m_distances.assign(size, UNREACHABLE);
+	m_labels.assign(size, NO_SOURCE);
+	m_sources.assign(size, NO_SOURCE);
+	m_isChanged.assign(size, 0);
+	m_changed.clear();
+
+	// Block the border, so the search never leaves the board.
+	m_blocked.assign(size, 1);
+	for (int y = 0; y < m_height; y++)
+	{
+		std::fill_n(m_blocked.begin() + getIndex(0, y), m_width, 0);
+	}
+}
+
+void DistanceField::addSource(int x, int y, int label)
+{
+	int index = getIndex(x, y);
+	if (m_sources[index] != label)
+	{
+		m_sources[index] = label;
+		markChanged(index);
+	}
+}
+
+void DistanceField::removeSource(int x, int y)
+{
+	int index = getIndex(x, y);
+	if (m_sources[index] != NO_SOURCE)
+	{
+		m_sources[index] = NO_SOURCE;
+		markChanged(index);
+	}
+}
+
+void DistanceField::setBlocked(int x, int y, bool blocked)
+{
+	int index = getIndex(x, y);
+	if ((m_blocked[index] != 0) != blocked)
+	{
+		m_blocked[index] = blocked ? 1 : 0;
+		markChanged(index);
+	}
+}
+
+void DistanceField::markChanged(int index)
+{
+	if (!m_isChanged[index])
+	{
+		m_isChanged[index] = 1;
+		m_changed.push_back(index);
+	}
+}
+
+void DistanceField::update()
+{
+	if (m_changed.empty())
+	{
+		return;
+	}
+
+	// Repairing costs more per space than searching, so if much of the board changed, start over.
+	if (m_changed.size() > (size_t)m_width * m_height / 16)
+	{
+		recompute();
+		return;
+	}
+
+	// If the changes cut off much of the field (e.g., a source that many spaces were closest to moved), starting over
+	// is faster than repairing.
+	if (!invalidate())
+	{
+		recompute();
+		return;
+	}
+	repair();
+
+	for (int index : m_changed)
+	{
+		m_isChanged[index] = 0;
+	}
+	m_changed.clear();
+}
+
+void DistanceField::recompute()
+{
+	std::fill(m_distances.begin(), m_distances.end(), (uint16_t)UNREACHABLE);
+	std::fill(m_labels.begin(), m_labels.end(), (int)NO_SOURCE);
+
+	m_seeds.clear();
+	for (int y = 0; y < m_height; y++)
+	{
+		for (int index = getIndex(0, y), end = index + m_width; index < end; index++)
+		{
+			if (m_sources[index] != NO_SOURCE)
+			{
+				m_distances[index] = 0;
+				m_labels[index] = m_sources[index];
+				m_seeds.push_back(Entry{ index, 0 });
+			}
+		}
+	}
+	search();
+
+	for (int index : m_changed)
+	{
+		m_isChanged[index] = 0;
+	}
+	m_changed.clear();
+}
+
+bool DistanceField::isSupported(int index) const
+{
+	// A source stays unless its label changed. If it wasn't at 0 before, repair() lowers it.
+	if (m_sources[index] != NO_SOURCE)
+	{
+		return m_distances[index] != 0 || m_labels[index] == m_sources[index];
+	}
+	if (m_blocked[index])
+	{
+		return false;
+	}
+
+	// Otherwise it needs a neighbor one closer to the same source.
+	int distance = m_distances[index];
+	int label = m_labels[index];
+	for (int offset : m_offsets)
+	{
+		int neighbor = index + offset;
+		if (m_distances[neighbor] + 1 == distance && m_labels[neighbor] == label)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+bool DistanceField::invalidate()
+{
+	// Starting at the changes, clear every space that no longer has a path to its source, nearest first. A space is
+	// only checked once every space closer than it has been, so a neighbor it relies on can't be cleared after it.
+	m_seeds.clear();
+	m_invalid.clear();
+	for (int index : m_changed)
+	{
+		if (m_distances[index] != UNREACHABLE)
+		{
+			m_seeds.push_back(Entry{ index, m_distances[index] });
+		}
+	}
+	std::sort(m_seeds.begin(), m_seeds.end());
+	m_nextSeed = 0;
+	m_queue.clear();
+	m_nextQueued = 0;
+
+	size_t limit = (size_t)m_width * m_height / 8;
+	Entry entry;
+	while (popEntry(entry))
+	{
+		int index = entry.index;
+		if (m_distances[index] != entry.distance || isSupported(index))
+		{
+			continue;
+		}
+		if (m_invalid.size() >= limit)
+		{
+			return false;
+		}
+
+		m_distances[index] = UNREACHABLE;
+		m_labels[index] = NO_SOURCE;
+		m_invalid.push_back(index);
+		for (int offset : m_offsets)
+		{
+			int neighbor = index + offset;
+			if (m_distances[neighbor] == entry.distance + 1)
+			{
+				m_queue.push_back(Entry{ neighbor, entry.distance + 1 });
+			}
+		}
+	}
+	return true;
+}
+
+void DistanceField::repair()
+{
+	// Give each cleared or changed space the best distance its neighbors offer, then search outward from them.
+	m_seeds.clear();
+	auto seed = [this](int index)
+	{
+		int distance = UNREACHABLE;
+		int label = NO_SOURCE;
+		if (m_sources[index] != NO_SOURCE)
+		{
+			distance = 0;
+			label = m_sources[index];
+		}
+		else if (!m_blocked[index])
+		{
+			for (int offset : m_offsets)
+			{
+				int neighbor = index + offset;
+				if (m_distances[neighbor] + 1 < distance)
+				{
+					distance = m_distances[neighbor] + 1;
+					label = m_labels[neighbor];
+				}
+			}
+		}
+
+		if (distance < m_distances[index])
+		{
+			m_distances[index] = (uint16_t)distance;
+			m_labels[index] = label;
+			m_seeds.push_back(Entry{ index, distance });
+		}
+	};
+	for (int index : m_invalid)
+	{
+		seed(index);
+	}
+	for (int index : m_changed)
+	{
+		seed(index);
+	}
+	std::sort(m_seeds.begin(), m_seeds.end());
+	search();
+}
+
+void DistanceField::search()
+{
+	// Breadth-first from the seeds, which are already set. Spaces are only ever lowered. The queue holds indexes, and a
+	// space's distance is read when it's taken, so one lowered again after it was queued goes out at its new distance.
+	m_found.clear();
+	size_t nextSeed = 0;
+	size_t nextFound = 0;
+	for (;;)
+	{
+		int index;
+		if (nextSeed < m_seeds.size() && (nextFound == m_found.size() || m_seeds[nextSeed].distance <= m_distances[m_found[nextFound]]))
+		{
+			index = m_seeds[nextSeed++].index;
+		}
+		else if (nextFound < m_found.size())
+		{
+			index = m_found[nextFound++];
+		}
+		else
+		{
+			break;
+		}
+
+		int distance = m_distances[index] + 1;
+		int label = m_labels[index];
+		for (int offset : m_offsets)
+		{
+			int neighbor = index + offset;
+			if (m_distances[neighbor] > distance && !m_blocked[neighbor])
+			{
+				m_distances[neighbor] = (uint16_t)distance;
+				m_labels[neighbor] = label;
+				m_found.push_back(neighbor);
+			}
+		}
+	}
+}
+
+bool DistanceField::popEntry(Entry& entry)
+{
+	// The seeds are sorted, and the queue only grows by one more than what was last taken, so taking the nearer of
+	// the two keeps everything in order of distance. invalidate() relies on that.
+	bool haveSeed = m_nextSeed < m_seeds.size();
+	bool haveQueued = m_nextQueued < m_queue.size();
+	if (haveSeed && (!haveQueued || m_seeds[m_nextSeed].distance <= m_queue[m_nextQueued].distance))
+	{
+		entry = m_seeds[m_nextSeed++];
+		return true;
+	}
+	if (haveQueued)
+	{
+		entry = m_queue[m_nextQueued++];
+		return true;
+	}
+	return false;
+}
+
+/**********************************************************************************************************************
+ *********************************************************************************************************************/
+PlayerDistances::PlayerDistances() :
+	m_selfId(Player::NO_PLAYER)
+{
+}
+
+void PlayerDistances::update(const WorldMap& world, const Players& players, int selfId)
+{
+	update(world.getBoard(), Position(0, 0), players, selfId);
+}
+
+void PlayerDistances::update(const PartialBoard& view, const Players& players, int selfId)
+{
+	update(view, view.boardOffset, players, selfId);
+}
+
+void PlayerDistances::update(const Board& board, const Position& offset, const Players& players, int selfId)
+{
+	if (board.width != m_home.getWidth() || board.height != m_home.getHeight() || selfId != m_selfId)
+	{
+		m_selfId = selfId;
+		resize(board.width, board.height);
+	}
+	m_offset = offset;
+
+	// Find the spaces that changed.
+	for (int y = 0; y < board.height; y++)
+	{
+		const Cell* row = board.getRow(y);
+		int* owners = &m_owners[y * board.width];
+		int* trails = &m_trails[y * board.width];
+		for (int x = 0; x < board.width; x++)
+		{
+			int owner = board.getPlayerId(row[x].owner);
+			int trail = board.getPlayerId(row[x].trail);
+			if (owner != owners[x] || trail != trails[x])
+			{
+				updateSpace(x, y, owners[x], trails[x], owner, trail);
+				owners[x] = owner;
+				trails[x] = trail;
+			}
+		}
+	}
+
+	// Move the heads. Take every enemy out of the enemy field first, in case one moved where another was.
+	for (Head& head : m_heads)
+	{
+		head.seen = false;
+		if (head.playerId != m_selfId)
+		{
+			m_enemies.removeSource(head.pos.x, head.pos.y);
+		}
+	}
+	for (const auto& entry : players)
+	{
+		const Player& player = *entry.second;
+		Position pos(player.pos.x - m_offset.x, player.pos.y - m_offset.y);
+		if (player.id == Player::NO_PLAYER || !player.pos.isValid() || !m_home.isOnBoard(pos.x, pos.y))
+		{
+			continue;
+		}
+
+		Head* head = findHead(player.id);
+		if (!head)
+		{
+			// A new head's field starts with the player's trail blocked.
+			m_heads.push_back(Head());
+			head = &m_heads.back();
+			head->playerId = player.id;
+			head->pos.set(Position::UNKNOWN_POS, Position::UNKNOWN_POS);
+			head->field.resize(board.width, board.height);
+			for (size_t i = 0; i < m_trails.size(); i++)
+			{
+				if (m_trails[i] == player.id)
+				{
+					head->field.setBlocked((int)i % board.width, (int)i / board.width, true);
+				}
+			}
+		}
+		head->seen = true;
+		if (!(head->pos == pos))
+		{
+			if (head->pos.isValid())
+			{
+				head->field.removeSource(head->pos.x, head->pos.y);
+			}
+			head->field.addSource(pos.x, pos.y, player.id);
+			head->pos = pos;
+		}
+	}
+
+	// Drop the players that left the view, and put the rest of the enemies back.
+	m_heads.erase(std::remove_if(m_heads.begin(), m_heads.end(), [](const Head& head) { return !head.seen; }),
+		m_heads.end());
+	for (Head& head : m_heads)
+	{
+		if (head.playerId != m_selfId)
+		{
+			m_enemies.addSource(head.pos.x, head.pos.y, head.playerId);
+		}
+		head.field.update();
+	}
+	m_home.update();
+	m_enemies.update();
+}
+
+void PlayerDistances::resize(int width, int height)
+{
+	m_home.resize(width, height);
+	m_enemies.resize(width, height);
+	m_heads.clear();
+	m_owners.assign((size_t)m_home.getWidth() * m_home.getHeight(), Player::NO_PLAYER);
+	m_trails.assign((size_t)m_home.getWidth() * m_home.getHeight(), Player::NO_PLAYER);
+}
+
+void PlayerDistances::updateSpace(int x, int y, int oldOwner, int oldTrail, int newOwner, int newTrail)
+{
+	// Our territory is where the home field leads, and our trail is in its way.
+	if ((oldOwner == m_selfId) != (newOwner == m_selfId))
+	{
+		if (newOwner == m_selfId)
+		{
+			m_home.addSource(x, y);
+		}
+		else
+		{
+			m_home.removeSource(x, y);
+		}
+	}
+
+	// Each head's field is blocked by that player's trail.
+	if (oldTrail != newTrail)
+	{
+		if (oldTrail == m_selfId || newTrail == m_selfId)
+		{
+			m_home.setBlocked(x, y, newTrail == m_selfId);
+		}
+		if (Head* head = findHead(oldTrail))
+		{
+			head->field.setBlocked(x, y, false);
+		}
+		if (Head* head = findHead(newTrail))
+		{
+			head->field.setBlocked(x, y, true);
+		}
+	}
+}
+
+PlayerDistances::Head* PlayerDistances::findHead(int playerId)
+{
+	for (Head& head : m_heads)
+	{
+		if (head.playerId == playerId)
+		{
+			return &head;
+		}
+	}
+	return nullptr;
+}
+
+int PlayerDistances::getDistance(int playerId, const Position& pos) const
+{
+	const DistanceField* field = getField(playerId);
+	return field ? getFrom(*field, pos, DistanceField::UNREACHABLE) : (int)DistanceField::UNREACHABLE;
+}
+
+const DistanceField* PlayerDistances::getField(int playerId) const
+{
+	for (const Head& head : m_heads)
+	{
+		if (head.playerId == playerId)
+		{
+			return &head.field;
+		}
+	}
+	return nullptr;
+}
+
+int PlayerDistances::getFrom(const DistanceField& field, const Position& pos, int otherwise, bool nearest) const
+{
+	int x = pos.x - m_offset.x;
+	int y = pos.y - m_offset.y;
+	if (!field.isOnBoard(x, y))
+	{
+		return otherwise;
+	}
+	return nearest ? field.getNearest(x, y) : field.getDistance(x, y);
+}
@@ -7,9 +7,12 @@
 #include <boost/beast/core.hpp>
 #include <boost/beast/http.hpp>
 #include <boost/beast/version.hpp>
+#include <boost/asio/bind_executor.hpp>
 #include <boost/asio/connect.hpp>
 #include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/post.hpp>
 
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
 #include <iomanip>
@@ -17,17 +20,71 @@
 #include <string>
 #include <thread>
 
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
 #include "rapidjson/document.h"
 #include "rapidjson/writer.h"
 #include "rapidjson/stringbuffer.h"
 
 namespace http = boost::beast::http;
 
+namespace
+{
+	const std::chrono::milliseconds DEFAULT_MAX_TURN_WAIT(500); // The max of the server's InputWaiter.
+	const std::chrono::milliseconds DEADLINE_MARGIN(20);        // Headroom for sending the moves.
+	const std::chrono::milliseconds RETRY_DELAY(1000);
+
+	// The CPU time used by the calling thread.
+	std::chrono::nanoseconds getThreadCpuTime()
+	{
+#ifdef _WIN32
+		FILETIME creation, exit, kernel, user;
+		GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user);
+		unsigned long long ticks = ((unsigned long long)kernel.dwHighDateTime << 32 | kernel.dwLowDateTime) +
+			((unsigned long long)user.dwHighDateTime << 32 | user.dwLowDateTime);
+		return std::chrono::nanoseconds(ticks * 100);
+#else
+		timespec now;
+		clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+		return std::chrono::seconds(now.tv_sec) + std::chrono::nanoseconds(now.tv_nsec);
+#endif
+	}
+}
+
 
 GameClient::GameClient(const char* host, const char* port) :
+	GameClient(new boost::asio::io_context(), true, host, port)
+{
+}
+
+GameClient::GameClient(boost::asio::io_context& ioc, const char* host, const char* port) :
+	GameClient(&ioc, false, host, port)
+{
+}
+
+GameClient::GameClient(boost::asio::io_context* ioc, bool ownIoc, const char* host, const char* port) :
     m_connected(false),
+	m_ownIoc(ownIoc ? ioc : nullptr),
+	m_ioc(*ioc),
 	m_host(host),
-	m_port(port)
+	m_port(port),
+	m_maxTurnWait(DEFAULT_MAX_TURN_WAIT),
+	m_minRoundTrip(Clock::duration::max()),
+	m_bot(nullptr),
+	m_persistent(false),
+	m_turn(0),
+	m_botBusy(false),
+	m_movesSent(false),
+	m_gameStarting(false),
+	m_statePending(false),
+	m_turnsPlayed(0),
+	m_turnsLate(0),
+	m_quiet(false),
+	m_stats()
 {
 }
 
@@ -42,8 +99,9 @@ void GameClient::connect()
 	{
 		try
 		{
-			// If we are currently connected, close the connection.
+			// If we are currently connected, close the connection. Drop anything left over from it.
 			close();
+			m_buffer.consume(m_buffer.size());
 
 			// Look up the domain name.
 			boost::asio::ip::tcp::resolver resolver{ m_ioc };
@@ -80,66 +138,66 @@ void GameClient::close()
 	}
 }
 
-std::string GameClient::getMessage(const char* target, bool useAuthorization)
+void GameClient::prepareRequest(Request& req, http::verb verb, const char* target, const std::string& body, bool useAuthorization)
 {
-	// Set up an HTTP GET request message and send it to the host.
-	http::request<http::string_body> req{ http::verb::get, target, m_version };
+	// Set up an HTTP message to send to the host.
+	req = Request{ verb, target, m_version };
 	req.set(http::field::host, m_host);
 	req.set(http::field::user_agent, BOOST_BEAST_VERSION_STRING);
 
+	if (verb == http::verb::post)
+	{
+		req.set(http::field::content_type, "application/json");
+		req.body() = body;
+		req.prepare_payload();
+	}
+
 	if (useAuthorization)
 	{
 		std::string bearer = "Bearer ";
 		bearer.append(m_token);
 		req.set(http::field::authorization, bearer);
 	}
+}
 
-	// This throws an exception if there's an error.
-	http::write(m_socket, req);
-
-	// Get the response.
-	boost::beast::flat_buffer buffer;
-	http::response<http::string_body> res;
-	http::read(m_socket, buffer, res);
+void GameClient::prepareResponse()
+{
+	// Reuse the response so the body keeps its memory from turn to turn. The parser appends to what's there.
+	m_response.base().clear();
+	m_response.body().clear();
+}
 
-	// Write the message to standard out
-	//std::cout << res << std::endl;
+std::string& GameClient::getMessage(const char* target, bool useAuthorization)
+{
+	// Set up an HTTP GET request message and send it to the host.
+	prepareRequest(m_request, http::verb::get, target, std::string(), useAuthorization);
 
-	// Get the body as a string.
-	return res.body();
+	// This throws an exception if there's an error.
+	http::write(m_socket, m_request);
+	return readMessage();
 }
 
-std::string GameClient::postMessage(const char* target, const char* body, bool useAuthorization)
+std::string& GameClient::postMessage(const char* target, const std::string& body, bool useAuthorization)
 {
 	// Set up an HTTP POST message and send it to the host.
-	http::request<http::string_body> req{ http::verb::post, target, m_version, body };
-	req.set(http::field::host, m_host);
-	req.set(http::field::user_agent, BOOST_BEAST_VERSION_STRING);
-	req.set(http::field::content_type, "application/json");
-	auto str = std::string(body);
-	req.set(http::field::content_length, str.size());
-	req.body() = str;
-
-	if (useAuthorization)
-	{
-		std::string bearer = "Bearer ";
-		bearer.append(m_token);
-		req.set(http::field::authorization, bearer);
-	}
+	prepareRequest(m_request, http::verb::post, target, body, useAuthorization);
 
 	// This throws an exception if there's an error.
-	http::write(m_socket, req);
+	http::write(m_socket, m_request);
+	return readMessage();
+}
 
+std::string& GameClient::readMessage()
+{
 	// Get the response.
-	boost::beast::flat_buffer buffer;
-	http::response<http::string_body> res;
-	http::read(m_socket, buffer, res);
+	prepareResponse();
+	http::read(m_socket, m_buffer, m_response);
 
 	// Write the message to standard out.
-	//std::cout << res << std::endl;
+	//std::cout << m_response << std::endl;
 
-	// Get the body as a string.
-	return res.body();
+	// Get the body as a string. It's valid until the next message.
+	return m_response.body();
 }
 
 void GameClient::play(Bot* bot, const char* botName, bool persistent)
@@ -150,7 +208,7 @@ void GameClient::play(Bot* bot, const char* botName, bool persistent)
 		{
 			// Connect to the server.
 			connect();
-			joinLobby(bot, botName, persistent);
+			joinLobby(botName, persistent);
 			playGame(bot);
 		}
 		catch (std::exception e)
@@ -173,10 +231,19 @@ void GameClient::playGame(Bot* bot)
 
 			// Get the game to join.
 			m_gameName = joinFirstAvailableGame();
+			countGame();
+			if (m_recorder)
+			{
+				m_recorder->recordGame(m_botName, m_gameName);
+			}
+			m_gameUri = "/games/" + encodeUri(m_gameName);
+			m_moveRequests.prepare(m_host, m_gameUri, m_token);
 
 			// Send empty moves to start the game and get the initial board state.
 			Moves moves;
+			m_gameStarting = true;
 			sendMoves(moves);
+			m_gameStarting = false;
 
 			// Initialize the bot. This gives it a chance to set up bookkeeping, etc.
 			bot->setPlayer(m_gameInfo.players[m_botName]);
@@ -184,10 +251,19 @@ void GameClient::playGame(Bot* bot)
 
 			do
 			{
-				moves = bot->getMoves(m_gameInfo);
+				moves = callBot(bot, m_gameInfo);
 				sendMoves(moves);
 				// Handle game over.
 			} while (!m_gameInfo.gameOver);
+
+			if (m_recorder)
+			{
+				m_recorder->flush();
+			}
+			if (!m_quiet)
+			{
+				getLatency().print(std::cout, "turn latency");
+			}
 		}
 		catch (std::exception e)
 		{
@@ -222,7 +298,15 @@ std::vector<std::string> GameClient::getPlayers()
 	return players;
 }
 
-void GameClient::joinLobby(Bot* bot, const char* requestedBotName, bool persistent)
+void GameClient::joinLobby(const char* requestedBotName, bool persistent)
+{
+	// Join the lobby.
+	std::string botInfo = serializeJoinRequest(requestedBotName, persistent);
+	const std::string jsonLobby = postMessage("/players", botInfo, false);
+	processJoinResponse(jsonLobby);
+}
+
+std::string GameClient::serializeJoinRequest(const char* requestedBotName, bool persistent)
 {
 	// Create the json for the bot's name.
 	rapidjson::StringBuffer s;
@@ -233,11 +317,11 @@ void GameClient::joinLobby(Bot* bot, const char* requestedBotName, bool persiste
 	writer.Key("persistent");
 	writer.Bool(persistent);
 	writer.EndObject();
-	std::string botInfo = s.GetString();
-
-	// Join the lobby.
-	const std::string jsonLobby = postMessage("/players", botInfo.c_str(), false);
+	return s.GetString();
+}
 
+void GameClient::processJoinResponse(const std::string& jsonLobby)
+{
 	// Parse the bot name and token from the results.
 	rapidjson::Document doc;
 	doc.Parse(jsonLobby.c_str());
@@ -280,7 +364,11 @@ std::vector<std::string> GameClient::listGames()
 {
 	// Get the games.
 	std::string jsonGames = getMessage("/games", true);
+	return parseGames(jsonGames);
+}
 
+std::vector<std::string> GameClient::parseGames(const std::string& jsonGames)
+{
 	// Add the games to our array.
 	std::vector<std::string> games;
 	rapidjson::Document doc;
@@ -297,6 +385,43 @@ std::vector<std::string> GameClient::listGames()
 }
 
 void GameClient::sendMoves(Moves& moves)
+{
+	// Send the moves. Use the ready-made request if there is one.
+	m_turnStart = Clock::now();
+	if (m_recorder)
+	{
+		m_recorder->recordMoves(moves);
+	}
+	MoveRequests::Buffers request;
+	bool prepared = m_moveRequests.getRequest(moves, request);
+	if (!prepared)
+	{
+		prepareRequest(m_request, http::verb::post, m_gameUri.c_str(), serializeMoves(moves), true);
+	}
+	m_requestReady = Clock::now();
+
+	if (prepared)
+	{
+		boost::asio::write(m_socket, request);
+	}
+	else
+	{
+		http::write(m_socket, m_request);
+	}
+	m_requestWritten = Clock::now();
+
+	std::string& jsonGameInfo = readMessage();
+	onGameStateReceived(m_turnStart);
+	if (m_recorder)
+	{
+		m_recorder->recordState(jsonGameInfo);
+	}
+	Clock::time_point parseStart = Clock::now();
+	processGameState(jsonGameInfo);
+	recordTurnLatency(parseStart);
+}
+
+std::string GameClient::serializeMoves(const Moves& moves)
 {
 	// Create json data for moves.
 	rapidjson::StringBuffer s;
@@ -307,165 +432,458 @@ void GameClient::sendMoves(Moves& moves)
 		const Direction& dir = moves[i];
 		writer.StartObject();
 		writer.Key("x");
-		writer.Double(dir.x);
+		writer.Int(dir.x);
 		writer.Key("y");
-		writer.Double(dir.y);
+		writer.Int(dir.y);
 		writer.EndObject();
 	}
 	writer.EndArray();
-	std::string movesInfo = s.GetString();
+	return s.GetString();
+}
 
-	// Send the moves.
-	std::string gameName = encodeUri(m_gameName);
-	std::string uri = "/games/" + gameName;
-	const std::string jsonGameInfo = postMessage(uri.c_str(), movesInfo.c_str(), true);
+void GameClient::countGame()
+{
+	std::lock_guard<std::mutex> lock(m_statsMutex);
+	m_stats.games++;
+}
 
-	// Parse the game state.
-	rapidjson::Document doc;
-	doc.Parse(jsonGameInfo.c_str());
+void GameClient::onGameStateReceived(Clock::time_point movesSent)
+{
+	// The quickest round trip is our best guess at the network latency, which eats into the server's wait.
+	m_stateReceived = Clock::now();
+	Clock::duration roundTrip = m_stateReceived - movesSent;
+	m_minRoundTrip = std::min(m_minRoundTrip, roundTrip);
+
+	std::lock_guard<std::mutex> lock(m_statsMutex);
+	m_stats.roundTrips++;
+	m_stats.roundTripTime += roundTrip;
+	m_stats.maxRoundTrip = std::max(m_stats.maxRoundTrip, roundTrip);
+}
+
+void GameClient::recordTurnLatency(Clock::time_point parseStart)
+{
+	if (m_gameStarting)
+	{
+		return;
+	}
+
+	Clock::time_point parsed = Clock::now();
+	std::lock_guard<std::mutex> lock(m_statsMutex);
+	m_latency.serialize.record(m_requestReady - m_turnStart);
+	m_latency.write.record(m_requestWritten - m_requestReady);
+	m_latency.wait.record(m_stateReceived - m_requestWritten);
+	m_latency.parse.record(parsed - parseStart);
+}
 
+void GameClient::processGameState(std::string& jsonGameInfo)
+{
+	// Parse the game state in place. It's null terminated, like any std::string.
 	// If the game isn't an object (e.g., is "Not Found"), throw an error to start a new game.
 	// This happens if the game can't be found because it ended without us knowing.
-	if (!doc.IsObject())
+	if (!m_parser.parse(&jsonGameInfo[0], m_gameInfo))
 	{
-		std::cout << "Trying to play a game that just ended. Joining the next one instead." << std::endl;
+		if (!m_quiet)
+		{
+			std::cout << "Trying to play a game that just ended. Joining the next one instead." << std::endl;
+		}
 		throw std::runtime_error("game-over");
 	}
 
-	m_gameInfo.gameOver = (doc.HasMember("over") && doc["over"].IsBool()) ? doc["over"].GetBool() : false;
-	m_gameInfo.boardWidth = (doc.HasMember("boardWidth") && doc["boardWidth"].IsInt()) ? doc["boardWidth"].GetInt() : 0;
-	m_gameInfo.boardHeight = (doc.HasMember("boardHeight") && doc["boardHeight"].IsInt()) ? doc["boardHeight"].GetInt() : 0;
+	// The server waits m_maxTurnWait for moves after sending this state, which left it about half a round trip ago.
+	// The moves take another half a round trip to get there.
+	Clock::duration networkTime = Clock::duration::zero();
+	if (m_minRoundTrip != Clock::duration::max())
+	{
+		networkTime = std::min<Clock::duration>(m_minRoundTrip, m_maxTurnWait / 2);
+	}
+	m_gameInfo.deadline = m_stateReceived + m_maxTurnWait - networkTime - DEADLINE_MARGIN;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Asynchronous play
+//---------------------------------------------------------------------------------------------------------------------
+void GameClient::playAsync(Bot* bot, const char* botName, bool persistent)
+{
+	startAsync(bot, botName, persistent);
+	m_ioc.restart();
+	m_ioc.run();
+}
+
+void GameClient::startAsync(Bot* bot, const char* botName, bool persistent)
+{
+	m_bot = bot;
+	m_requestedBotName = botName;
+	m_persistent = persistent;
 
-	// Get the view origin.
-	PartialBoard& board = m_gameInfo.partialBoard;
-	if (doc.HasMember("viewOrigin") && doc["viewOrigin"].IsObject())
+	// On its own, the client gives the bot a thread so the I/O thread is free. Shared clients use the shared threads.
+	// Made here rather than up front, since play() has no use for it.
+	if (m_ownIoc && !m_botThread)
 	{
-		const rapidjson::Value& v = doc["viewOrigin"];
-		board.boardOffset.x = v["x"].GetInt();
-		board.boardOffset.y = v["y"].GetInt();
+		m_botThread.reset(new boost::asio::thread_pool(1));
 	}
 
-	// If the game isn't over, process the players and board.
-	if (!m_gameInfo.gameOver)
+	boost::asio::post(m_strand, [this]() { asyncConnect(); });
+}
+
+GameClient::Stats GameClient::getStats() const
+{
+	std::lock_guard<std::mutex> lock(m_statsMutex);
+	return m_stats;
+}
+
+TurnLatency GameClient::getLatency() const
+{
+	std::lock_guard<std::mutex> lock(m_statsMutex);
+	return m_latency;
+}
+
+Moves GameClient::callBot(Bot* bot, const GameInfo& gameInfo)
+{
+	Clock::time_point start = Clock::now();
+	std::chrono::nanoseconds cpuStart = getThreadCpuTime();
+	Moves moves = bot->getMoves(gameInfo);
+	std::chrono::nanoseconds cpu = getThreadCpuTime() - cpuStart;
+	Clock::duration time = Clock::now() - start;
+
+	std::lock_guard<std::mutex> lock(m_statsMutex);
+	m_stats.turns++;
+	m_stats.botTime += time;
+	m_stats.maxBotTime = std::max(m_stats.maxBotTime, time);
+	m_stats.botCpu += cpu;
+	m_latency.bot.record(time);
+	return moves;
+}
+
+void GameClient::asyncConnect()
+{
+	// Look up the domain name and connect to the server using the results of the lookup.
+	auto resolver = std::make_shared<boost::asio::ip::tcp::resolver>(m_ioc);
+	resolver->async_resolve(m_host, m_port, boost::asio::bind_executor(m_strand,
+		[this, resolver](const boost::system::error_code& ec, boost::asio::ip::tcp::resolver::results_type results)
 	{
-		if (doc.HasMember("players") && doc["players"].IsArray())
+		if (ec)
 		{
-			// Copy the players so we hold on to their smart pointer and clear the official map.
-			Players hold = m_gameInfo.players;
-			m_gameInfo.players.clear();
+			std::cout << "Error connecting to host " << m_host << ":" << m_port << ". The server might not be running, or your command line parameters might be incorrect. Code: " << ec.message() << std::endl;
+			asyncRetry([this]() { asyncConnect(); });
+			return;
+		}
 
-			// Process the players.
-			const rapidjson::Value& playersVal = doc["players"];
-			if (playersVal.IsArray())
+		boost::asio::async_connect(m_socket, results, boost::asio::bind_executor(m_strand,
+			[this](const boost::system::error_code& ec, const boost::asio::ip::tcp::endpoint&)
+		{
+			if (ec)
 			{
-				for (auto& playerObj : playersVal.GetArray())
-				{
-					const char* playerName = playerObj["name"].GetString();
-					std::shared_ptr<Player> player;
-					if (!hold[playerName])
-					{
-						player = std::shared_ptr<Player>(new Player());
-						player->name = playerName;
-					}
-					else
-					{
-						player = hold[playerName];
-					}
-
-					player->id = playerObj["id"].GetInt();
-					player->score = playerObj["score"].GetInt();
-
-					if (playerObj.HasMember("pos"))
-					{
-						const rapidjson::Value& pos = playerObj["pos"];
-						player->pos.set(pos["x"].GetInt(), pos["y"].GetInt());
-					}
-					else
-					{
-						player->pos.set(Position::UNKNOWN_POS, Position::UNKNOWN_POS);
-					}
-
-					if (playerObj.HasMember("dir"))
-					{
-						const rapidjson::Value& dir = playerObj["dir"];
-						player->dir.set(dir["x"].GetInt(), dir["y"].GetInt());
-					}
-					else
-					{
-						player->dir.set(Position::UNKNOWN_POS, Position::UNKNOWN_POS);
-					}
-
-					// Add the player to the player map.
-					m_gameInfo.players[player->name] = player;
-				}
+				std::cout << "Error connecting to host " << m_host << ":" << m_port << ". The server might not be running, or your command line parameters might be incorrect. Code: " << ec.message() << std::endl;
+				asyncRetry([this]() { asyncConnect(); });
+				return;
 			}
+
+			m_connected = true;
+			asyncJoinLobby();
+		}));
+	}));
+}
+
+void GameClient::asyncJoinLobby()
+{
+	std::string botInfo = serializeJoinRequest(m_requestedBotName.c_str(), m_persistent);
+	asyncRequest(http::verb::post, "/players", botInfo, false, [this](std::string& body)
+	{
+		processJoinResponse(body);
+		if (!m_quiet)
+		{
+			std::cout << "Checking for available games ...";
 		}
+		asyncFindGame();
+	});
+}
 
-		if (doc.HasMember("board") && doc["board"].IsArray())
+void GameClient::asyncFindGame()
+{
+	asyncRequest(http::verb::get, "/games", std::string(), true, [this](std::string& body)
+	{
+		std::vector<std::string> games = parseGames(body);
+		if (games.empty())
 		{
-			// The board state is an array (rows) of arrays (columns) of pairs (owner, trail IDs).
-			int index = 0;
-			const rapidjson::Value& rows = doc["board"];
-			if (rows.IsArray())
+			if (!m_quiet)
 			{
-				// Get the width and height of the partial board and allocate memory for the owner and trail IDs.
-				board.height = rows.Size();
-				board.width = board.height > 0 ? rows.GetArray()[0].Size() : 0;
-				board.ownerIDs.resize(board.width * board.height);
-				board.trailIDs.resize(board.width * board.height);
-
-				// Loop over each row.
-				//std::cout << U("board:") << std::endl;
-				for (const auto& rowObj : rows.GetArray())
-				{
-					// Loop over each column in the row.
-					for (const auto& colObj : rowObj.GetArray())
-					{
-						// Parse the data. It's in the format "<owner_id>,<trail_id>".
-						int owner = Player::NO_PLAYER;
-						int trail = Player::NO_PLAYER;
-						const char* col = colObj.GetString();
-
-						// Convert the owner ID to an int.
-						if (*col != ',')
-						{
-							for (owner = 0; *col != ','; col++)
-							{
-								owner = owner * 10 + *col - '0';
-							}
-						}
-
-						// Skip over the comma.
-						col++;
-
-						// Convert the trail ID to an int.
-						if (*col != 0)
-						{
-							for (trail = 0; *col != 0; col++)
-							{
-								trail = trail * 10 + *col - '0';
-							}
-						}
-
-						board.ownerIDs[index] = owner;
-						board.trailIDs[index] = trail;
-						index++;
-						//std::cout << (owner.length() > 0 ? owner : U("."));
-						//std::cout << (trail.length() > 0 ? trail : U(" "));
-					}
-					//std::cout << std::endl;
-				}
+				std::cout << "." << std::flush;
 			}
+			asyncRetry([this]() { asyncFindGame(); });
+			return;
+		}
+
+		if (!m_quiet)
+		{
+			std::cout << std::endl << "Joining game: " << games[0] << std::endl;
+		}
+		m_gameName = games[0];
+		m_gameUri = "/games/" + encodeUri(m_gameName);
+		m_moveRequests.prepare(m_host, m_gameUri, m_token);
+		countGame();
+		if (m_recorder)
+		{
+			m_recorder->recordGame(m_botName, m_gameName);
+		}
+		asyncStartGame();
+	});
+}
+
+void GameClient::asyncStartGame()
+{
+	// Send empty moves to start the game and get the initial board state.
+	m_gameStarting = true;
+	m_turnsPlayed = 0;
+	m_turnsLate = 0;
+	asyncSendMoves(Moves());
+}
+
+void GameClient::asyncSendMoves(const Moves& moves)
+{
+	m_movesSent = true;
+	m_turnStart = Clock::now();
+	if (m_recorder)
+	{
+		m_recorder->recordMoves(moves);
+	}
+	ResponseHandler onGameState = [this](std::string& body)
+	{
+		onGameStateReceived(m_turnStart);
+		m_pendingState.swap(body);
+		m_statePending = true;
+
+		// If the bot is still thinking about the last turn, it's reading m_gameInfo. Wait for it to finish.
+		if (!m_botBusy)
+		{
+			asyncProcessGameState();
+		}
+	};
+
+	// Use the ready-made request if there is one.
+	MoveRequests::Buffers request;
+	if (!m_moveRequests.getRequest(moves, request))
+	{
+		asyncRequest(http::verb::post, m_gameUri.c_str(), serializeMoves(moves), true, onGameState);
+		return;
+	}
+
+	m_requestReady = Clock::now();
+	boost::asio::async_write(m_socket, request, boost::asio::bind_executor(m_strand,
+		[this, onGameState](const boost::system::error_code& ec, std::size_t)
+	{
+		if (ec)
+		{
+			asyncFail(ec.message());
+			return;
+		}
+
+		m_requestWritten = Clock::now();
+		asyncReadResponse(onGameState);
+	}));
+}
+
+void GameClient::asyncProcessGameState()
+{
+	m_statePending = false;
+	if (m_gameStarting)
+	{
+		m_gameInfo.reset();
+	}
+	if (m_recorder)
+	{
+		m_recorder->recordState(m_pendingState);
+	}
+	Clock::time_point parseStart = Clock::now();
+	try
+	{
+		processGameState(m_pendingState);
+	}
+	catch (std::exception& e)
+	{
+		asyncFail(e.what());
+		return;
+	}
+
+	recordTurnLatency(parseStart);
+
+	if (m_gameStarting)
+	{
+		// Initialize the bot. This gives it a chance to set up bookkeeping, etc.
+		m_gameStarting = false;
+		m_bot->setPlayer(m_gameInfo.players[m_botName]);
+		m_bot->init(m_gameInfo.boardWidth, m_gameInfo.boardHeight);
+	}
+
+	if (m_gameInfo.gameOver)
+	{
+		if (m_recorder)
+		{
+			m_recorder->flush();
+		}
+		if (!m_quiet)
+		{
+			std::cout << "Game over. The bot missed the deadline on " << m_turnsLate << " of " << m_turnsPlayed << " turns." << std::endl;
+			getLatency().print(std::cout, "turn latency");
+			std::cout << "Checking for available games ...";
+		}
+		asyncFindGame();
+		return;
+	}
+
+	asyncStartTurn();
+}
+
+void GameClient::asyncStartTurn()
+{
+	unsigned turn = ++m_turn;
+	m_turnsPlayed++;
+	m_movesSent = false;
+	m_botBusy = true;
+
+	// If the bot runs past the deadline, send moves without it.
+	m_deadlineTimer.expires_at(m_gameInfo.deadline);
+	m_deadlineTimer.async_wait(boost::asio::bind_executor(m_strand, [this, turn](const boost::system::error_code& ec)
+	{
+		if (!ec)
+		{
+			onTurnDeadline(turn);
+		}
+	}));
+
+	Bot* bot = m_bot;
+	auto getMoves = [this, bot, turn]()
+	{
+		Moves moves;
+		std::string error;
+		try
+		{
+			moves = callBot(bot, m_gameInfo);
 		}
+		catch (std::exception& e)
+		{
+			error = e.what();
+		}
+		boost::asio::post(m_strand, [this, turn, moves, error]() { onBotMoves(turn, moves, error); });
+	};
+
+	if (m_botThread)
+	{
+		boost::asio::post(*m_botThread, getMoves);
 	}
 	else
 	{
-		m_gameInfo.players.clear();
-		m_gameInfo.partialBoard.ownerIDs.clear();
-		m_gameInfo.partialBoard.trailIDs.clear();
+		boost::asio::post(m_ioc, getMoves);
 	}
 }
 
+void GameClient::onBotMoves(unsigned turn, const Moves& moves, const std::string& error)
+{
+	m_botBusy = false;
+	if (!error.empty())
+	{
+		asyncFail(error);
+		return;
+	}
+
+	if (turn == m_turn && !m_movesSent)
+	{
+		m_deadlineTimer.cancel();
+		asyncSendMoves(moves);
+	}
+	else if (m_statePending)
+	{
+		// The bot was late and the next game state is already here.
+		asyncProcessGameState();
+	}
+}
+
+void GameClient::onTurnDeadline(unsigned turn)
+{
+	if (turn == m_turn && !m_movesSent)
+	{
+		// Empty moves keep the bot going in the same direction, and still count as moving this turn.
+		m_turnsLate++;
+		{
+			std::lock_guard<std::mutex> lock(m_statsMutex);
+			m_stats.turnsLate++;
+		}
+		asyncSendMoves(Moves());
+	}
+}
+
+void GameClient::asyncRequest(http::verb verb, const char* target, const std::string& body, bool useAuthorization, ResponseHandler handler)
+{
+	prepareRequest(m_request, verb, target, body, useAuthorization);
+	m_requestReady = Clock::now();
+	http::async_write(m_socket, m_request, boost::asio::bind_executor(m_strand,
+		[this, handler](const boost::system::error_code& ec, std::size_t)
+	{
+		if (ec)
+		{
+			asyncFail(ec.message());
+			return;
+		}
+
+		m_requestWritten = Clock::now();
+		asyncReadResponse(handler);
+	}));
+}
+
+void GameClient::asyncReadResponse(ResponseHandler handler)
+{
+	prepareResponse();
+	http::async_read(m_socket, m_buffer, m_response, boost::asio::bind_executor(m_strand,
+		[this, handler](const boost::system::error_code& ec, std::size_t)
+	{
+		if (ec)
+		{
+			asyncFail(ec.message());
+			return;
+		}
+
+		try
+		{
+			handler(m_response.body());
+		}
+		catch (std::exception& e)
+		{
+			asyncFail(e.what());
+		}
+	}));
+}
+
+void GameClient::asyncFail(const std::string& what)
+{
+	// Something unexpected happened. Reconnect and join a new game, as play() does.
+	std::cout << "Exception playing game: " << what << std::endl;
+
+	m_turn++;
+	m_movesSent = true;
+	m_statePending = false;
+	m_gameStarting = false;
+	m_deadlineTimer.cancel();
+	m_buffer.consume(m_buffer.size());
+
+	boost::system::error_code ignored;
+	m_socket.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ignored);
+	m_socket.close(ignored);
+	m_connected = false;
+
+	asyncRetry([this]() { asyncConnect(); });
+}
+
+void GameClient::asyncRetry(std::function<void()> step)
+{
+	m_retryTimer.expires_after(RETRY_DELAY);
+	m_retryTimer.async_wait(boost::asio::bind_executor(m_strand, [step](const boost::system::error_code& ec)
+	{
+		if (!ec)
+		{
+			step();
+		}
+	}));
+}
+
 std::string GameClient::encodeUri(const std::string& value)
 {
 	std::ostringstream escaped;
@@ -1,5 +1,9 @@
 #include "GameInfo.h"
 
+#include <algorithm>
+#include <climits>
+#include <stdexcept>
+
 /**********************************************************************************************************************
  *********************************************************************************************************************/
 Position::Position(int _x, int _y)
@@ -23,18 +27,174 @@ Direction Direction::Right(1, 0);
 
 /**********************************************************************************************************************
  *********************************************************************************************************************/
+Player::Player() :
+	id(NO_PLAYER),
+	score(0),
+	pos(Position::UNKNOWN_POS, Position::UNKNOWN_POS),
+	dir(Position::UNKNOWN_POS, Position::UNKNOWN_POS)
+{
+}
+
+/**********************************************************************************************************************
+ *********************************************************************************************************************/
+Players::Players() :
+	m_firstId(0),
+	m_update(0),
+	m_nextSlot(0)
+{
+}
+
+void Players::clear()
+{
+	m_entries.clear();
+	m_updates.clear();
+	m_slotsByName.clear();
+	m_slotsById.clear();
+	m_firstId = 0;
+	m_nextSlot = 0;
+}
+
+Players::iterator Players::find(const std::string& name)
+{
+	int slot = findSlot(name);
+	return slot >= 0 ? m_entries.begin() + slot : m_entries.end();
+}
+
+Players::const_iterator Players::find(const std::string& name) const
+{
+	int slot = findSlot(name);
+	return slot >= 0 ? m_entries.begin() + slot : m_entries.end();
+}
+
+std::shared_ptr<Player>& Players::operator[](const std::string& name)
+{
+	int slot = findSlot(name);
+	if (slot < 0)
+	{
+		slot = addSlot(name);
+		m_updates[slot] = m_update;
+	}
+	return m_entries[slot].second;
+}
+
 Player* Players::findPlayerById(int playerId) const
 {
-	for (auto it = begin(); it != end(); ++it)
+	int index = playerId - m_firstId;
+	if (index < 0 || index >= (int)m_slotsById.size() || m_slotsById[index] < 0)
+	{
+		return nullptr;
+	}
+
+	// The index is rebuilt by endUpdate(), so check it's still right: a player's ID could have been changed since.
+	Player* player = m_entries[m_slotsById[index]].second.get();
+	return player->id == playerId ? player : nullptr;
+}
+
+void Players::beginUpdate()
+{
+	m_update++;
+	m_nextSlot = 0;
+}
+
+Player& Players::update(const std::string& name)
+{
+	// The server lists the players in much the same order each turn, so try the next slot before the index.
+	int slot = m_nextSlot < (int)m_entries.size() && m_entries[m_nextSlot].first == name ? m_nextSlot : findSlot(name);
+	if (slot < 0)
+	{
+		slot = addSlot(name);
+	}
+	m_updates[slot] = m_update;
+	m_nextSlot = slot + 1;
+	return *m_entries[slot].second;
+}
+
+void Players::endUpdate()
+{
+	// Drop the players that have left, keeping the others in order.
+	size_t kept = 0;
+	for (size_t slot = 0; slot < m_entries.size(); slot++)
+	{
+		if (m_updates[slot] == m_update)
+		{
+			if (kept != slot)
+			{
+				m_entries[kept].first.swap(m_entries[slot].first);
+				m_entries[kept].second.swap(m_entries[slot].second);
+				m_updates[kept] = m_updates[slot];
+			}
+			kept++;
+		}
+	}
+
+	bool moved = kept != m_entries.size();
+	if (moved)
+	{
+		m_entries.resize(kept);
+		m_updates.resize(kept);
+		m_slotsByName.clear();
+		for (size_t slot = 0; slot < m_entries.size(); slot++)
+		{
+			m_slotsByName[m_entries[slot].first] = (int)slot;
+		}
+	}
+
+	indexIds(moved);
+}
+
+int Players::findSlot(const std::string& name) const
+{
+	auto it = m_slotsByName.find(name);
+	return it != m_slotsByName.end() ? it->second : -1;
+}
+
+int Players::addSlot(const std::string& name)
+{
+	int slot = (int)m_entries.size();
+	std::shared_ptr<Player> player = std::make_shared<Player>();
+	player->name = name;
+	m_entries.push_back(Entry(name, player));
+	m_updates.push_back(0);
+	m_slotsByName[name] = slot;
+	return slot;
+}
+
+void Players::indexIds(bool moved)
+{
+	// Usually no one has come or gone.
+	int firstId = INT_MAX;
+	int lastId = INT_MIN;
+	bool current = !moved;
+	for (size_t slot = 0; slot < m_entries.size(); slot++)
 	{
-		Player* player = it->second.get();
-		if (player->id == playerId)
+		int id = m_entries[slot].second->id;
+		if (id >= 0)
 		{
-			return player;
+			firstId = std::min(firstId, id);
+			lastId = std::max(lastId, id);
+			current = current && id - m_firstId < (int)m_slotsById.size() && id >= m_firstId && m_slotsById[id - m_firstId] == (int)slot;
 		}
 	}
+	if (lastId < firstId)
+	{
+		firstId = 0;
+		lastId = -1;
+	}
+	if (current && firstId == m_firstId && (size_t)(lastId - firstId + 1) == m_slotsById.size())
+	{
+		return;
+	}
 
-	return nullptr;
+	m_firstId = firstId;
+	m_slotsById.assign(lastId - firstId + 1, -1);
+	for (size_t slot = 0; slot < m_entries.size(); slot++)
+	{
+		int id = m_entries[slot].second->id;
+		if (id >= 0)
+		{
+			m_slotsById[id - m_firstId] = (int)slot;
+		}
+	}
 }
 
 /**********************************************************************************************************************
@@ -43,14 +203,96 @@ Board::Board() :
 	width(0),
 	height(0)
 {
+	clearSlots();
 }
 
 void Board::reset()
 {
 	width = 0;
 	height = 0;
-	ownerIDs.clear();
-	trailIDs.clear();
+	cells.clear();
+	clearSlots();
+}
+
+void Board::resize(int _width, int _height)
+{
+	width = _width;
+	height = _height;
+	cells.resize(width * height);
+}
+
+int Board::findSlot(int playerId) const
+{
+	if (playerId == Player::NO_PLAYER)
+	{
+		return 0;
+	}
+	for (int slot = 1; slot < m_slotCount; slot++)
+	{
+		if (m_playerIds[slot] == playerId)
+		{
+			return slot;
+		}
+	}
+	return NO_SLOT;
+}
+
+void Board::clearSlots()
+{
+	m_playerIds[0] = Player::NO_PLAYER;
+	m_slotCount = 1;
+}
+
+void Board::compactSlots()
+{
+	// Find the slots in use, then move them down over the others.
+	std::array<uint8_t, MAX_SLOTS> newSlots = {};
+	for (const Cell& cell : cells)
+	{
+		newSlots[cell.owner] = 1;
+		newSlots[cell.trail] = 1;
+	}
+
+	int count = 1;
+	for (int slot = 1; slot < m_slotCount; slot++)
+	{
+		if (newSlots[slot])
+		{
+			m_playerIds[count] = m_playerIds[slot];
+			newSlots[slot] = (uint8_t)count++;
+		}
+	}
+	newSlots[0] = 0;
+
+	if (count < m_slotCount)
+	{
+		m_slotCount = count;
+		for (Cell& cell : cells)
+		{
+			cell.owner = newSlots[cell.owner];
+			cell.trail = newSlots[cell.trail];
+		}
+	}
+}
+
+uint8_t Board::addSlot(int playerId)
+{
+	int slot = findSlot(playerId);
+	if (slot != NO_SLOT)
+	{
+		return (uint8_t)slot;
+	}
+
+	if (m_slotCount == MAX_SLOTS)
+	{
+		compactSlots();
+		if (m_slotCount == MAX_SLOTS)
+		{
+			throw std::runtime_error("Too many players on the board");
+		}
+	}
+	m_playerIds[m_slotCount] = playerId;
+	return (uint8_t)m_slotCount++;
 }
 
 /**********************************************************************************************************************
@@ -59,6 +301,29 @@ PartialBoard::PartialBoard() : Board()
 {
 }
 
+/**********************************************************************************************************************
+ *********************************************************************************************************************/
+TurnChanges::TurnChanges() :
+	hasPrevious(false),
+	previousWidth(0),
+	previousHeight(0)
+{
+}
+
+void TurnChanges::clear()
+{
+	hasPrevious = false;
+	previousOffset.set(0, 0);
+	previousWidth = 0;
+	previousHeight = 0;
+	spaces.clear();
+	joined.clear();
+	left.clear();
+	enteredView.clear();
+	leftView.clear();
+	scores.clear();
+}
+
 /**********************************************************************************************************************
  *********************************************************************************************************************/
 GameInfo::GameInfo() :
@@ -73,6 +338,8 @@ void GameInfo::reset()
 	boardWidth = 0;
 	boardHeight = 0;
 	gameOver = false;
+	deadline = std::chrono::steady_clock::time_point();
 	partialBoard.reset();
 	players.clear();
+	changes.clear();
 }
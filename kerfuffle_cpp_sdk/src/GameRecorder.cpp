@@ -0,0 +1,236 @@
+#include "GameRecorder.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	const char MAGIC[4] = { 'K', 'G', 'R', 'L' };
+	const size_t FILE_BUFFER_SIZE = 1 << 16;
+
+	void putUInt(char* out, uint64_t value, int bytes)
+	{
+		for (int i = 0; i < bytes; i++)
+		{
+			out[i] = (char)(value >> (i * 8));
+		}
+	}
+
+	uint64_t getUInt(const char* in, int bytes)
+	{
+		uint64_t value = 0;
+		for (int i = 0; i < bytes; i++)
+		{
+			value |= (uint64_t)(unsigned char)in[i] << (i * 8);
+		}
+		return value;
+	}
+}
+
+/**********************************************************************************************************************
+ *********************************************************************************************************************/
+GameRecorder::GameRecorder(const std::string& path) :
+	m_file(nullptr),
+	m_start(std::chrono::steady_clock::now()),
+	m_fileBuffer(FILE_BUFFER_SIZE)
+{
+	m_file = std::fopen(path.c_str(), "ab");
+	if (m_file == nullptr)
+	{
+		throw std::runtime_error("Unable to open " + path + " for recording");
+	}
+	std::setvbuf(m_file, m_fileBuffer.data(), _IOFBF, m_fileBuffer.size());
+
+	// A new file gets the header. Appending to an old one continues it, with times starting over from 0.
+	std::fseek(m_file, 0, SEEK_END);
+	if (std::ftell(m_file) == 0)
+	{
+		char header[HEADER_SIZE];
+		std::memcpy(header, MAGIC, sizeof(MAGIC));
+		putUInt(header + 4, VERSION, 4);
+		std::fwrite(header, 1, sizeof(header), m_file);
+	}
+}
+
+GameRecorder::~GameRecorder()
+{
+	std::fclose(m_file);
+}
+
+void GameRecorder::recordGame(const std::string& botName, const std::string& gameName)
+{
+	std::string payload = botName;
+	payload += '\0';
+	payload += gameName;
+	write(RECORD_GAME, payload.data(), payload.size());
+}
+
+void GameRecorder::recordState(const std::string& json)
+{
+	write(RECORD_STATE, json.data(), json.size());
+}
+
+void GameRecorder::recordMoves(const Moves& moves)
+{
+	m_moves.clear();
+	for (const Direction& dir : moves)
+	{
+		m_moves += (char)(int8_t)dir.x;
+		m_moves += (char)(int8_t)dir.y;
+	}
+	write(RECORD_MOVES, m_moves.data(), m_moves.size());
+}
+
+void GameRecorder::flush()
+{
+	std::fflush(m_file);
+}
+
+void GameRecorder::write(RecordType type, const char* data, size_t size)
+{
+	int64_t time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start).count();
+	char header[RECORD_HEADER_SIZE];
+	header[0] = (char)type;
+	putUInt(header + 1, size, 4);
+	putUInt(header + 5, (uint64_t)time, 8);
+	std::fwrite(header, 1, sizeof(header), m_file);
+	std::fwrite(data, 1, size, m_file);
+}
+
+/**********************************************************************************************************************
+ *********************************************************************************************************************/
+GameRecording::GameRecording() :
+	m_data(nullptr),
+	m_size(0),
+	m_offset(HEADER_SIZE)
+#ifdef _WIN32
+	, m_fileHandle(INVALID_HANDLE_VALUE),
+	m_mappingHandle(nullptr)
+#endif
+{
+}
+
+GameRecording::~GameRecording()
+{
+	close();
+}
+
+void GameRecording::open(const std::string& path)
+{
+	close();
+
+#ifdef _WIN32
+	m_fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	LARGE_INTEGER size;
+	if (m_fileHandle == INVALID_HANDLE_VALUE || !GetFileSizeEx(m_fileHandle, &size))
+	{
+		close();
+		throw std::runtime_error("Unable to read " + path);
+	}
+	m_size = (size_t)size.QuadPart;
+	if (m_size >= HEADER_SIZE)
+	{
+		m_mappingHandle = CreateFileMappingA(m_fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		m_data = m_mappingHandle ? (const char*)MapViewOfFile(m_mappingHandle, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	}
+#else
+	int fd = ::open(path.c_str(), O_RDONLY);
+	struct stat info;
+	if (fd < 0 || fstat(fd, &info) != 0)
+	{
+		if (fd >= 0)
+		{
+			::close(fd);
+		}
+		throw std::runtime_error("Unable to read " + path);
+	}
+	m_size = (size_t)info.st_size;
+	if (m_size >= HEADER_SIZE)
+	{
+		void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (data != MAP_FAILED)
+		{
+			// Records are read front to back.
+			madvise(data, m_size, MADV_SEQUENTIAL);
+			m_data = (const char*)data;
+		}
+	}
+	::close(fd);
+#endif
+
+	if (m_data == nullptr || std::memcmp(m_data, MAGIC, sizeof(MAGIC)) != 0 || getUInt(m_data + 4, 4) != GameRecorder::VERSION)
+	{
+		close();
+		throw std::runtime_error(path + " isn't a game recording");
+	}
+	m_offset = HEADER_SIZE;
+}
+
+void GameRecording::close()
+{
+#ifdef _WIN32
+	if (m_data)
+	{
+		UnmapViewOfFile(m_data);
+	}
+	if (m_mappingHandle)
+	{
+		CloseHandle(m_mappingHandle);
+		m_mappingHandle = nullptr;
+	}
+	if (m_fileHandle != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(m_fileHandle);
+		m_fileHandle = INVALID_HANDLE_VALUE;
+	}
+#else
+	if (m_data)
+	{
+		munmap((void*)m_data, m_size);
+	}
+#endif
+	m_data = nullptr;
+	m_size = 0;
+	m_offset = HEADER_SIZE;
+}
+
+bool GameRecording::next(Record& record)
+{
+	if (m_data == nullptr || m_offset > m_size || m_size - m_offset < (size_t)GameRecorder::RECORD_HEADER_SIZE)
+	{
+		return false;
+	}
+
+	const char* header = m_data + m_offset;
+	uint32_t size = (uint32_t)getUInt(header + 1, 4);
+	if (m_size - m_offset - GameRecorder::RECORD_HEADER_SIZE < size)
+	{
+		return false;
+	}
+
+	record.type = (RecordType)(unsigned char)header[0];
+	record.size = size;
+	record.time = (int64_t)getUInt(header + 5, 8);
+	record.data = header + GameRecorder::RECORD_HEADER_SIZE;
+	m_offset += GameRecorder::RECORD_HEADER_SIZE + size;
+	return true;
+}
+
+void GameRecording::getMoves(const Record& record, Moves& moves)
+{
+	moves.clear();
+	for (uint32_t i = 0; i + 1 < record.size; i += 2)
+	{
+		moves.addMove(Direction((int8_t)record.data[i], (int8_t)record.data[i + 1]));
+	}
+}
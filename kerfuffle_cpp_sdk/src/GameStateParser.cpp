@@ -0,0 +1,676 @@
+#include "GameStateParser.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "rapidjson/reader.h"
+
+namespace
+{
+	bool isKey(const char* str, rapidjson::SizeType length, const char* key)
+	{
+		return std::strlen(key) == length && std::memcmp(str, key, length) == 0;
+	}
+
+	// Whether the board holds a view. Once the game is over, its size is left as it was but the spaces are gone.
+	bool hasView(const Board& board)
+	{
+		return board.width > 0 && board.height > 0 && board.cells.size() >= (size_t)board.width * board.height;
+	}
+
+	/******************************************************************************************************************
+	 * A rapidjson SAX handler that decodes a game state as it's read, writing straight into GameInfo. The state is
+	 * an object with boardWidth, boardHeight, viewOrigin, board, players and over. Anything else is skipped.
+	 *****************************************************************************************************************/
+	class GameStateHandler : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, GameStateHandler>
+	{
+	public:
+		GameStateHandler(GameInfo& gameInfo, std::string& name) :
+			m_gameInfo(gameInfo),
+			m_board(gameInfo.partialBoard),
+			m_name(name),
+			m_state(START),
+			m_key(FIELD_OTHER),
+			m_skip(0),
+			m_index(0),
+			m_rows(0),
+			m_columns(0)
+		{
+		}
+
+		bool isDone() const { return m_state == DONE; }
+
+		bool Bool(bool b)
+		{
+			if (m_skip == 0 && m_state == ROOT && m_key == FIELD_OVER)
+			{
+				m_gameInfo.gameOver = b;
+			}
+			return true;
+		}
+
+		bool Int(int i)
+		{
+			if (m_skip > 0)
+			{
+				return true;
+			}
+
+			switch (m_state)
+			{
+			case ROOT:
+				if (m_key == FIELD_BOARD_WIDTH) m_gameInfo.boardWidth = i;
+				else if (m_key == FIELD_BOARD_HEIGHT) m_gameInfo.boardHeight = i;
+				break;
+			case VIEW_ORIGIN:
+				if (m_key == FIELD_X) m_board.boardOffset.x = i;
+				else if (m_key == FIELD_Y) m_board.boardOffset.y = i;
+				break;
+			case PLAYER:
+				if (m_key == FIELD_ID) m_player.id = i;
+				else if (m_key == FIELD_SCORE) m_player.score = i;
+				break;
+			case PLAYER_POS:
+				if (m_key == FIELD_X) m_player.pos.x = i;
+				else if (m_key == FIELD_Y) m_player.pos.y = i;
+				break;
+			case PLAYER_DIR:
+				if (m_key == FIELD_X) m_player.dir.x = i;
+				else if (m_key == FIELD_Y) m_player.dir.y = i;
+				break;
+			default:
+				break;
+			}
+			return true;
+		}
+
+		bool Uint(unsigned u) { return Int((int)u); }
+
+		bool String(const char* str, rapidjson::SizeType length, bool)
+		{
+			if (m_skip > 0)
+			{
+				return true;
+			}
+
+			if (m_state == ROW)
+			{
+				addSpace(str, str + length);
+			}
+			else if (m_state == PLAYER && m_key == FIELD_NAME)
+			{
+				m_name.assign(str, length);
+			}
+			return true;
+		}
+
+		bool Key(const char* str, rapidjson::SizeType length, bool)
+		{
+			if (m_skip > 0)
+			{
+				return true;
+			}
+
+			m_key = FIELD_OTHER;
+			switch (m_state)
+			{
+			case ROOT:
+				if (isKey(str, length, "board")) m_key = FIELD_BOARD;
+				else if (isKey(str, length, "players")) m_key = FIELD_PLAYERS;
+				else if (isKey(str, length, "viewOrigin")) m_key = FIELD_VIEW_ORIGIN;
+				else if (isKey(str, length, "boardWidth")) m_key = FIELD_BOARD_WIDTH;
+				else if (isKey(str, length, "boardHeight")) m_key = FIELD_BOARD_HEIGHT;
+				else if (isKey(str, length, "over")) m_key = FIELD_OVER;
+				break;
+			case PLAYER:
+				if (isKey(str, length, "name")) m_key = FIELD_NAME;
+				else if (isKey(str, length, "id")) m_key = FIELD_ID;
+				else if (isKey(str, length, "score")) m_key = FIELD_SCORE;
+				else if (isKey(str, length, "pos")) m_key = FIELD_POS;
+				else if (isKey(str, length, "dir")) m_key = FIELD_DIR;
+				break;
+			case VIEW_ORIGIN:
+			case PLAYER_POS:
+			case PLAYER_DIR:
+				if (isKey(str, length, "x")) m_key = FIELD_X;
+				else if (isKey(str, length, "y")) m_key = FIELD_Y;
+				break;
+			default:
+				break;
+			}
+			return true;
+		}
+
+		bool StartObject()
+		{
+			if (m_skip > 0)
+			{
+				m_skip++;
+			}
+			else if (m_state == START)
+			{
+				m_state = ROOT;
+			}
+			else if (m_state == ROOT && m_key == FIELD_VIEW_ORIGIN)
+			{
+				m_state = VIEW_ORIGIN;
+			}
+			else if (m_state == PLAYERS)
+			{
+				startPlayer();
+				m_state = PLAYER;
+			}
+			else if (m_state == PLAYER && m_key == FIELD_POS)
+			{
+				m_player.hasPos = true;
+				m_state = PLAYER_POS;
+			}
+			else if (m_state == PLAYER && m_key == FIELD_DIR)
+			{
+				m_player.hasDir = true;
+				m_state = PLAYER_DIR;
+			}
+			else
+			{
+				m_skip = 1;
+			}
+			return m_state != START;
+		}
+
+		bool EndObject(rapidjson::SizeType)
+		{
+			if (m_skip > 0)
+			{
+				m_skip--;
+			}
+			else if (m_state == ROOT)
+			{
+				m_state = DONE;
+			}
+			else if (m_state == VIEW_ORIGIN)
+			{
+				m_state = ROOT;
+			}
+			else if (m_state == PLAYER)
+			{
+				endPlayer();
+				m_state = PLAYERS;
+			}
+			else if (m_state == PLAYER_POS || m_state == PLAYER_DIR)
+			{
+				m_state = PLAYER;
+			}
+			return true;
+		}
+
+		bool StartArray()
+		{
+			if (m_skip > 0)
+			{
+				m_skip++;
+			}
+			else if (m_state == ROOT && m_key == FIELD_BOARD)
+			{
+				m_index = 0;
+				m_rows = 0;
+				m_columns = 0;
+				m_state = BOARD_ROWS;
+			}
+			else if (m_state == BOARD_ROWS)
+			{
+				m_state = ROW;
+			}
+			else if (m_state == ROOT && m_key == FIELD_PLAYERS)
+			{
+				m_gameInfo.players.beginUpdate();
+				m_state = PLAYERS;
+			}
+			else
+			{
+				m_skip = 1;
+			}
+			return m_state != START;
+		}
+
+		bool EndArray(rapidjson::SizeType count)
+		{
+			if (m_skip > 0)
+			{
+				m_skip--;
+			}
+			else if (m_state == ROW)
+			{
+				if (m_rows++ == 0)
+				{
+					m_columns = (int)count;
+				}
+				m_state = BOARD_ROWS;
+			}
+			else if (m_state == BOARD_ROWS)
+			{
+				m_board.resize(m_rows > 0 ? m_columns : 0, m_rows);
+				m_state = ROOT;
+			}
+			else if (m_state == PLAYERS)
+			{
+				m_gameInfo.players.endUpdate();
+				m_state = ROOT;
+			}
+			return true;
+		}
+
+		// Numbers the server never sends, and nulls, are skipped.
+		bool Default() { return m_state != START; }
+
+	private:
+		void addSpace(const char* col, const char* end)
+		{
+			// The board arrives one space at a time, so its size isn't known until the end. Use the space there is,
+			// which is usually the size of the last view, and grow it if needed.
+			if (m_index >= (int)m_board.cells.size())
+			{
+				m_board.cells.resize(std::max<size_t>(m_board.cells.size() * 2, 1024));
+			}
+
+			// Parse the data. It's in the format "<owner_id>,<trail_id>".
+			int owner = Player::NO_PLAYER;
+			int trail = Player::NO_PLAYER;
+
+			// Convert the owner ID to an int.
+			if (col != end && *col != ',')
+			{
+				for (owner = 0; col != end && *col != ','; col++)
+				{
+					owner = owner * 10 + *col - '0';
+				}
+			}
+
+			// Skip over the comma.
+			if (col != end)
+			{
+				col++;
+			}
+
+			// Convert the trail ID to an int.
+			if (col != end)
+			{
+				for (trail = 0; col != end; col++)
+				{
+					trail = trail * 10 + *col - '0';
+				}
+			}
+
+			Cell& cell = m_board.cells[m_index++];
+			cell.owner = m_board.getSlot(owner);
+			cell.trail = m_board.getSlot(trail);
+		}
+
+		void startPlayer()
+		{
+			m_name.clear();
+			m_player.id = 0;
+			m_player.score = 0;
+			m_player.hasPos = false;
+			m_player.hasDir = false;
+			m_player.pos.set(Position::UNKNOWN_POS, Position::UNKNOWN_POS);
+			m_player.dir.set(Position::UNKNOWN_POS, Position::UNKNOWN_POS);
+		}
+
+		void endPlayer()
+		{
+			// Update the player in place.
+			Player& player = m_gameInfo.players.update(m_name);
+			player.id = m_player.id;
+			player.score = m_player.score;
+			player.pos = m_player.hasPos ? m_player.pos : Position(Position::UNKNOWN_POS, Position::UNKNOWN_POS);
+			player.dir = m_player.hasDir ? m_player.dir : Direction(Position::UNKNOWN_POS, Position::UNKNOWN_POS);
+		}
+
+	private:
+		enum State { START, ROOT, VIEW_ORIGIN, BOARD_ROWS, ROW, PLAYERS, PLAYER, PLAYER_POS, PLAYER_DIR, DONE };
+		enum Field { FIELD_OTHER, FIELD_OVER, FIELD_BOARD_WIDTH, FIELD_BOARD_HEIGHT, FIELD_VIEW_ORIGIN, FIELD_BOARD, FIELD_PLAYERS, FIELD_NAME, FIELD_ID, FIELD_SCORE, FIELD_POS, FIELD_DIR, FIELD_X, FIELD_Y };
+
+		struct PlayerFields
+		{
+			int id;
+			int score;
+			bool hasPos;
+			bool hasDir;
+			Position pos;
+			Direction dir;
+		};
+
+		GameInfo& m_gameInfo;
+		PartialBoard& m_board;
+		std::string& m_name;  // The name of the player being read.
+		PlayerFields m_player; // The rest of the player being read.
+		State m_state;
+		Field m_key;            // The last key read in the current object.
+		int m_skip;           // How deep we are in a value that's being skipped.
+		int m_index;          // The next space on the board.
+		int m_rows;
+		int m_columns;
+	};
+}
+
+GameStateParser::GameStateParser()
+{
+	allocate(INITIAL_VALUE_SIZE, INITIAL_STACK_SIZE);
+}
+
+void GameStateParser::allocate(size_t valueSize, size_t stackSize)
+{
+	// The document refers to the allocators, and the allocators to the buffers, so replace all of them together.
+	m_doc.reset();
+	m_valueAllocator.reset();
+	m_stackAllocator.reset();
+	m_valueBuffer.assign(valueSize, 0);
+	m_stackBuffer.assign(stackSize, 0);
+	m_valueAllocator.reset(new Allocator(m_valueBuffer.data(), m_valueBuffer.size()));
+	m_stackAllocator.reset(new Allocator(m_stackBuffer.data(), m_stackBuffer.size()));
+	m_doc.reset(new Document(m_valueAllocator.get(), DOCUMENT_STACK_CAPACITY, m_stackAllocator.get()));
+}
+
+void GameStateParser::clear()
+{
+	// If a pool ran out of room last time, it borrowed memory from the heap. Make the buffers big enough to hold that
+	// much. This drops the last DOM, which is done with by now.
+	size_t valueSize = std::max(m_valueBuffer.size(), m_valueAllocator->Capacity());
+	size_t stackSize = std::max(m_stackBuffer.size(), m_stackAllocator->Capacity());
+	if (valueSize > m_valueBuffer.size() || stackSize > m_stackBuffer.size())
+	{
+		allocate(valueSize + valueSize / 2, stackSize + stackSize / 2);
+	}
+
+	// A pool allocator never frees, so start each parse with an empty pool.
+	m_valueAllocator->Clear();
+	m_stackAllocator->Clear();
+}
+
+bool GameStateParser::parse(char* json, GameInfo& gameInfo)
+{
+	// Read the game state in one pass, straight into gameInfo.
+	saveTurn(gameInfo);
+	gameInfo.gameOver = false;
+	gameInfo.boardWidth = 0;
+	gameInfo.boardHeight = 0;
+
+	clear();
+	rapidjson::GenericReader<rapidjson::UTF8<>, rapidjson::UTF8<>, Allocator> reader(m_stackAllocator.get());
+	rapidjson::InsituStringStream stream(json);
+	GameStateHandler handler(gameInfo, m_name);
+	reader.Parse<rapidjson::kParseInsituFlag | rapidjson::kParseStopWhenDoneFlag>(stream, handler);
+
+	// If the game isn't an object (e.g., is "Not Found"), it's not a game state.
+	if (!handler.isDone())
+	{
+		gameInfo.changes.clear();
+		return false;
+	}
+
+	if (gameInfo.gameOver)
+	{
+		gameInfo.players.clear();
+		gameInfo.partialBoard.cells.clear();
+	}
+
+	findChanges(gameInfo);
+	return true;
+}
+
+bool GameStateParser::parseDom(char* json, GameInfo& gameInfo)
+{
+	// Parse the game state.
+	saveTurn(gameInfo);
+	clear();
+	Document& doc = *m_doc;
+	doc.ParseInsitu(json);
+
+	// If the game isn't an object (e.g., is "Not Found"), it's not a game state.
+	if (!doc.IsObject())
+	{
+		gameInfo.changes.clear();
+		return false;
+	}
+
+	gameInfo.gameOver = (doc.HasMember("over") && doc["over"].IsBool()) ? doc["over"].GetBool() : false;
+	gameInfo.boardWidth = (doc.HasMember("boardWidth") && doc["boardWidth"].IsInt()) ? doc["boardWidth"].GetInt() : 0;
+	gameInfo.boardHeight = (doc.HasMember("boardHeight") && doc["boardHeight"].IsInt()) ? doc["boardHeight"].GetInt() : 0;
+
+	// Get the view origin.
+	PartialBoard& board = gameInfo.partialBoard;
+	if (doc.HasMember("viewOrigin") && doc["viewOrigin"].IsObject())
+	{
+		const rapidjson::Value& v = doc["viewOrigin"];
+		board.boardOffset.x = v["x"].GetInt();
+		board.boardOffset.y = v["y"].GetInt();
+	}
+
+	// If the game isn't over, process the players and board.
+	if (!gameInfo.gameOver)
+	{
+		if (doc.HasMember("players") && doc["players"].IsArray())
+		{
+			readPlayers(doc["players"], gameInfo.players);
+		}
+
+		if (doc.HasMember("board") && doc["board"].IsArray())
+		{
+			readBoard(doc["board"], board);
+		}
+	}
+	else
+	{
+		gameInfo.players.clear();
+		board.cells.clear();
+	}
+
+	findChanges(gameInfo);
+	return true;
+}
+
+void GameStateParser::readPlayers(const rapidjson::Value& playersVal, Players& players)
+{
+	players.beginUpdate();
+	for (auto& playerObj : playersVal.GetArray())
+	{
+		// Update the player in place.
+		Player& player = players.update(playerObj["name"].GetString());
+		player.id = playerObj["id"].GetInt();
+		player.score = playerObj["score"].GetInt();
+
+		if (playerObj.HasMember("pos"))
+		{
+			const rapidjson::Value& pos = playerObj["pos"];
+			player.pos.set(pos["x"].GetInt(), pos["y"].GetInt());
+		}
+		else
+		{
+			player.pos.set(Position::UNKNOWN_POS, Position::UNKNOWN_POS);
+		}
+
+		if (playerObj.HasMember("dir"))
+		{
+			const rapidjson::Value& dir = playerObj["dir"];
+			player.dir.set(dir["x"].GetInt(), dir["y"].GetInt());
+		}
+		else
+		{
+			player.dir.set(Position::UNKNOWN_POS, Position::UNKNOWN_POS);
+		}
+	}
+	players.endUpdate();
+}
+
+void GameStateParser::readBoard(const rapidjson::Value& rows, PartialBoard& board)
+{
+	// The board state is an array (rows) of arrays (columns) of pairs (owner, trail IDs).
+	// Get the width and height of the partial board and allocate memory for the owner and trail IDs.
+	int index = 0;
+	int height = rows.Size();
+	board.resize(height > 0 ? rows.GetArray()[0].Size() : 0, height);
+
+	// Loop over each row.
+	for (const auto& rowObj : rows.GetArray())
+	{
+		// Loop over each column in the row.
+		for (const auto& colObj : rowObj.GetArray())
+		{
+			// Parse the data. It's in the format "<owner_id>,<trail_id>".
+			int owner = Player::NO_PLAYER;
+			int trail = Player::NO_PLAYER;
+			const char* col = colObj.GetString();
+
+			// Convert the owner ID to an int.
+			if (*col != ',')
+			{
+				for (owner = 0; *col != ','; col++)
+				{
+					owner = owner * 10 + *col - '0';
+				}
+			}
+
+			// Skip over the comma.
+			col++;
+
+			// Convert the trail ID to an int.
+			if (*col != 0)
+			{
+				for (trail = 0; *col != 0; col++)
+				{
+					trail = trail * 10 + *col - '0';
+				}
+			}
+
+			Cell& cell = board.cells[index++];
+			cell.owner = board.getSlot(owner);
+			cell.trail = board.getSlot(trail);
+		}
+	}
+}
+
+void GameStateParser::saveTurn(const GameInfo& gameInfo)
+{
+	// Copying into the same vectors each turn reuses their memory.
+	m_lastBoard = gameInfo.partialBoard;
+	m_lastPlayers.clear();
+	for (const auto& entry : gameInfo.players)
+	{
+		const Player& player = *entry.second;
+		if (player.id != Player::NO_PLAYER)
+		{
+			m_lastPlayers.push_back(LastPlayer{ player.id, player.score, player.pos.isValid() });
+		}
+	}
+	std::sort(m_lastPlayers.begin(), m_lastPlayers.end());
+}
+
+void GameStateParser::findChanges(GameInfo& gameInfo) const
+{
+	TurnChanges& changes = gameInfo.changes;
+	changes.clear();
+	changes.hasPrevious = hasView(m_lastBoard);
+	changes.previousOffset = m_lastBoard.boardOffset;
+	changes.previousWidth = m_lastBoard.width;
+	changes.previousHeight = m_lastBoard.height;
+	if (changes.hasPrevious && hasView(gameInfo.partialBoard))
+	{
+		findSpaceChanges(gameInfo.partialBoard, changes);
+	}
+
+	// The players in the game now, against the last turn's.
+	for (const auto& entry : gameInfo.players)
+	{
+		const Player& player = *entry.second;
+		if (player.id == Player::NO_PLAYER)
+		{
+			continue;
+		}
+
+		bool inView = player.pos.isValid();
+		LastPlayer key = { player.id, 0, false };
+		auto last = std::lower_bound(m_lastPlayers.begin(), m_lastPlayers.end(), key);
+		if (last == m_lastPlayers.end() || last->id != player.id)
+		{
+			changes.joined.push_back(player.id);
+			if (inView)
+			{
+				changes.enteredView.push_back(player.id);
+			}
+			continue;
+		}
+
+		if (last->score != player.score)
+		{
+			changes.scores.push_back(TurnChanges::ScoreChange{ player.id, last->score, player.score });
+		}
+		if (inView && !last->inView)
+		{
+			changes.enteredView.push_back(player.id);
+		}
+		else if (!inView && last->inView)
+		{
+			changes.leftView.push_back(player.id);
+		}
+	}
+
+	// And the ones that are gone.
+	for (const LastPlayer& last : m_lastPlayers)
+	{
+		if (!gameInfo.players.findPlayerById(last.id))
+		{
+			changes.left.push_back(last.id);
+			if (last.inView)
+			{
+				changes.leftView.push_back(last.id);
+			}
+		}
+	}
+}
+
+void GameStateParser::findSpaceChanges(const PartialBoard& board, TurnChanges& changes) const
+{
+	// Where the two views overlap, on the whole board.
+	const PartialBoard& last = m_lastBoard;
+	int left = std::max(last.boardOffset.x, board.boardOffset.x);
+	int top = std::max(last.boardOffset.y, board.boardOffset.y);
+	int right = std::min(last.boardOffset.x + last.width, board.boardOffset.x + board.width);
+	int bottom = std::min(last.boardOffset.y + last.height, board.boardOffset.y + board.height);
+	if (left >= right || top >= bottom)
+	{
+		return;
+	}
+
+	// The parser keeps the board's slots from turn to turn, so unless they were compacted, the last view's slots mean
+	// the same players in this one and Cells can be compared as they are.
+	bool sameSlots = last.getSlotCount() <= board.getSlotCount();
+	for (int slot = 0; sameSlots && slot < last.getSlotCount(); slot++)
+	{
+		sameSlots = last.getPlayerId(slot) == board.getPlayerId(slot);
+	}
+
+	int count = right - left;
+	for (int y = top; y < bottom; y++)
+	{
+		const Cell* from = last.getRow(y - last.boardOffset.y) + (left - last.boardOffset.x);
+		const Cell* to = board.getRow(y - board.boardOffset.y) + (left - board.boardOffset.x);
+
+		// Most rows don't change at all.
+		if (sameSlots && std::memcmp(from, to, count * sizeof(Cell)) == 0)
+		{
+			continue;
+		}
+
+		for (int x = 0; x < count; x++)
+		{
+			int oldOwnerId = last.getPlayerId(from[x].owner);
+			int oldTrailId = last.getPlayerId(from[x].trail);
+			int newOwnerId = board.getPlayerId(to[x].owner);
+			int newTrailId = board.getPlayerId(to[x].trail);
+			if (oldOwnerId != newOwnerId || oldTrailId != newTrailId)
+			{
+				changes.spaces.push_back(TurnChanges::SpaceChange{ Position(left + x, y), oldOwnerId, newOwnerId, oldTrailId, newTrailId });
+			}
+		}
+	}
+}
@@ -0,0 +1,155 @@
+#include "LatencyHistogram.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <ostream>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace
+{
+	// The number of bits needed to hold value, which isn't zero.
+	int getBitLength(uint64_t value)
+	{
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanReverse64(&index, value);
+		return (int)index + 1;
+#else
+		return 64 - __builtin_clzll(value);
+#endif
+	}
+
+	double toMilliseconds(std::chrono::nanoseconds time)
+	{
+		return time.count() / 1e6;
+	}
+
+	void printRow(std::ostream& out, const char* phase, const LatencyHistogram& histogram)
+	{
+		out << "  " << std::left << std::setw(18) << phase << std::right
+			<< std::setw(9) << histogram.getCount()
+			<< std::fixed << std::setprecision(3)
+			<< std::setw(10) << toMilliseconds(histogram.getPercentile(50))
+			<< std::setw(10) << toMilliseconds(histogram.getPercentile(99))
+			<< std::setw(10) << toMilliseconds(histogram.getMax())
+			<< std::endl;
+	}
+}
+
+void LatencyHistogram::reset()
+{
+	m_counts.fill(0);
+	m_count = 0;
+	m_total = 0;
+	m_max = 0;
+}
+
+void LatencyHistogram::record(std::chrono::nanoseconds time)
+{
+	uint64_t value = (uint64_t)std::max<std::chrono::nanoseconds::rep>(time.count(), 0);
+	m_counts[getBucket(value)]++;
+	m_count++;
+	m_total += value;
+	m_max = std::max(m_max, value);
+}
+
+void LatencyHistogram::add(const LatencyHistogram& other)
+{
+	for (int i = 0; i < BUCKETS; i++)
+	{
+		m_counts[i] += other.m_counts[i];
+	}
+	m_count += other.m_count;
+	m_total += other.m_total;
+	m_max = std::max(m_max, other.m_max);
+}
+
+std::chrono::nanoseconds LatencyHistogram::getMean() const
+{
+	return std::chrono::nanoseconds(m_count > 0 ? m_total / m_count : 0);
+}
+
+std::chrono::nanoseconds LatencyHistogram::getPercentile(double percent) const
+{
+	if (m_count == 0)
+	{
+		return std::chrono::nanoseconds::zero();
+	}
+
+	// Find the bucket holding the time with this rank, and report the top of it (but never more than the max).
+	uint64_t rank = std::max<uint64_t>((uint64_t)std::ceil(percent / 100 * m_count), 1);
+	uint64_t seen = 0;
+	for (int bucket = 0; bucket < BUCKETS; bucket++)
+	{
+		seen += m_counts[bucket];
+		if (seen >= rank)
+		{
+			return std::chrono::nanoseconds(std::min(getBucketEnd(bucket), m_max));
+		}
+	}
+	return getMax();
+}
+
+int LatencyHistogram::getBucket(uint64_t time)
+{
+	if (time < SUB_BUCKETS)
+	{
+		return (int)time;
+	}
+
+	// Keep the top SUB_BUCKET_BITS bits. The top one is always set, so each power of two has HALF_SUB_BUCKETS buckets.
+	int shift = getBitLength(time) - SUB_BUCKET_BITS;
+	if (shift > MAX_SHIFT)
+	{
+		return BUCKETS - 1;
+	}
+	int top = (int)(time >> shift);
+	return SUB_BUCKETS + (shift - 1) * HALF_SUB_BUCKETS + (top - HALF_SUB_BUCKETS);
+}
+
+uint64_t LatencyHistogram::getBucketEnd(int bucket)
+{
+	if (bucket < SUB_BUCKETS)
+	{
+		return bucket;
+	}
+
+	int shift = (bucket - SUB_BUCKETS) / HALF_SUB_BUCKETS + 1;
+	uint64_t top = (bucket - SUB_BUCKETS) % HALF_SUB_BUCKETS + HALF_SUB_BUCKETS;
+	return ((top + 1) << shift) - 1;
+}
+
+/**********************************************************************************************************************
+ *********************************************************************************************************************/
+void TurnLatency::reset()
+{
+	serialize.reset();
+	write.reset();
+	wait.reset();
+	parse.reset();
+	bot.reset();
+}
+
+void TurnLatency::add(const TurnLatency& other)
+{
+	serialize.add(other.serialize);
+	write.add(other.write);
+	wait.add(other.wait);
+	parse.add(other.parse);
+	bot.add(other.bot);
+}
+
+void TurnLatency::print(std::ostream& out, const std::string& title) const
+{
+	out << std::left << std::setw(20) << title << std::right << std::setw(9) << "count" << std::setw(10) << "p50 ms"
+		<< std::setw(10) << "p99 ms" << std::setw(10) << "max ms" << std::endl;
+	printRow(out, "serialize", serialize);
+	printRow(out, "write", write);
+	printRow(out, "wait for server", wait);
+	printRow(out, "parse", parse);
+	printRow(out, "bot", bot);
+}
@@ -0,0 +1,750 @@
+#include "LoopbackLobby.h"
+
+#include <boost/asio/ip/address.hpp>
+#include <boost/beast/core/flat_buffer.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/beast/version.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <set>
+
+#include "rapidjson/document.h"
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
+
+namespace http = boost::beast::http;
+using boost::asio::ip::tcp;
+
+namespace
+{
+	const std::chrono::seconds REJOIN_DELAY(5); // Killed persistent players wait this long to rejoin, like the server.
+	const char* const GAME_OVER = "{\"over\":true}";
+
+	// Undoes encodeUri() in GameClient.
+	std::string decodeUri(const std::string& value)
+	{
+		std::string decoded;
+		for (size_t i = 0; i < value.size(); i++)
+		{
+			unsigned code;
+			if (value[i] == '%' && i + 2 < value.size() && std::sscanf(value.c_str() + i + 1, "%2x", &code) == 1)
+			{
+				decoded += (char)code;
+				i += 2;
+			}
+			else
+			{
+				decoded += value[i];
+			}
+		}
+		return decoded;
+	}
+
+	// isLegalDir() in lobby/src/games/paperio.ts.
+	bool isLegalDir(const rapidjson::Value& dir)
+	{
+		if (!dir.IsObject() || !dir.HasMember("x") || !dir.HasMember("y") || !dir["x"].IsInt() || !dir["y"].IsInt())
+		{
+			return false;
+		}
+		int x = dir["x"].GetInt();
+		int y = dir["y"].GetInt();
+		return (x == 0 && (y == -1 || y == 1)) || (y == 0 && (x == -1 || x == 1));
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// One connection. Clients send one request at a time and wait for the answer, which may come much later (when the game
+// starts, or when the batch of moves runs), so a session reads a request, hands it to the lobby, and reads the next one
+// once the lobby has responded.
+//---------------------------------------------------------------------------------------------------------------------
+class LoopbackLobby::Session : public std::enable_shared_from_this<LoopbackLobby::Session>
+{
+public:
+	Session(tcp::socket socket, LoopbackLobby& lobby) :
+		m_socket(std::move(socket)),
+		m_lobby(lobby)
+	{
+	}
+
+	void read()
+	{
+		m_request = http::request<http::string_body>();
+		auto self = shared_from_this();
+		http::async_read(m_socket, m_buffer, m_request, [self](const boost::system::error_code& ec, std::size_t)
+		{
+			if (!ec)
+			{
+				self->m_lobby.handleRequest(self);
+			}
+		});
+	}
+
+	void respond(http::status status, const std::string& body)
+	{
+		m_response.result(status);
+		m_response.version(m_request.version());
+		m_response.keep_alive(m_request.keep_alive());
+		m_response.set(http::field::server, BOOST_BEAST_VERSION_STRING);
+		m_response.set(http::field::content_type, "application/json; charset=utf-8");
+		m_response.body() = body;
+		m_response.prepare_payload();
+
+		auto self = shared_from_this();
+		http::async_write(m_socket, m_response, [self](const boost::system::error_code& ec, std::size_t)
+		{
+			if (ec || !self->m_response.keep_alive())
+			{
+				boost::system::error_code ignored;
+				self->m_socket.shutdown(tcp::socket::shutdown_send, ignored);
+				return;
+			}
+			self->read();
+		});
+	}
+
+	const http::request<http::string_body>& getRequest() const { return m_request; }
+
+private:
+	tcp::socket m_socket;
+	LoopbackLobby& m_lobby;
+	boost::beast::flat_buffer m_buffer;
+	http::request<http::string_body> m_request;
+	http::response<http::string_body> m_response;
+};
+
+LoopbackLobby::Game::Game(boost::asio::io_context& ioc, const std::string& _name, bool _persistent, const Options& options) :
+	name(_name),
+	persistent(_persistent),
+	started(false),
+	over(false),
+	firstTurn(true),
+	batch(0),
+	minTimeElapsed(false),
+	inputArrived(false),
+	created(Clock::now()),
+	sim(options.width, options.height, _persistent, options.seed),
+	startTimer(ioc),
+	minTimer(ioc),
+	maxTimer(ioc)
+{
+	sim.setViewRadius(options.viewRadius);
+}
+
+/**********************************************************************************************************************
+ *********************************************************************************************************************/
+LoopbackLobby::LoopbackLobby(boost::asio::io_context& ioc, const Options& options) :
+	m_ioc(ioc),
+	m_acceptor(ioc),
+	m_options(options),
+	m_nextGame(1),
+	m_random(options.seed),
+	m_nextCanned(0)
+{
+}
+
+LoopbackLobby::~LoopbackLobby()
+{
+	stop();
+}
+
+void LoopbackLobby::start()
+{
+	tcp::endpoint endpoint(boost::asio::ip::make_address("127.0.0.1"), m_options.port);
+	m_acceptor.open(endpoint.protocol());
+	m_acceptor.set_option(tcp::acceptor::reuse_address(true));
+	m_acceptor.bind(endpoint);
+	m_acceptor.listen();
+	accept();
+
+	if (!m_options.quiet)
+	{
+		std::cout << "Listening on port " << getPort() << std::endl;
+	}
+}
+
+void LoopbackLobby::stop()
+{
+	boost::system::error_code ignored;
+	m_acceptor.close(ignored);
+	for (const GamePtr& game : m_games)
+	{
+		game->startTimer.cancel();
+		game->minTimer.cancel();
+		game->maxTimer.cancel();
+	}
+}
+
+unsigned short LoopbackLobby::getPort() const
+{
+	boost::system::error_code ec;
+	return m_acceptor.local_endpoint(ec).port();
+}
+
+void LoopbackLobby::accept()
+{
+	m_acceptor.async_accept([this](const boost::system::error_code& ec, tcp::socket socket)
+	{
+		if (ec)
+		{
+			if (ec != boost::asio::error::operation_aborted)
+			{
+				std::cout << "Accept failed: " << ec.message() << std::endl;
+			}
+			return;
+		}
+
+		// Game states are small and latency is what's being measured, so don't let Nagle hold them back.
+		socket.set_option(tcp::no_delay(true));
+		std::make_shared<Session>(std::move(socket), *this)->read();
+		accept();
+	});
+}
+
+/**********************************************************************************************************************
+ * Routes
+ *********************************************************************************************************************/
+void LoopbackLobby::handleRequest(const SessionPtr& session)
+{
+	const auto& req = session->getRequest();
+	std::string target = req.target().to_string();
+
+	if (target == "/players" && req.method() == http::verb::post)
+	{
+		registerPlayer(session);
+		return;
+	}
+	if (target == "/players" && req.method() == http::verb::get)
+	{
+		listPlayers(session);
+		return;
+	}
+
+	const std::string gamePrefix = "/games/";
+	if (target != "/games" && target.compare(0, gamePrefix.size(), gamePrefix) != 0)
+	{
+		session->respond(http::status::not_found, "Not Found");
+		return;
+	}
+
+	Client* client = authenticate(session);
+	if (client == nullptr)
+	{
+		session->respond(http::status::unauthorized, "Unauthorized");
+		return;
+	}
+
+	if (target == "/games" && req.method() == http::verb::get)
+	{
+		listGames(session, *client);
+	}
+	else if (target != "/games" && req.method() == http::verb::post)
+	{
+		processMove(session, *client, decodeUri(target.substr(gamePrefix.size())));
+	}
+	else
+	{
+		session->respond(http::status::not_found, "Not Found");
+	}
+}
+
+void LoopbackLobby::registerPlayer(const SessionPtr& session)
+{
+	rapidjson::Document doc;
+	doc.Parse(session->getRequest().body().c_str());
+	if (doc.HasParseError() || !doc.IsObject() || !doc.HasMember("name") || !doc["name"].IsString() ||
+		doc["name"].GetStringLength() == 0)
+	{
+		session->respond(http::status::bad_request, "Error");
+		return;
+	}
+
+	// Pick a name no one else has, the way Client in lobby/src/client.ts does.
+	std::set<std::string> usedNames;
+	for (auto& entry : m_clients)
+	{
+		usedNames.insert(entry.second->name);
+	}
+	const std::string requested = doc["name"].GetString();
+	std::string name = requested;
+	for (int num = 2; usedNames.count(name) > 0; num++)
+	{
+		name = requested + " (" + std::to_string(num) + ")";
+	}
+
+	std::string token;
+	do
+	{
+		char buffer[20];
+		std::snprintf(buffer, sizeof(buffer), "%016llx", (unsigned long long)m_random());
+		token = buffer;
+	} while (m_clients.count(token) > 0);
+
+	std::unique_ptr<Client> client(new Client());
+	client->name = name;
+	client->persistent = doc.HasMember("persistent") && doc["persistent"].IsBool() && doc["persistent"].GetBool();
+	client->game = nullptr;
+
+	rapidjson::StringBuffer s;
+	rapidjson::Writer<rapidjson::StringBuffer> writer(s);
+	writer.StartObject();
+	writer.Key("name");
+	writer.String(client->name.c_str());
+	if (client->persistent)
+	{
+		writer.Key("persistent");
+		writer.Bool(true);
+	}
+	writer.Key("token");
+	writer.String(token.c_str());
+	writer.EndObject();
+
+	if (!m_options.quiet)
+	{
+		std::cout << "Player " << name << " registered" << std::endl;
+	}
+	m_clients[token] = std::move(client);
+	session->respond(http::status::created, s.GetString());
+}
+
+void LoopbackLobby::listPlayers(const SessionPtr& session)
+{
+	rapidjson::StringBuffer s;
+	rapidjson::Writer<rapidjson::StringBuffer> writer(s);
+	writer.StartArray();
+	for (auto& entry : m_clients)
+	{
+		const Client& client = *entry.second;
+		writer.StartObject();
+		writer.Key("name");
+		writer.String(client.name.c_str());
+		if (client.persistent)
+		{
+			writer.Key("persistent");
+			writer.Bool(true);
+		}
+		if (client.game)
+		{
+			writer.Key("game");
+			writer.String(client.game->name.c_str());
+		}
+		writer.EndObject();
+	}
+	writer.EndArray();
+	session->respond(http::status::ok, s.GetString());
+}
+
+void LoopbackLobby::listGames(const SessionPtr& session, Client& client)
+{
+	removeOverGames();
+
+	// There's no admin to set up games, so there is always one for the player to join.
+	bool found = false;
+	for (const GamePtr& game : m_games)
+	{
+		found = found || (!game->over && game->persistent == client.persistent && (client.persistent || !game->started));
+	}
+	if (!found)
+	{
+		createGame(client.persistent);
+	}
+
+	rapidjson::StringBuffer s;
+	rapidjson::Writer<rapidjson::StringBuffer> writer(s);
+	writer.StartArray();
+	for (const GamePtr& game : m_games)
+	{
+		if (isEligible(*game, client))
+		{
+			writer.StartObject();
+			writer.Key("name");
+			writer.String(game->name.c_str());
+			if (game->persistent)
+			{
+				writer.Key("persistent");
+				writer.Bool(true);
+			}
+			writer.EndObject();
+		}
+	}
+	writer.EndArray();
+	session->respond(http::status::ok, s.GetString());
+}
+
+void LoopbackLobby::processMove(const SessionPtr& session, Client& client, const std::string& gameName)
+{
+	GamePtr game = findGame(gameName);
+	if (!game)
+	{
+		session->respond(http::status::not_found, "Not Found");
+		return;
+	}
+
+	auto player = std::find_if(game->players.begin(), game->players.end(),
+		[&client](const GamePlayer& p) { return p.client == &client; });
+	bool inGame = player != game->players.end();
+
+	if (!inGame && !game->over && isEligible(*game, client))
+	{
+		// Join the game. The response waits for the game to start, unless it already has.
+		GamePlayer joined = GamePlayer();
+		joined.client = &client;
+		joined.sentMoves = true; // Don't count moves missed before joining.
+		client.game = game.get();
+		if (!m_options.quiet)
+		{
+			std::cout << "Player " << client.name << " joined game " << game->name << std::endl;
+		}
+
+		if (game->started)
+		{
+			// Only persistent games can be joined after they start.
+			try
+			{
+				joined.id = game->sim.addPlayer(client.name);
+			}
+			catch (std::exception& e)
+			{
+				client.game = nullptr;
+				std::cout << "Unable to add " << client.name << " to game " << game->name << ": " << e.what() << std::endl;
+				session->respond(http::status::ok, GAME_OVER);
+				return;
+			}
+			game->players.push_back(joined);
+			sendGameState(*game, game->players.back());
+			session->respond(http::status::ok, m_state);
+			return;
+		}
+
+		joined.waiting = session;
+		game->players.push_back(joined);
+		if ((int)game->players.size() >= m_options.playersPerGame)
+		{
+			startGame(game);
+		}
+		return;
+	}
+
+	if (!inGame && !game->started)
+	{
+		session->respond(http::status::forbidden, "Forbidden");
+	}
+	else if (!inGame || game->over)
+	{
+		session->respond(http::status::ok, GAME_OVER);
+	}
+	else if (!game->started)
+	{
+		// Already waiting for the game to start. Answer the old request; this one waits instead.
+		if (player->waiting)
+		{
+			player->waiting->respond(http::status::ok, GAME_OVER);
+		}
+		player->waiting = session;
+	}
+	else
+	{
+		player->waiting = session;
+		queueMoves(game, *player, session->getRequest().body());
+	}
+}
+
+LoopbackLobby::Client* LoopbackLobby::authenticate(const SessionPtr& session)
+{
+	const auto& req = session->getRequest();
+	auto authorization = req.find(http::field::authorization);
+	if (authorization == req.end())
+	{
+		return nullptr;
+	}
+
+	const std::string bearer = "Bearer ";
+	std::string value = authorization->value().to_string();
+	if (value.compare(0, bearer.size(), bearer) != 0)
+	{
+		return nullptr;
+	}
+
+	auto client = m_clients.find(value.substr(bearer.size()));
+	return client == m_clients.end() ? nullptr : client->second.get();
+}
+
+/**********************************************************************************************************************
+ * Games
+ *********************************************************************************************************************/
+LoopbackLobby::GamePtr LoopbackLobby::createGame(bool persistent)
+{
+	std::string name = (persistent ? "persistent " : "game ") + std::to_string(m_nextGame++);
+	GamePtr game = std::make_shared<Game>(m_ioc, name, persistent, m_options);
+	m_games.push_back(game);
+
+	if (persistent)
+	{
+		startGame(game);
+	}
+	else
+	{
+		waitToStart(game);
+	}
+	return game;
+}
+
+LoopbackLobby::GamePtr LoopbackLobby::findGame(const std::string& name)
+{
+	for (const GamePtr& game : m_games)
+	{
+		if (game->name == name)
+		{
+			return game;
+		}
+	}
+	return GamePtr();
+}
+
+bool LoopbackLobby::isEligible(const Game& game, const Client& client) const
+{
+	// eligibleToJoin() in lobby/src/game.ts.
+	if (game.over)
+	{
+		return false;
+	}
+	if (game.persistent)
+	{
+		return client.persistent && Clock::now() - client.lastKilled > REJOIN_DELAY;
+	}
+	return !client.persistent && !game.started;
+}
+
+void LoopbackLobby::removeOverGames()
+{
+	m_games.erase(std::remove_if(m_games.begin(), m_games.end(), [](const GamePtr& game) { return game->over; }),
+		m_games.end());
+}
+
+void LoopbackLobby::waitToStart(const GamePtr& game)
+{
+	game->startTimer.expires_after(m_options.startWait);
+	game->startTimer.async_wait([this, game](const boost::system::error_code& ec)
+	{
+		if (ec || game->started)
+		{
+			return;
+		}
+
+		if (game->players.size() >= 2)
+		{
+			startGame(game);
+		}
+		else
+		{
+			waitToStart(game);
+		}
+	});
+}
+
+void LoopbackLobby::startGame(const GamePtr& game)
+{
+	if (!m_options.quiet)
+	{
+		std::cout << "Starting game " << game->name << " with " << game->players.size() << " players" << std::endl;
+	}
+
+	std::vector<std::string> names;
+	for (const GamePlayer& player : game->players)
+	{
+		names.push_back(player.client->name);
+	}
+	game->sim.addStartingPlayers(names);
+	const std::vector<int>& ids = game->sim.getPlayerIds();
+	for (size_t i = 0; i < game->players.size(); i++)
+	{
+		game->players[i].id = ids[i];
+	}
+
+	game->started = true;
+	game->deadline = Clock::now() + m_options.gameLength;
+	game->startTimer.cancel();
+	waitForInput(game);
+
+	// The players waiting to start are answered with the first batch, as if they had sent moves.
+	if (!game->players.empty())
+	{
+		for (GamePlayer& player : game->players)
+		{
+			player.sentMoves = true;
+		}
+		allInputArrived(game);
+	}
+}
+
+void LoopbackLobby::queueMoves(const GamePtr& game, GamePlayer& player, const std::string& body)
+{
+	// processInput() in lobby/src/games/paperio.ts. Anything that isn't an array leaves the queue alone.
+	rapidjson::Document doc;
+	doc.Parse(body.c_str());
+	if (!doc.HasParseError() && doc.IsArray())
+	{
+		player.moves.clear();
+		for (const rapidjson::Value& dir : doc.GetArray())
+		{
+			if (isLegalDir(dir) && player.moves.size() < Moves::MOVES_PER_TURN)
+			{
+				player.moves.push_back(Direction(dir["x"].GetInt(), dir["y"].GetInt()));
+			}
+		}
+	}
+	player.sentMoves = true;
+
+	bool allWaiting = std::all_of(game->players.begin(), game->players.end(),
+		[](const GamePlayer& p) { return p.waiting != nullptr; });
+	if (allWaiting)
+	{
+		allInputArrived(game);
+	}
+}
+
+void LoopbackLobby::waitForInput(const GamePtr& game)
+{
+	for (GamePlayer& player : game->players)
+	{
+		player.movesMissed = player.sentMoves ? 0 : player.movesMissed + 1;
+		player.sentMoves = false;
+		game->sim.setMovesMissed(player.id, player.movesMissed);
+	}
+
+	// The InputWaiter in lobby/src/lib/inputwaiter.ts: wait at least the min time, and at most the max time.
+	unsigned batch = ++game->batch;
+	game->minTimeElapsed = false;
+	game->inputArrived = false;
+
+	game->minTimer.expires_after(m_options.minTurnWait);
+	game->minTimer.async_wait([this, game, batch](const boost::system::error_code& ec)
+	{
+		if (!ec && batch == game->batch)
+		{
+			game->minTimeElapsed = true;
+			if (game->inputArrived)
+			{
+				runQueuedMoves(game);
+			}
+		}
+	});
+
+	game->maxTimer.expires_after(m_options.maxTurnWait);
+	game->maxTimer.async_wait([this, game, batch](const boost::system::error_code& ec)
+	{
+		if (!ec && batch == game->batch)
+		{
+			runQueuedMoves(game);
+		}
+	});
+}
+
+void LoopbackLobby::allInputArrived(const GamePtr& game)
+{
+	game->inputArrived = true;
+	if (game->minTimeElapsed)
+	{
+		runQueuedMoves(game);
+	}
+}
+
+void LoopbackLobby::runQueuedMoves(const GamePtr& game)
+{
+	// Make sure the timers for this batch don't fire again.
+	game->batch++;
+	game->minTimer.cancel();
+	game->maxTimer.cancel();
+
+	Simulator& sim = game->sim;
+	if (!game->firstTurn && !game->players.empty())
+	{
+		for (int turn = 0; turn < Moves::MOVES_PER_TURN && !sim.isOver(); turn++)
+		{
+			for (GamePlayer& player : game->players)
+			{
+				if (!player.moves.empty())
+				{
+					sim.setDirection(player.id, player.moves.front());
+					player.moves.erase(player.moves.begin());
+				}
+			}
+
+			if (Clock::now() >= game->deadline)
+			{
+				sim.shutdown();
+			}
+			sim.turn();
+		}
+	}
+	game->firstTurn = false;
+
+	if (sim.isOver())
+	{
+		// Everyone gets the final state, and leaves the game.
+		if (!m_options.quiet)
+		{
+			std::cout << "Game " << game->name << " over after " << sim.getTurn() << " turns" << std::endl;
+		}
+		game->over = true;
+		for (GamePlayer& player : game->players)
+		{
+			sendGameState(*game, player);
+		}
+		while (!game->players.empty())
+		{
+			removePlayer(*game, game->players.size() - 1);
+		}
+		return;
+	}
+
+	// Send everyone their view. Dead players get a game over status and are removed.
+	for (size_t i = 0; i < game->players.size(); )
+	{
+		sendGameState(*game, game->players[i]);
+		if (!sim.isAlive(game->players[i].id))
+		{
+			removePlayer(*game, i);
+		}
+		else
+		{
+			i++;
+		}
+	}
+
+	waitForInput(game);
+}
+
+void LoopbackLobby::removePlayer(Game& game, size_t index)
+{
+	GamePlayer& player = game.players[index];
+	game.sim.kill(player.id);
+	player.client->game = nullptr;
+	player.client->lastKilled = Clock::now();
+	if (!m_options.quiet)
+	{
+		std::cout << "Player " << player.client->name << " removed from game " << game.name << std::endl;
+	}
+	game.players.erase(game.players.begin() + index);
+}
+
+void LoopbackLobby::sendGameState(Game& game, GamePlayer& player)
+{
+	if (!m_options.cannedStates.empty() && game.sim.isAlive(player.id) && !game.sim.isOver())
+	{
+		m_state = m_options.cannedStates[m_nextCanned++ % m_options.cannedStates.size()];
+	}
+	else
+	{
+		game.sim.getGameState(player.id, m_state);
+	}
+
+	if (player.waiting)
+	{
+		SessionPtr session;
+		session.swap(player.waiting);
+		session->respond(http::status::ok, m_state);
+	}
+}
@@ -0,0 +1,94 @@
+#include "MoveRequests.h"
+
+#include <algorithm>
+
+#include <boost/beast/version.hpp>
+
+namespace
+{
+	const int DIRECTIONS = 4;
+
+	// The first index of the move lists with the given number of moves: 4^0 + 4^1 + ... + 4^(count - 1).
+	int getFirstIndex(int count)
+	{
+		int first = 0;
+		for (int i = 0, size = 1; i < count; i++, size *= DIRECTIONS)
+		{
+			first += size;
+		}
+		return first;
+	}
+}
+
+void MoveRequests::prepare(const std::string& host, const std::string& target, const std::string& token)
+{
+	// These are the headers prepareRequest() in GameClient sets, in the same order.
+	m_head = "POST " + target + " HTTP/1.1\r\n";
+	m_head += "Host: " + host + "\r\n";
+	m_head += "User-Agent: " BOOST_BEAST_VERSION_STRING "\r\n";
+	m_head += "Content-Type: application/json\r\n";
+	m_head += "Authorization: Bearer " + token + "\r\n";
+}
+
+bool MoveRequests::getRequest(const Moves& moves, Buffers& buffers) const
+{
+	if (m_head.empty())
+	{
+		return false;
+	}
+
+	const std::string& body = getBodies()[getIndex(moves)];
+	buffers[0] = boost::asio::buffer(m_head);
+	buffers[1] = boost::asio::buffer(body);
+	return true;
+}
+
+int MoveRequests::getIndex(const Moves& moves)
+{
+	// Lists are grouped by length. Within a group, the moves are the digits of a base 4 number, first move first. There
+	// are only bodies for up to MOVES_PER_TURN moves, so that's all that's sent.
+	int count = std::min<int>((int)moves.size(), Moves::MOVES_PER_TURN);
+	int offset = 0;
+	for (int i = 0; i < count; i++)
+	{
+		offset = offset * DIRECTIONS + moves.getCode(i);
+	}
+
+	return getFirstIndex(count) + offset;
+}
+
+const std::vector<std::string>& MoveRequests::getBodies()
+{
+	// Built on first use. Each is "Content-Length: <n>\r\n\r\n" followed by the JSON array of moves.
+	static const std::vector<std::string> bodies = []()
+	{
+		std::vector<std::string> table(getFirstIndex(Moves::MOVES_PER_TURN + 1));
+		for (int count = 0; count <= Moves::MOVES_PER_TURN; count++)
+		{
+			int first = getFirstIndex(count);
+			int lists = getFirstIndex(count + 1) - first;
+			for (int offset = 0; offset < lists; offset++)
+			{
+				// Pull the digits off the end, last move first.
+				std::vector<std::string> items(count);
+				for (int i = count - 1, rest = offset; i >= 0; i--, rest /= DIRECTIONS)
+				{
+					DirectionCode code = (DirectionCode)(rest % DIRECTIONS);
+					items[i] = "{\"x\":" + std::to_string(DIRECTION_X[code]) + ",\"y\":" + std::to_string(DIRECTION_Y[code]) + "}";
+				}
+
+				std::string json = "[";
+				for (int i = 0; i < count; i++)
+				{
+					json += (i > 0 ? "," : "") + items[i];
+				}
+				json += "]";
+
+				table[first + offset] = "Content-Length: " + std::to_string(json.size()) + "\r\n\r\n" + json;
+			}
+		}
+		return table;
+	}();
+
+	return bodies;
+}
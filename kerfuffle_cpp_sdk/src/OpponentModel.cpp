@@ -0,0 +1,178 @@
+#include "OpponentModel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace
+{
+	// The defaults, which are also where a profile's odds start from: mostly straight, and heading home likelier the
+	// longer they're out, up to five batches.
+	const float DEFAULT_STRAIGHT = 0.7f;
+	const int DEFAULT_TRIP_BATCHES = 5;
+
+	// How much the defaults count for, in batches and in trips, so a few observations don't swing the odds to certainty.
+	const float PRIOR_BATCHES = 4;
+	const float PRIOR_TRIPS = 2;
+
+	// The highest the odds of heading home in a batch go. Someone out longer than their trips usually last may be on one
+	// that never ends, running until they die, and treating them as certain to turn back is what gets us run into.
+	const float MAX_HOME = 0.5f;
+}
+
+/**********************************************************************************************************************
+ *********************************************************************************************************************/
+OpponentModel::Profile::Profile() :
+	batches(0),
+	straightBatches(0),
+	rightTurns(0),
+	leftTurns(0),
+	trips(0),
+	tripBatches(0),
+	tripEnds(),
+	lastSeen(-1),
+	dir(DIR_RIGHT),
+	trip(-1)
+{
+}
+
+/**********************************************************************************************************************
+ *********************************************************************************************************************/
+OpponentModel::OpponentModel() :
+	m_turn(0)
+{
+}
+
+void OpponentModel::clear()
+{
+	m_profiles.clear();
+	m_turn = 0;
+}
+
+void OpponentModel::update(const GameInfo& gameInfo, const WorldMap& world, int selfId)
+{
+	m_turn++;
+	for (const Players::Entry& entry : gameInfo.players)
+	{
+		const Player& player = *entry.second;
+		if (player.id == selfId || !player.pos.isValid() || !world.isOnBoard(player.pos) || !player.dir.isLegal())
+		{
+			continue;
+		}
+
+		Profile& profile = m_profiles[entry.first];
+		bool home = world.getOwnerId(player.pos) == player.id;
+		if (profile.lastSeen == m_turn - 1)
+		{
+			learnBatch(profile, player);
+
+			// A trip ends when they're back in their territory. It only counts if we saw it start.
+			if (home && profile.trip > 0)
+			{
+				profile.trips++;
+				profile.tripBatches += profile.trip;
+				profile.tripEnds[std::min<int>(profile.trip, MAX_TRIP_BATCHES)]++;
+			}
+			profile.trip = home ? 0 : profile.trip >= 0 ? profile.trip + 1 : -1;
+		}
+		else
+		{
+			profile.trip = home ? 0 : -1;
+		}
+
+		profile.lastSeen = m_turn;
+		profile.pos = player.pos;
+		profile.dir = player.dir.getCode();
+		updateOdds(profile);
+	}
+}
+
+void OpponentModel::updateOdds(Profile& profile) const
+{
+	// Going straight for a whole batch takes going straight every move.
+	float straightBatches = std::pow(DEFAULT_STRAIGHT, (float)Moves::MOVES_PER_TURN);
+	straightBatches = (profile.straightBatches + PRIOR_BATCHES * straightBatches) / (profile.batches + PRIOR_BATCHES);
+	float straight = std::pow(straightBatches, 1.0f / Moves::MOVES_PER_TURN);
+	float right = (profile.rightTurns + 1.0f) / (profile.rightTurns + profile.leftTurns + 2.0f);
+
+	// Heading home starts out as likely as in the defaults, but scaled to how long their trips last on average, which
+	// settles sooner than the count for any one length. The trip they're on counts for as long as it's lasted so far,
+	// since it will last at least that, so a player who never comes back isn't taken for one who's about to.
+	int out = std::max(profile.trip, 0);
+	float tripLength = (profile.tripBatches + out + PRIOR_TRIPS * DEFAULT_TRIP_BATCHES) /
+		(profile.trips + (out > 0 ? 1 : 0) + PRIOR_TRIPS);
+
+	// Then of the trips that lasted this long, how many ended in the next batch. Counting down keeps a running total,
+	// and the trip they're on has lasted every batch it's gone past without ending.
+	int lasted = 0;
+	for (int batch = MAX_TRIP_BATCHES; batch >= 0; batch--)
+	{
+		MoveOdds& odds = profile.odds[batch];
+		odds.straight = straight;
+		odds.right = (1 - straight) * right;
+		odds.left = (1 - straight) * (1 - right);
+		odds.home = MAX_HOME * std::min(1.0f, batch / tripLength);
+
+		lasted += profile.tripEnds[batch] + (out > batch ? 1 : 0);
+		if (batch > 0)
+		{
+			odds.home = (profile.tripEnds[batch] + PRIOR_TRIPS * odds.home) / (lasted + PRIOR_TRIPS);
+			odds.home = std::min(odds.home, MAX_HOME);
+		}
+	}
+}
+
+void OpponentModel::learnBatch(Profile& profile, const Player& player) const
+{
+	// Whether they went straight, or turned once and which way.
+	const int moves = Moves::MOVES_PER_TURN;
+	DirectionCode from = profile.dir;
+	DirectionCode to = player.dir.getCode();
+	int dx = player.pos.x - profile.pos.x;
+	int dy = player.pos.y - profile.pos.y;
+	if (std::abs(dx) + std::abs(dy) > moves)
+	{
+		return; // Not a batch: they died and came back, or moved without our seeing.
+	}
+
+	profile.batches++;
+	if (to == from && dx == DIRECTION_X[from] * moves && dy == DIRECTION_Y[from] * moves)
+	{
+		profile.straightBatches++;
+		return;
+	}
+
+	// One turn is some moves straight, then the rest the new way.
+	int along = dx * DIRECTION_X[from] + dy * DIRECTION_Y[from];
+	int across = dx * DIRECTION_X[to] + dy * DIRECTION_Y[to];
+	bool perpendicular = to == turnRight(from) || to == turnLeft(from);
+	if (perpendicular && along >= 0 && across >= 1 && along + across == moves)
+	{
+		(to == turnRight(from) ? profile.rightTurns : profile.leftTurns)++;
+	}
+}
+
+const OpponentModel::Profile* OpponentModel::find(const std::string& name) const
+{
+	auto found = m_profiles.find(name);
+	return found != m_profiles.end() ? &found->second : nullptr;
+}
+
+MoveOdds OpponentModel::getOdds(const Profile* profile, int tripBatches)
+{
+	if (!profile || profile->batches < MIN_BATCHES)
+	{
+		return getDefaultOdds(tripBatches);
+	}
+	return profile->odds[std::min<int>(tripBatches, MAX_TRIP_BATCHES)];
+}
+
+MoveOdds OpponentModel::getDefaultOdds(int tripBatches)
+{
+	MoveOdds odds;
+	odds.straight = DEFAULT_STRAIGHT;
+	odds.right = (1 - DEFAULT_STRAIGHT) / 2;
+	odds.left = (1 - DEFAULT_STRAIGHT) / 2;
+	odds.home = MAX_HOME * std::min(1.0f, (float)tripBatches / DEFAULT_TRIP_BATCHES);
+	return odds;
+}
@@ -0,0 +1,729 @@
+#include "SearchBot.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+namespace
+{
+	const double TRAIL_RISK = 0.5;      // What each space of trail left out at the end of a simulation costs, in spaces.
+	const double REWARD_SCALE = 20;     // The gain in spaces that scores about 0.73, out of 1.
+	const double WIDEN_BASE = 3;        // Children visible to a node, plus WIDEN_SCALE * sqrt(visits).
+	const double WIDEN_SCALE = 2;
+	const int TRUSTED_VISITS = 2;       // How many simulations a transposition needs before a new node takes its value.
+	const double MIN_AVERAGE = 1e-6;    // Averages are kept this far from 0 and 1 when rebasing, where the logit is infinite.
+
+	int getDistance(const Position& a, const Position& b)
+	{
+		return std::abs(a.x - b.x) + std::abs(a.y - b.y);
+	}
+
+	bool isOnBoard(const Simulator& sim, int x, int y)
+	{
+		return x >= 0 && y >= 0 && x < sim.getWidth() && y < sim.getHeight();
+	}
+
+	// The closest of the player's spaces next to their trail, and how far away it is, or -1 if there isn't one. The way
+	// back along the trail is always clear, so that's the way home; the trail's order doesn't matter.
+	int findNearestHome(const Simulator& sim, const SimPlayer& player, Position& target)
+	{
+		int best = -1;
+		for (int index : player.trail)
+		{
+			int x = index % sim.getWidth();
+			int y = index / sim.getWidth();
+			for (int code = 0; code < 4; code++)
+			{
+				Position next(x + DIRECTION_X[code], y + DIRECTION_Y[code]);
+				if (isOnBoard(sim, next.x, next.y) && sim.getCell(next.x, next.y).owner == player.id)
+				{
+					int distance = getDistance(next, player.pos);
+					if (best < 0 || distance < best)
+					{
+						best = distance;
+						target = next;
+					}
+				}
+			}
+		}
+		return best;
+	}
+
+	// The number of times a batch changes direction, counting from the direction before it.
+	int countTurns(Moves moves, DirectionCode dir)
+	{
+		int turns = 0;
+		for (size_t i = 0; i < moves.size(); i++)
+		{
+			turns += moves.getCode(i) != dir;
+			dir = moves.getCode(i);
+		}
+		return turns;
+	}
+
+	// Follows the batch from pos, returning false if it leaves the board or turns straight back.
+	bool followBatch(Moves moves, int width, int height, Position& pos, DirectionCode& dir)
+	{
+		for (size_t i = 0; i < moves.size(); i++)
+		{
+			DirectionCode code = moves.getCode(i);
+			pos.set(pos.x + DIRECTION_X[code], pos.y + DIRECTION_Y[code]);
+			if (code == getOpposite(dir) || pos.x < 0 || pos.y < 0 || pos.x >= width || pos.y >= height)
+			{
+				return false;
+			}
+			dir = code;
+		}
+		return true;
+	}
+}
+
+/**********************************************************************************************************************
+ *********************************************************************************************************************/
+void DefaultRollout::prepare(const Simulator& sim, int /*searcherId*/)
+{
+	m_profiles.assign(Simulator::MAX_PLAYERS + 1, nullptr);
+	for (int id : sim.getPlayerIds())
+	{
+		m_profiles[id] = m_model ? m_model->find(sim.getPlayer(id).name) : nullptr;
+	}
+}
+
+Moves DefaultRollout::getMoves(const Simulator& sim, int playerId, int searcherId, std::mt19937& random)
+{
+	const SimPlayer& player = sim.getPlayer(playerId);
+	int tripBatches = ((int)player.trail.size() + Moves::MOVES_PER_TURN - 1) / Moves::MOVES_PER_TURN;
+	const OpponentModel::Profile* profile = playerId < (int)m_profiles.size() ? m_profiles[playerId] : nullptr;
+	MoveOdds odds = OpponentModel::getOdds(profile, tripBatches);
+
+	std::uniform_real_distribution<float> chance(0, 1);
+	Position target;
+	bool hasTarget = findAttack(sim, player, searcherId, target);
+
+	// The odds leave room for opponents who never come back, but the searcher knows it will.
+	float home = playerId == searcherId ? std::min(1.0f, (float)tripBatches / SELF_TRIP_BATCHES) : odds.home;
+	if (!hasTarget && chance(random) < home)
+	{
+		hasTarget = findHome(sim, player, target);
+	}
+
+	Moves moves;
+	Position pos = player.pos;
+	DirectionCode dir = player.dir.isLegal() ? player.dir.getCode() : DIR_RIGHT;
+	for (int i = 0; i < Moves::MOVES_PER_TURN; i++)
+	{
+		// Straight, right, or left; never back, and never off the board if there's a choice.
+		DirectionCode options[3] = { dir, turnRight(dir), turnLeft(dir) };
+		if (hasTarget)
+		{
+			if (random() % 2)
+			{
+				std::swap(options[1], options[2]);
+			}
+			std::stable_sort(options, options + 3, [&](DirectionCode a, DirectionCode b)
+			{
+				Position nextA(pos.x + DIRECTION_X[a], pos.y + DIRECTION_Y[a]);
+				Position nextB(pos.x + DIRECTION_X[b], pos.y + DIRECTION_Y[b]);
+				return getDistance(nextA, target) < getDistance(nextB, target);
+			});
+		}
+		else
+		{
+			float roll = chance(random);
+			if (roll >= odds.straight + odds.right)
+			{
+				std::swap(options[0], options[2]);
+			}
+			else if (roll >= odds.straight)
+			{
+				std::swap(options[0], options[1]);
+			}
+		}
+
+		DirectionCode code = options[0];
+		for (DirectionCode option : options)
+		{
+			if (isOnBoard(sim, pos.x + DIRECTION_X[option], pos.y + DIRECTION_Y[option]))
+			{
+				code = option;
+				break;
+			}
+		}
+		moves.addMove(code);
+		pos.set(pos.x + DIRECTION_X[code], pos.y + DIRECTION_Y[code]);
+		dir = code;
+	}
+	return moves;
+}
+
+bool DefaultRollout::findAttack(const Simulator& sim, const SimPlayer& player, int searcherId, Position& target) const
+{
+	if (player.id == searcherId || !sim.isAlive(searcherId))
+	{
+		return false;
+	}
+
+	int best = ATTACK_RANGE + 1;
+	for (int index : sim.getPlayer(searcherId).trail)
+	{
+		Position pos(index % sim.getWidth(), index / sim.getWidth());
+		int distance = getDistance(pos, player.pos);
+		if (distance < best && sim.getCells()[index].trail == searcherId)
+		{
+			best = distance;
+			target = pos;
+		}
+	}
+	return best <= ATTACK_RANGE;
+}
+
+bool DefaultRollout::findHome(const Simulator& sim, const SimPlayer& player, Position& target) const
+{
+	return findNearestHome(sim, player, target) >= 0;
+}
+
+/**********************************************************************************************************************
+ *********************************************************************************************************************/
+SearchBot::Settings::Settings() :
+	thinkTime(0),
+	rolloutBatches(3),
+	exploration(0.7),
+	useTable(true),
+	seed(0)
+{
+}
+
+SearchBot::SearchBot() : SearchBot(Settings())
+{
+}
+
+SearchBot::SearchBot(const Settings& settings, std::shared_ptr<RolloutPolicy> rollout,
+	std::shared_ptr<TranspositionTable> table) :
+	m_settings(settings),
+	m_rollout(rollout ? rollout : std::make_shared<DefaultRollout>(&m_opponents)),
+	m_table(table || !settings.useTable ? table : std::make_shared<TranspositionTable>()),
+	m_random(settings.seed),
+	m_root(Simulator::DEFAULT_WIDTH, Simulator::DEFAULT_HEIGHT, true, settings.seed),
+	m_selfId(0),
+	m_startScore(0),
+	m_turn(0),
+	m_played(-1),
+	m_stats()
+{
+}
+
+void SearchBot::init(int boardWidth, int boardHeight)
+{
+	m_world.init(boardWidth, boardHeight);
+	m_opponents.clear();
+	m_trail.clear();
+	m_plannedPath.clear();
+	m_nodes.clear();
+	m_played = -1;
+	m_stats = Stats();
+	m_turn = 0;
+	if (m_table)
+	{
+		m_table->clear();
+	}
+}
+
+Moves SearchBot::getMoves(const GameInfo& gameInfo)
+{
+	Clock::time_point start = Clock::now();
+	m_world.update(gameInfo);
+	m_stats = Stats();
+	m_turn++;
+
+	Moves moves;
+	if (!self || !self->pos.isValid() || !m_world.isOnBoard(self->pos))
+	{
+		return moves;
+	}
+	m_opponents.update(gameInfo, m_world, self->id);
+
+	updateTrail(*self);
+	int lastStartScore = m_startScore;
+	loadState(gameInfo);
+	if (!m_root.isAlive(m_selfId))
+	{
+		moves.addMove(self->dir);
+		return moves;
+	}
+	m_stats.reused = reuseTree(*self);
+	m_played = -1;
+	if (!m_stats.reused)
+	{
+		m_nodes.clear();
+		DirectionCode dir = self->dir.isLegal() ? self->dir.getCode() : DIR_RIGHT;
+		addNode(Moves(), self->pos, dir);
+	}
+	if (m_startScore != lastStartScore)
+	{
+		rebaseRewards(m_startScore - lastStartScore);
+	}
+	if (m_nodes[0].firstChild < 0)
+	{
+		expand(0, true);
+	}
+	m_rollout->prepare(m_root, m_selfId);
+	if (m_table)
+	{
+		m_table->newSearch();
+	}
+
+	// Search until the deadline, or the think time if that's sooner.
+	Clock::time_point stop = gameInfo.deadline;
+	if (m_settings.thinkTime.count() > 0 && (stop == Clock::time_point() || start + m_settings.thinkTime < stop))
+	{
+		stop = start + m_settings.thinkTime;
+	}
+	while (Clock::now() < stop && m_nodes[0].childCount > 0)
+	{
+		// A reward from the table is already in it, so it only goes in the tree. Adding it again would count the same
+		// simulations twice, for the node that found it and each one above.
+		bool fromTable = false;
+		double reward = simulate(fromTable);
+		for (int index : m_path)
+		{
+			Node& node = m_nodes[index];
+			node.visits++;
+			node.total += (float)reward;
+			if (node.key != 0 && !fromTable)
+			{
+				node.pooled = m_table->add(node.key, (float)reward);
+			}
+		}
+		m_stats.simulations++;
+	}
+	m_stats.nodes = (int)m_nodes.size();
+
+	// Play the most visited batch. Before any simulations, that's the first, which the ordering liked best.
+	const Node& root = m_nodes[0];
+	int best = -1;
+	for (int i = 0; i < root.childCount; i++)
+	{
+		if (best < 0 || m_nodes[root.firstChild + i].visits > m_nodes[best].visits)
+		{
+			best = root.firstChild + i;
+		}
+	}
+	if (best < 0)
+	{
+		moves.addMove(self->dir);
+		return moves;
+	}
+
+	moves = Moves::fromPacked(m_nodes[best].moves);
+	m_plannedPath.clear();
+	Position pos = self->pos;
+	for (size_t i = 0; i < moves.size(); i++)
+	{
+		pos.set(pos.x + DIRECTION_X[moves.getCode(i)], pos.y + DIRECTION_Y[moves.getCode(i)]);
+		m_plannedPath.push_back(pos);
+	}
+	m_played = best;
+	return moves;
+}
+
+void SearchBot::updateTrail(const Player& player)
+{
+	// If last turn's batch went as planned, we know the way we came. Otherwise find it by following the trail back.
+	bool planned = !m_plannedPath.empty() && m_plannedPath.back() == player.pos && !m_trail.empty();
+	if (planned)
+	{
+		for (const Position& pos : m_plannedPath)
+		{
+			if (m_world.getOwnerId(pos) == player.id)
+			{
+				m_trail.assign(1, pos);
+			}
+			else
+			{
+				m_trail.push_back(pos);
+			}
+		}
+		return;
+	}
+
+	m_trail.assign(1, player.pos);
+	if (m_world.getOwnerId(player.pos) == player.id)
+	{
+		return;
+	}
+	for (size_t step = 0; step < (size_t)(m_world.getWidth() * m_world.getHeight()); step++)
+	{
+		const Position& pos = m_trail.back();
+		bool found = false;
+		for (int code = 0; code < 4 && !found; code++)
+		{
+			Position next(pos.x + DIRECTION_X[code], pos.y + DIRECTION_Y[code]);
+			if (!m_world.isOnBoard(next))
+			{
+				continue;
+			}
+			if (m_world.getOwnerId(next) == player.id)
+			{
+				m_trail.push_back(next);
+				std::reverse(m_trail.begin(), m_trail.end());
+				return;
+			}
+			found = m_world.getTrailId(next) == player.id && std::find(m_trail.begin(), m_trail.end(), next) == m_trail.end();
+			if (found)
+			{
+				m_trail.push_back(next);
+			}
+		}
+		if (!found)
+		{
+			break;
+		}
+	}
+	m_trail.clear(); // Lost track of it, so the estimates go without.
+}
+
+void SearchBot::loadState(const GameInfo& gameInfo)
+{
+	// Everyone whose position we know plays in the simulations. The spaces of those we can't see count as empty.
+	const Board& board = m_world.getBoard();
+	if (m_root.getWidth() != board.width || m_root.getHeight() != board.height)
+	{
+		m_root = Simulator(board.width, board.height, true, m_settings.seed);
+	}
+	m_root.reset();
+
+	int simIds[Board::MAX_SLOTS] = {};
+	m_selfId = 0;
+	for (const Players::Entry& entry : gameInfo.players)
+	{
+		const Player& player = *entry.second;
+		int slot = board.findSlot(player.id);
+		if (player.pos.isValid() && m_world.isOnBoard(player.pos) && slot != Board::NO_SLOT)
+		{
+			int simId = m_root.restorePlayer(player.name, player.pos, player.dir.isLegal() ? player.dir : Direction::Right);
+			simIds[slot] = simId;
+			if (player.id == self->id)
+			{
+				m_selfId = simId;
+			}
+		}
+	}
+
+	// Our trail goes in first, in order, so it reads from where we left home, as it would in a game.
+	for (size_t i = 1; i < m_trail.size() && m_selfId; i++)
+	{
+		m_root.setCell(m_trail[i].x, m_trail[i].y, simIds[board.cells[board.getIndex(m_trail[i])].owner], m_selfId);
+	}
+	for (int y = 0; y < board.height; y++)
+	{
+		const Cell* row = board.getRow(y);
+		for (int x = 0; x < board.width; x++)
+		{
+			if (simIds[row[x].owner] || simIds[row[x].trail])
+			{
+				m_root.setCell(x, y, simIds[row[x].owner], simIds[row[x].trail]);
+			}
+		}
+	}
+	m_root.recomputeScores();
+	m_startScore = m_root.isAlive(m_selfId) ? m_root.getPlayer(m_selfId).score : 0;
+
+	// The estimates for ordering the first batches.
+	m_bitBoards.update(board);
+	if (!m_trail.empty())
+	{
+		m_estimator.update(m_bitBoards.getTerritory(self->id), m_trail);
+	}
+}
+
+bool SearchBot::reuseTree(const Player& player)
+{
+	// If we're where the batch we played said we'd be, its subtree becomes the tree.
+	if (m_played < 0 || m_plannedPath.empty() || !(m_plannedPath.back() == player.pos))
+	{
+		return false;
+	}
+	if (!player.dir.isLegal() || m_nodes[m_played].dir != player.dir.getCode())
+	{
+		return false;
+	}
+
+	// The played node becomes the root. It was expanded with only the straightest batches, so it's expanded again with
+	// every batch in the root's order, and the children it had keep what they learned.
+	m_oldNodes.swap(m_nodes);
+	m_nodes.clear();
+	const Node& played = m_oldNodes[m_played];
+	m_nodes.push_back(played);
+	m_nodes[0].firstChild = -1;
+	m_nodes[0].childCount = 0;
+	expand(0, true);
+	const Node& root = m_nodes[0];
+	for (int i = root.firstChild; i >= 0 && i < root.firstChild + root.childCount; i++)
+	{
+		for (int old = played.firstChild; old >= 0 && old < played.firstChild + played.childCount; old++)
+		{
+			if (m_oldNodes[old].moves == m_nodes[i].moves)
+			{
+				m_nodes[i] = m_oldNodes[old];
+				break;
+			}
+		}
+	}
+
+	// Then copy the rest of the subtree to the front, a level at a time so children stay together.
+	for (size_t next = 1; next < m_nodes.size(); next++)
+	{
+		Node& node = m_nodes[next];
+		if (node.firstChild < 0)
+		{
+			continue;
+		}
+		if (m_nodes.size() + node.childCount > MAX_NODES)
+		{
+			node.firstChild = -1;
+			node.childCount = 0;
+			continue;
+		}
+		int oldFirst = node.firstChild;
+		node.firstChild = (int)m_nodes.size();
+		m_nodes.insert(m_nodes.end(), m_oldNodes.begin() + oldFirst, m_oldNodes.begin() + oldFirst + node.childCount);
+	}
+	return true;
+}
+
+void SearchBot::rebaseRewards(int scoreChange)
+{
+	// The same outcome is now worth scoreChange spaces less. Each node's average is shifted by that before squashing,
+	// which is only exact for a node whose simulations all scored the same, but keeps the order of siblings and is close
+	// for the rest. The table's entries can't be told apart by node, so they're dropped along with the nodes' copies.
+	for (Node& node : m_nodes)
+	{
+		if (node.visits > 0)
+		{
+			double average = std::min(std::max((double)node.total / node.visits, MIN_AVERAGE), 1 - MIN_AVERAGE);
+			double value = REWARD_SCALE * std::log(average / (1 - average)) - scoreChange;
+			node.total = (float)(node.visits / (1 + std::exp(-value / REWARD_SCALE)));
+		}
+		node.pooled.visits = 0;
+		node.pooled.total = 0;
+	}
+	if (m_table)
+	{
+		m_table->clear();
+	}
+}
+
+void SearchBot::expand(int nodeIndex, bool useEstimator)
+{
+	const Node node = m_nodes[nodeIndex];
+	int width = m_root.getWidth();
+	int height = m_root.getHeight();
+
+	// Every batch that stays on the board without turning back.
+	struct Candidate
+	{
+		Moves moves;
+		Position pos;
+		DirectionCode dir;
+		double score;
+	};
+	std::vector<Candidate> candidates;
+	const int count = 1 << (2 * Moves::MOVES_PER_TURN);
+	for (int packed = 0; packed < count; packed++)
+	{
+		Candidate candidate;
+		candidate.moves = Moves::fromPacked((uint16_t)(packed | Moves::MOVES_PER_TURN << Moves::COUNT_SHIFT));
+		candidate.pos.set(node.x, node.y);
+		candidate.dir = (DirectionCode)node.dir;
+		if (!followBatch(candidate.moves, width, height, candidate.pos, candidate.dir))
+		{
+			continue;
+		}
+
+		// Straighter is better, with ties broken at random. At the root, what the batch would capture comes first.
+		candidate.score = -countTurns(candidate.moves, (DirectionCode)node.dir) + std::uniform_real_distribution<double>(0, 0.5)(m_random);
+		if (useEstimator && !m_trail.empty())
+		{
+			CaptureGain gain = m_estimator.estimate(candidate.moves);
+			if (gain.moves > 0)
+			{
+				candidate.score += gain.allowed ? gain.captured : -gain.captured;
+			}
+		}
+		candidates.push_back(candidate);
+	}
+
+	std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) { return a.score > b.score; });
+	size_t limit = nodeIndex == 0 ? candidates.size() : std::min<size_t>(candidates.size(), MAX_CHILDREN);
+	if (m_nodes.size() + limit > MAX_NODES)
+	{
+		return;
+	}
+
+	int firstChild = (int)m_nodes.size();
+	for (size_t i = 0; i < limit; i++)
+	{
+		addNode(candidates[i].moves, candidates[i].pos, candidates[i].dir);
+	}
+	m_nodes[nodeIndex].firstChild = firstChild;
+	m_nodes[nodeIndex].childCount = (uint16_t)limit;
+}
+
+int SearchBot::select(const Node& node)
+{
+	// UCT over the children revealed so far. An unvisited one goes first.
+	int revealed = std::min<int>(node.childCount, (int)(WIDEN_BASE + WIDEN_SCALE * std::sqrt((double)node.visits)));
+	double logVisits = std::log((double)std::max(node.visits, 1));
+	int best = node.firstChild;
+	double bestValue = -std::numeric_limits<double>::infinity();
+	for (int i = node.firstChild; i < node.firstChild + revealed; i++)
+	{
+		const Node& child = m_nodes[i];
+		if (child.visits == 0)
+		{
+			return i;
+		}
+
+		// The average from the table if it's seen more, having come here other ways too. Exploring still goes by how
+		// often we've tried this batch from here. It's as of the child's last visit, which saves probing the table for
+		// every child every time.
+		double average = child.total / child.visits;
+		if (child.pooled.visits > child.visits)
+		{
+			average = child.pooled.total / child.pooled.visits;
+		}
+		double value = average + m_settings.exploration * std::sqrt(logVisits / child.visits);
+		if (value > bestValue)
+		{
+			bestValue = value;
+			best = i;
+		}
+	}
+	return best;
+}
+
+double SearchBot::simulate(bool& fromTable)
+{
+	m_sim = m_root;
+	m_path.assign(1, 0);
+
+	// Down the tree, expanding the first node we come back to.
+	int index = 0;
+	while (true)
+	{
+		if (m_nodes[index].firstChild < 0)
+		{
+			if (m_nodes[index].visits == 0)
+			{
+				break;
+			}
+			expand(index, false);
+			if (m_nodes[index].firstChild < 0)
+			{
+				break;
+			}
+		}
+
+		index = select(m_nodes[index]);
+		m_path.push_back(index);
+		if (!playBatch(Moves::fromPacked(m_nodes[index].moves)))
+		{
+			return 0;
+		}
+
+		// A new node at a state the table knows well takes its value from there.
+		if (!m_table)
+		{
+			continue;
+		}
+		Node& node = m_nodes[index];
+		node.key = getKey((int)m_path.size() - 1);
+		TranspositionTable::Entry entry;
+		if (node.visits == 0 && m_table->probe(node.key, entry) && entry.visits >= TRUSTED_VISITS)
+		{
+			m_stats.transpositions++;
+			fromTable = true;
+			return entry.total / entry.visits;
+		}
+	}
+
+	// Then play on by the rollout policy.
+	for (int batch = 0; batch < m_settings.rolloutBatches; batch++)
+	{
+		if (!playBatch(m_rollout->getMoves(m_sim, m_selfId, m_selfId, m_random)))
+		{
+			return 0;
+		}
+	}
+	return evaluate();
+}
+
+uint64_t SearchBot::getKey(int depth) const
+{
+	// Our part of the hash, and which batch of the game it's after. The multiplier spreads the batch over all the bits.
+	return m_sim.getPlayerHash(m_selfId) ^ (uint64_t)(m_turn + depth) * 0x9e3779b97f4a7c15ull;
+}
+
+bool SearchBot::playBatch(Moves moves)
+{
+	// Everyone else's moves for the batch, then the turns. Returns whether we're still alive.
+	Moves others[Simulator::MAX_PLAYERS + 1];
+	for (int id : m_sim.getPlayerIds())
+	{
+		if (id != m_selfId)
+		{
+			others[id] = m_rollout->getMoves(m_sim, id, m_selfId, m_random);
+		}
+	}
+
+	for (size_t turn = 0; turn < moves.size() && !m_sim.isOver(); turn++)
+	{
+		for (int id : m_sim.getPlayerIds())
+		{
+			if (id == m_selfId)
+			{
+				m_sim.setDirection(id, moves[turn]);
+			}
+			else if (turn < others[id].size())
+			{
+				m_sim.setDirection(id, others[id][turn]);
+			}
+		}
+		m_sim.turn();
+		if (!m_sim.isAlive(m_selfId))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+double SearchBot::evaluate() const
+{
+	// What we gained, less what we've left at risk (the trail, and the way home), squashed to between 0 and 1. Dying
+	// scores 0.
+	const SimPlayer& player = m_sim.getPlayer(m_selfId);
+	Position home;
+	int distance = player.trail.empty() ? 0 : std::max(findNearestHome(m_sim, player, home), 0);
+	double value = player.score - m_startScore - TRAIL_RISK * (player.trail.size() + distance);
+	return 1 / (1 + std::exp(-value / REWARD_SCALE));
+}
+
+int SearchBot::addNode(Moves moves, const Position& pos, DirectionCode dir)
+{
+	Node node;
+	node.moves = moves.getPacked();
+	node.dir = (uint8_t)dir;
+	node.x = (int16_t)pos.x;
+	node.y = (int16_t)pos.y;
+	node.childCount = 0;
+	node.firstChild = -1;
+	node.visits = 0;
+	node.total = 0;
+	node.key = 0;
+	node.pooled.visits = 0;
+	node.pooled.total = 0;
+	m_nodes.push_back(node);
+	return (int)m_nodes.size() - 1;
+}
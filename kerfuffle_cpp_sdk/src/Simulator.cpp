@@ -0,0 +1,944 @@
+#include "Simulator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
+
+namespace
+{
+	const double PI = 3.14159265358979323846;
+	const double MAX_PERCENT_CAPTURE = 0.2; // Captures larger than this fraction of the board fail.
+	const int START_AREA_RADIUS = 2;        // Players start with a 5x5 area.
+	const int SPAWN_PADDING = 30;           // Random spawns stay this far from the edges.
+	const int SPAWN_CLEARANCE = 5;          // Random spawns need an empty 11x11 area.
+
+	// What the Zobrist keys are for.
+	enum { KEY_OWNER, KEY_TRAIL, KEY_POSITION, KEY_DIRECTION };
+
+	// The Zobrist key for a feature of the game. Rather than a table of random numbers, which for every space and
+	// player would take tens of megabytes, each key is the feature run through splitmix64's mixer. That's a bijection,
+	// so different features never share a key, and its output is as good as random for hashing.
+	uint64_t getKey(int kind, int playerId, int a, int b)
+	{
+		uint64_t key = (uint64_t)kind | (uint64_t)(playerId & 0xff) << 4 | (uint64_t)(a & 0xffff) << 12
+			| (uint64_t)(b & 0xffff) << 28;
+		key += 0x9e3779b97f4a7c15ull;
+		key = (key ^ (key >> 30)) * 0xbf58476d1ce4e5b9ull;
+		key = (key ^ (key >> 27)) * 0x94d049bb133111ebull;
+		return key ^ (key >> 31);
+	}
+
+	uint64_t getSpaceKey(int kind, int playerId, int index)
+	{
+		return getKey(kind, playerId, index & 0xffff, index >> 16);
+	}
+
+	// Math.round() from JavaScript, which rounds halves up.
+	int jsRound(double value)
+	{
+		return (int)std::floor(value + 0.5);
+	}
+
+	// Port of binarySearch() in lobby/src/lib/array.ts. It is reproduced as-is, including reading past the end of the
+	// array (which compares false in JavaScript), so edges are inserted in exactly the same order as the server.
+	int binarySearch(const std::vector<int>& a, int item, int low, int high)
+	{
+		if (high <= low)
+		{
+			return (low < (int)a.size() && item > a[low]) ? (low + 1) : low;
+		}
+
+		int mid = (low + high) / 2;
+
+		if (item == a[mid])
+		{
+			return mid + 1;
+		}
+
+		if (item > a[mid])
+		{
+			return binarySearch(a, item, mid + 1, high);
+		}
+		return binarySearch(a, item, low, mid - 1);
+	}
+}
+
+/**********************************************************************************************************************
+ *********************************************************************************************************************/
+Simulator::Simulator(int width, int height, bool persistent, unsigned seed) :
+	m_width(width),
+	m_height(height),
+	m_persistent(persistent),
+	m_over(false),
+	m_turn(0),
+	m_turnLimit(0),
+	m_viewRadius(0),
+	m_nextId(1),
+	m_random(seed)
+{
+	reset();
+}
+
+void Simulator::reset()
+{
+	m_over = false;
+	m_turn = 0;
+	m_nextId = 1;
+
+	SimCell empty = { 0, 0 };
+	m_cells.assign(m_width * m_height, empty);
+	m_hash = 0;
+	m_playerHashes.assign(MAX_PLAYERS + 1, 0);
+
+	m_players.resize(MAX_PLAYERS + 1);
+	for (SimPlayer& player : m_players)
+	{
+		player.alive = false;
+		player.trail.clear();
+	}
+	m_order.clear();
+
+	m_toKill.assign(MAX_PLAYERS + 1, 0);
+	m_verticalEdges.resize(m_height);
+}
+
+int Simulator::allocatePlayer(const std::string& name)
+{
+	for (int attempt = 0; attempt < MAX_PLAYERS; attempt++)
+	{
+		int id = m_nextId;
+		m_nextId = m_nextId % MAX_PLAYERS + 1;
+
+		SimPlayer& player = m_players[id];
+		if (!player.alive)
+		{
+			player.id = id;
+			player.name = name;
+			player.score = 0;
+			player.pos.set(0, 0);
+			player.dir = Direction::Right;
+			player.movesMissed = 0;
+			player.alive = true;
+			player.trail.clear();
+			player.minX = m_width;
+			player.minY = m_height;
+			player.maxX = -1;
+			player.maxY = -1;
+			m_order.push_back(id);
+			toggleHead(player);
+			return id;
+		}
+	}
+
+	throw std::runtime_error("too-many-players");
+}
+
+void Simulator::claimStartingArea(const SimPlayer& player)
+{
+	for (int y = player.pos.y - START_AREA_RADIUS; y <= player.pos.y + START_AREA_RADIUS; y++)
+	{
+		for (int x = player.pos.x - START_AREA_RADIUS; x <= player.pos.x + START_AREA_RADIUS; x++)
+		{
+			if (x >= 0 && y >= 0 && x < m_width && y < m_height)
+			{
+				setOwner(getIndex(x, y), player.id);
+			}
+		}
+	}
+}
+
+void Simulator::addStartingPlayers(const std::vector<std::string>& names)
+{
+	for (size_t idx = 0; idx < names.size(); idx++)
+	{
+		const double theta = (double)idx / names.size() * PI * 2;
+		addPlayer(names[idx],
+			jsRound(m_width / 2.0 + m_width / 3.0 * std::cos(theta)),
+			jsRound(m_height / 2.0 + m_height / 3.0 * std::sin(theta)));
+	}
+}
+
+int Simulator::addPlayer(const std::string& name, int x, int y)
+{
+	int id = allocatePlayer(name);
+	SimPlayer& player = m_players[id];
+	toggleHead(player);
+	player.pos.set(x, y);
+	toggleHead(player);
+	claimStartingArea(player);
+	return id;
+}
+
+int Simulator::addPlayer(const std::string& name)
+{
+	auto isClear = [this](int x, int y) {
+		for (int i = 0; i <= SPAWN_CLEARANCE * 2; i++)
+		{
+			for (int j = 0; j <= SPAWN_CLEARANCE * 2; j++)
+			{
+				if (!isEmpty(x + i - SPAWN_CLEARANCE, y + j - SPAWN_CLEARANCE))
+				{
+					return false;
+				}
+			}
+		}
+		return true;
+	};
+
+	std::uniform_int_distribution<int> randomX(0, m_width - SPAWN_PADDING * 2 - 1);
+	std::uniform_int_distribution<int> randomY(0, m_height - SPAWN_PADDING * 2 - 1);
+
+	for (int attempt = 1; ; attempt++)
+	{
+		if (attempt == 300)
+		{
+			for (int y = SPAWN_PADDING; y < m_height - SPAWN_PADDING; y++)
+			{
+				for (int x = SPAWN_PADDING; x < m_width - SPAWN_PADDING; x++)
+				{
+					if (isClear(x, y))
+					{
+						return addPlayer(name, x, y);
+					}
+				}
+			}
+
+			// Make room for more players by shrinking everyone back to their starting area.
+			for (int index = 0; index < (int)m_cells.size(); index++)
+			{
+				setOwner(index, 0);
+				setTrail(index, 0);
+			}
+			for (int id : m_order)
+			{
+				claimStartingArea(m_players[id]);
+			}
+		}
+
+		if (attempt == 600)
+		{
+			// This probably won't happen, but just in case.
+			std::vector<int> ids = m_order;
+			for (int id : ids)
+			{
+				kill(id);
+			}
+		}
+
+		int x = randomX(m_random) + SPAWN_PADDING;
+		int y = randomY(m_random) + SPAWN_PADDING;
+		if (isClear(x, y))
+		{
+			return addPlayer(name, x, y);
+		}
+	}
+}
+
+int Simulator::restorePlayer(const std::string& name, const Position& pos, const Direction& dir)
+{
+	int id = allocatePlayer(name);
+	SimPlayer& player = m_players[id];
+	toggleHead(player);
+	player.pos = pos;
+	player.dir = dir;
+	toggleHead(player);
+	return id;
+}
+
+void Simulator::setDirection(int playerId, const Direction& dir)
+{
+	if (isAlive(playerId))
+	{
+		SimPlayer& player = m_players[playerId];
+		toggleHead(player);
+		player.dir = dir;
+		toggleHead(player);
+	}
+}
+
+void Simulator::setMovesMissed(int playerId, int movesMissed)
+{
+	if (isAlive(playerId))
+	{
+		m_players[playerId].movesMissed = movesMissed;
+	}
+}
+
+void Simulator::setCell(int x, int y, int ownerId, int trailId)
+{
+	int index = getIndex(x, y);
+	SimCell& cell = m_cells[index];
+	if (cell.owner != 0)
+	{
+		toggleHash(cell.owner, getSpaceKey(KEY_OWNER, cell.owner, index));
+	}
+	cell.owner = (uint8_t)ownerId;
+	if (ownerId != 0)
+	{
+		toggleHash(ownerId, getSpaceKey(KEY_OWNER, ownerId, index));
+		extendBounds(m_players[ownerId], index);
+	}
+	if (trailId != 0 && cell.trail != trailId)
+	{
+		m_players[trailId].trail.push_back(index);
+		extendBounds(m_players[trailId], index);
+	}
+	setTrail(index, trailId);
+}
+
+void Simulator::recomputeScores()
+{
+	for (int id : m_order)
+	{
+		m_players[id].score = 0;
+	}
+
+	for (const SimCell& cell : m_cells)
+	{
+		if (cell.owner != 0)
+		{
+			m_players[cell.owner].score++;
+		}
+	}
+}
+
+bool Simulator::isEmpty(int x, int y) const
+{
+	if (x < 0 || y < 0 || x >= m_width || y >= m_height)
+	{
+		return false;
+	}
+
+	const SimCell& cell = m_cells[getIndex(x, y)];
+	return cell.owner == 0 && cell.trail == 0;
+}
+
+void Simulator::setOwner(int index, int playerId)
+{
+	SimCell& cell = m_cells[index];
+	if (playerId != 0)
+	{
+		m_players[playerId].score++;
+		extendBounds(m_players[playerId], index);
+	}
+
+	if (cell.owner != 0)
+	{
+		m_players[cell.owner].score--;
+		toggleHash(cell.owner, getSpaceKey(KEY_OWNER, cell.owner, index));
+	}
+	if (playerId != 0)
+	{
+		toggleHash(playerId, getSpaceKey(KEY_OWNER, playerId, index));
+	}
+
+	cell.owner = (uint8_t)playerId;
+}
+
+void Simulator::setTrail(int index, int playerId)
+{
+	SimCell& cell = m_cells[index];
+	if (cell.trail == playerId)
+	{
+		return;
+	}
+	if (cell.trail != 0)
+	{
+		toggleHash(cell.trail, getSpaceKey(KEY_TRAIL, cell.trail, index));
+	}
+	if (playerId != 0)
+	{
+		toggleHash(playerId, getSpaceKey(KEY_TRAIL, playerId, index));
+	}
+	cell.trail = (uint8_t)playerId;
+}
+
+void Simulator::toggleHash(int playerId, uint64_t key)
+{
+	m_hash ^= key;
+	m_playerHashes[playerId] ^= key;
+}
+
+void Simulator::toggleHead(const SimPlayer& player)
+{
+	// Adds the player's position and direction to the hash, or takes them out again.
+	toggleHash(player.id, getKey(KEY_POSITION, player.id, player.pos.x, player.pos.y)
+		^ getKey(KEY_DIRECTION, player.id, player.dir.x, player.dir.y));
+}
+
+void Simulator::extendBounds(SimPlayer& player, int index)
+{
+	int x = index % m_width;
+	int y = index / m_width;
+	player.minX = std::min(player.minX, x);
+	player.minY = std::min(player.minY, y);
+	player.maxX = std::max(player.maxX, x);
+	player.maxY = std::max(player.maxY, y);
+}
+
+/**********************************************************************************************************************
+ *********************************************************************************************************************/
+void Simulator::turn()
+{
+	if (m_turnLimit > 0 && m_turn >= m_turnLimit)
+	{
+		shutdown();
+	}
+
+	if (m_order.empty() || m_over)
+	{
+		return;
+	}
+
+	m_turn++;
+
+	// Process players in order of their score. Highest scoring player goes first; ties keep the order they joined.
+	// This is an insertion sort: it's stable like Array.sort(), and unlike std::stable_sort() it doesn't allocate.
+	m_sorted = m_order;
+	for (size_t i = 1; i < m_sorted.size(); i++)
+	{
+		int id = m_sorted[i];
+		size_t j = i;
+		for (; j > 0 && m_players[m_sorted[j - 1]].score < m_players[id].score; j--)
+		{
+			m_sorted[j] = m_sorted[j - 1];
+		}
+		m_sorted[j] = id;
+	}
+
+	int killCount = 0;
+	auto addKill = [this, &killCount](int id) {
+		if (!m_toKill[id])
+		{
+			m_toKill[id] = 1;
+			killCount++;
+		}
+	};
+
+	// Move everyone. A player stepping off their trail into their own territory captures the area they enclosed.
+	m_targets.resize(m_sorted.size());
+	for (size_t i = 0; i < m_sorted.size(); i++)
+	{
+		SimPlayer& player = m_players[m_sorted[i]];
+		int nextX = player.pos.x + player.dir.x;
+		int nextY = player.pos.y + player.dir.y;
+
+		// If the space they're moving onto is off the board, kill them.
+		if (nextX < 0 || nextY < 0 || nextX >= m_width || nextY >= m_height)
+		{
+			m_targets[i] = -1;
+			addKill(player.id);
+			continue;
+		}
+
+		int to = getIndex(nextX, nextY);
+		m_targets[i] = to;
+
+		if (m_cells[to].owner == player.id && m_cells[getIndex(player.pos.x, player.pos.y)].trail == player.id)
+		{
+			claim(player, Position(nextX, nextY));
+		}
+
+		toggleHead(player);
+		player.pos.set(nextX, nextY);
+		toggleHead(player);
+	}
+
+	// Kill any players that collided with another player while not in their safe zone.
+	for (size_t i = 0; i < m_sorted.size(); i++)
+	{
+		if (m_targets[i] < 0)
+		{
+			continue;
+		}
+
+		bool collided = false;
+		for (size_t j = 0; j < m_sorted.size() && !collided; j++)
+		{
+			collided = j != i && m_targets[j] == m_targets[i];
+		}
+
+		if (collided && m_cells[m_targets[i]].owner != m_sorted[i])
+		{
+			addKill(m_sorted[i]);
+		}
+	}
+
+	// Landing on someone's trail kills them. Landing outside your own territory extends your trail.
+	for (int id : m_sorted)
+	{
+		SimPlayer& player = m_players[id];
+		int index = getIndex(player.pos.x, player.pos.y);
+		SimCell& cell = m_cells[index];
+		if (cell.trail != 0 && cell.trail != id)
+		{
+			addKill(cell.trail);
+		}
+		if (cell.owner != id)
+		{
+			if (cell.trail != id)
+			{
+				player.trail.push_back(index);
+				extendBounds(player, index);
+			}
+			setTrail(index, id);
+		}
+	}
+
+	// Check for players that had their entire area captured or stopped sending moves.
+	for (int id : m_sorted)
+	{
+		const SimPlayer& player = m_players[id];
+		if (player.score == 0 || player.movesMissed >= MAX_MOVES_MISSED)
+		{
+			addKill(id);
+		}
+	}
+
+	if (killCount == (int)m_order.size() && !m_persistent)
+	{
+		// Ended in a tie.
+		shutdown();
+	}
+	else
+	{
+		for (int id : m_sorted)
+		{
+			if (m_toKill[id])
+			{
+				kill(id);
+			}
+		}
+
+		if (m_order.size() < 2 && !m_persistent)
+		{
+			shutdown();
+		}
+	}
+
+	for (int id : m_sorted)
+	{
+		m_toKill[id] = 0;
+	}
+}
+
+void Simulator::kill(int playerId)
+{
+	if (!isAlive(playerId))
+	{
+		return;
+	}
+
+	SimPlayer& player = m_players[playerId];
+	for (int y = player.minY; y <= player.maxY; y++)
+	{
+		for (int index = getIndex(player.minX, y); index <= getIndex(player.maxX, y); index++)
+		{
+			SimCell& cell = m_cells[index];
+			if (cell.owner == playerId)
+			{
+				setOwner(index, 0);
+			}
+			if (cell.trail == playerId)
+			{
+				setTrail(index, 0);
+			}
+		}
+	}
+
+	toggleHead(player);
+	player.alive = false;
+	player.trail.clear();
+	m_order.erase(std::find(m_order.begin(), m_order.end(), playerId));
+}
+
+void Simulator::shutdown()
+{
+	for (int index = 0; index < (int)m_cells.size(); index++)
+	{
+		setTrail(index, 0);
+	}
+
+	for (int id : m_order)
+	{
+		m_players[id].trail.clear();
+	}
+
+	m_over = true;
+}
+
+/**********************************************************************************************************************
+ * Capturing territory. This follows claim() and fillEnclosedAreas() on the server step for step, including its quirks
+ * (regions found after the one containing the re-entry point are counted again toward the capture limit), so that
+ * captures succeed or fail exactly as they do on the server.
+ *********************************************************************************************************************/
+void Simulator::claim(SimPlayer& player, const Position& nextPos)
+{
+	// The player is about to re-enter their safe zone at nextPos.
+	bool doCapture = fillEnclosedAreas(player, nextPos);
+
+	for (int index : player.trail)
+	{
+		SimCell& cell = m_cells[index];
+		if (cell.trail == player.id)
+		{
+			setOwner(index, doCapture ? player.id : 0);
+			setTrail(index, 0);
+		}
+	}
+	player.trail.clear();
+}
+
+bool Simulator::fillEnclosedAreas(const SimPlayer& player, const Position& pos)
+{
+	const int id = player.id;
+	for (std::vector<int>& edges : m_verticalEdges)
+	{
+		edges.clear();
+	}
+	m_spacesToClaim.clear();
+
+	// Nothing outside the player's bounding box can be part of their polygons.
+	for (int y = player.minY; y <= player.maxY; y++)
+	{
+		for (int x = player.minX; x <= player.maxX; x++)
+		{
+			if (getFillSource(x, y, id) != id)
+			{
+				continue;
+			}
+
+			fillPoly(x, y, id);
+
+			if (getFillSource(pos.x, pos.y, id) == 0)
+			{
+				// We've now found the region that surrounds "pos". Fill based on the vertical edges.
+				for (int edgeY = player.minY; edgeY <= player.maxY; edgeY++)
+				{
+					const std::vector<int>& edges = m_verticalEdges[edgeY];
+					for (size_t i = 0; i + 1 < edges.size(); i += 2)
+					{
+						for (int edgeX = edges[i]; edgeX < edges[i + 1]; edgeX++)
+						{
+							int index = getIndex(edgeX, edgeY);
+							if (m_cells[index].owner != id)
+							{
+								m_spacesToClaim.push_back(index);
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+
+	if (m_spacesToClaim.size() <= m_width * m_height * MAX_PERCENT_CAPTURE)
+	{
+		for (int index : m_spacesToClaim)
+		{
+			setOwner(index, id);
+		}
+		return true;
+	}
+	return false;
+}
+
+int Simulator::getFillSource(int x, int y, int playerId) const
+{
+	if (x < 0 || y < 0 || x >= m_width || y >= m_height)
+	{
+		return 0;
+	}
+
+	const SimCell& cell = m_cells[getIndex(x, y)];
+	int source = cell.owner;
+	if (source != playerId && cell.trail == playerId)
+	{
+		source = playerId;
+	}
+	if (source == 0)
+	{
+		return 0;
+	}
+
+	const std::vector<int>& xs = m_verticalEdges[y];
+	for (size_t i = 0; i + 1 < xs.size(); i += 2)
+	{
+		if (x >= xs[i] && x < xs[i + 1])
+		{
+			// Inside a polygon we've already found.
+			return 0;
+		}
+		else if (x < xs[i + 1])
+		{
+			// Past our X; the edges are sorted.
+			break;
+		}
+	}
+	return source;
+}
+
+void Simulator::fillPoly(int startX, int startY, int playerId)
+{
+	// Walk the outline of the polygon clockwise (with y pointing down), starting from its top left corner. The value
+	// "inside" an edge is the space to the right of the direction of travel; "outside" is the space to the left.
+	int x = startX;
+	int y = startY;
+	int dx = 1;
+	int dy = 0;
+
+	auto getInside = [&]() {
+		if (dx == 1) return getFillSource(x, y, playerId);
+		if (dy == 1) return getFillSource(x - 1, y, playerId);
+		if (dx == -1) return getFillSource(x - 1, y - 1, playerId);
+		return getFillSource(x, y - 1, playerId);
+	};
+
+	auto getOutside = [&]() {
+		if (dx == 1) return getFillSource(x, y - 1, playerId);
+		if (dy == 1) return getFillSource(x, y, playerId);
+		if (dx == -1) return getFillSource(x - 1, y, playerId);
+		return getFillSource(x - 1, y - 1, playerId);
+	};
+
+	m_polyEdges.clear();
+	do
+	{
+		// Make sure we're pointed along the edge.
+		int rotations = 0;
+		while (getInside() != playerId || getOutside() == playerId)
+		{
+			int oldDx = dx;
+			dx = -dy;
+			dy = oldDx;
+
+			// The server would spin forever here. It can't happen with a well formed board, but don't hang if it does.
+			if (++rotations > 4)
+			{
+				return;
+			}
+		}
+
+		if (dy == 1)
+		{
+			m_polyEdges.push_back(std::make_pair(x, y));
+		}
+		else if (dy == -1)
+		{
+			m_polyEdges.push_back(std::make_pair(x, y - 1));
+		}
+
+		x += dx;
+		y += dy;
+	} while (x != startX || y != startY);
+
+	for (const auto& edge : m_polyEdges)
+	{
+		addVerticalEdge(edge.first, edge.second);
+	}
+}
+
+void Simulator::addVerticalEdge(int x, int y)
+{
+	std::vector<int>& edges = m_verticalEdges[y];
+	int index = binarySearch(edges, x, 0, (int)edges.size());
+	edges.insert(edges.begin() + index, x);
+}
+
+/**********************************************************************************************************************
+ * The view each player receives. This mirrors playerStatusString() on the server and the way GameClient stores it.
+ *********************************************************************************************************************/
+int Simulator::getViewRadius(int playerId) const
+{
+	if (m_viewRadius > 0)
+	{
+		return m_viewRadius;
+	}
+	return jsRound(12 + (double)m_players[playerId].score / (m_width * m_height) * 100);
+}
+
+void Simulator::getViewBounds(int playerId, int& left, int& top, int& right, int& bottom) const
+{
+	// Clip the square around the player to the board.
+	const SimPlayer& self = m_players[playerId];
+	const int radius = getViewRadius(playerId);
+	left = std::max(self.pos.x - radius, 0);
+	top = std::max(self.pos.y - radius, 0);
+	right = std::min(self.pos.x + radius + 1, m_width);
+	bottom = std::min(self.pos.y + radius + 1, m_height);
+}
+
+void Simulator::getGameInfo(int playerId, GameInfo& gameInfo) const
+{
+	gameInfo.boardWidth = m_width;
+	gameInfo.boardHeight = m_height;
+	gameInfo.gameOver = m_over || !isAlive(playerId);
+
+	PartialBoard& board = gameInfo.partialBoard;
+	if (gameInfo.gameOver)
+	{
+		gameInfo.players.clear();
+		board.cells.clear();
+		return;
+	}
+
+	int left, top, right, bottom;
+	getViewBounds(playerId, left, top, right, bottom);
+
+	board.boardOffset.set(left, top);
+	board.resize(right - left, bottom - top);
+	board.clearSlots();
+
+	// Simulator IDs are small too, so look up each one's slot once.
+	int slots[MAX_PLAYERS + 1];
+	std::fill_n(slots, MAX_PLAYERS + 1, -1);
+	slots[0] = 0;
+	auto getSlot = [&](uint8_t id)
+	{
+		if (slots[id] < 0)
+		{
+			slots[id] = board.getSlot(id);
+		}
+		return (uint8_t)slots[id];
+	};
+
+	Cell* to = board.cells.data();
+	for (int y = top; y < bottom; y++)
+	{
+		const SimCell* cell = &m_cells[getIndex(left, y)];
+		for (int x = left; x < right; x++, cell++, to++)
+		{
+			to->owner = getSlot(cell->owner);
+			to->trail = getSlot(cell->trail);
+		}
+	}
+
+	// Update the existing Player objects so pointers held by the bot stay valid, as GameClient does.
+	gameInfo.players.beginUpdate();
+	for (int id : m_order)
+	{
+		const SimPlayer& simPlayer = m_players[id];
+		Player& player = gameInfo.players.update(simPlayer.name);
+		player.id = id;
+		player.score = simPlayer.score;
+
+		const Position& pos = simPlayer.pos;
+		if (pos.x >= left && pos.x < right && pos.y >= top && pos.y < bottom)
+		{
+			player.pos = pos;
+			player.dir = simPlayer.dir;
+		}
+		else
+		{
+			player.pos.set(Position::UNKNOWN_POS, Position::UNKNOWN_POS);
+			player.dir.set(Position::UNKNOWN_POS, Position::UNKNOWN_POS);
+		}
+	}
+	gameInfo.players.endUpdate();
+}
+
+void Simulator::getGameState(int playerId, std::string& json) const
+{
+	rapidjson::StringBuffer s;
+	rapidjson::Writer<rapidjson::StringBuffer> writer(s);
+	writer.StartObject();
+
+	// The server only knows a player while they're in the game.
+	if (!isAlive(playerId))
+	{
+		writer.Key("over");
+		writer.Bool(true);
+		writer.EndObject();
+		json.assign(s.GetString(), s.GetSize());
+		return;
+	}
+
+	int left, top, right, bottom;
+	getViewBounds(playerId, left, top, right, bottom);
+
+	writer.Key("boardWidth");
+	writer.Int(m_width);
+	writer.Key("boardHeight");
+	writer.Int(m_height);
+	writer.Key("viewOrigin");
+	writer.StartObject();
+	writer.Key("x");
+	writer.Int(left);
+	writer.Key("y");
+	writer.Int(top);
+	writer.EndObject();
+
+	// Each space is "<owner>,<trail>", with empty strings for no player.
+	writer.Key("board");
+	writer.StartArray();
+	for (int y = top; y < bottom; y++)
+	{
+		writer.StartArray();
+		const SimCell* cell = &m_cells[getIndex(left, y)];
+		for (int x = left; x < right; x++, cell++)
+		{
+			char space[8];
+			char* end = space;
+			if (cell->owner != 0)
+			{
+				end += std::sprintf(end, "%d", cell->owner);
+			}
+			*end++ = ',';
+			if (cell->trail != 0)
+			{
+				end += std::sprintf(end, "%d", cell->trail);
+			}
+			writer.String(space, (rapidjson::SizeType)(end - space));
+		}
+		writer.EndArray();
+	}
+	writer.EndArray();
+
+	writer.Key("players");
+	writer.StartArray();
+	for (int id : m_order)
+	{
+		const SimPlayer& player = m_players[id];
+		writer.StartObject();
+		writer.Key("name");
+		writer.String(player.name.c_str(), (rapidjson::SizeType)player.name.size());
+		writer.Key("score");
+		writer.Int(player.score);
+		writer.Key("id");
+		writer.Int(id);
+
+		const Position& pos = player.pos;
+		if (pos.x >= left && pos.x < right && pos.y >= top && pos.y < bottom)
+		{
+			writer.Key("pos");
+			writer.StartObject();
+			writer.Key("x");
+			writer.Int(pos.x);
+			writer.Key("y");
+			writer.Int(pos.y);
+			writer.EndObject();
+			writer.Key("dir");
+			writer.StartObject();
+			writer.Key("x");
+			writer.Int(player.dir.x);
+			writer.Key("y");
+			writer.Int(player.dir.y);
+			writer.EndObject();
+		}
+		writer.EndObject();
+	}
+	writer.EndArray();
+
+	if (m_over)
+	{
+		writer.Key("over");
+		writer.Bool(true);
+	}
+
+	writer.EndObject();
+	json.assign(s.GetString(), s.GetSize());
+}
@@ -0,0 +1,197 @@
+#include "TaskPool.h"
+
+#include <algorithm>
+
+TaskPool::TaskPool(int workers) :
+	m_generation(0),
+	m_stopping(false),
+	m_body(nullptr),
+	m_grain(1),
+	m_remaining(0),
+	m_ran(0),
+	m_active(0),
+	m_cancelled(false),
+	m_pushes(0),
+	m_sleeping(0)
+{
+	if (workers <= 0)
+	{
+		workers = std::max(1, (int)std::thread::hardware_concurrency());
+	}
+	for (int i = 0; i < workers; i++)
+	{
+		m_workers.emplace_back(new Worker());
+	}
+
+	// Worker 0 is whoever calls parallelFor().
+	for (int i = 1; i < workers; i++)
+	{
+		m_threads.push_back(std::thread([this, i]() { work(i); }));
+	}
+}
+
+TaskPool::~TaskPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_wakeMutex);
+		m_stopping = true;
+	}
+	m_wake.notify_all();
+	for (std::thread& thread : m_threads)
+	{
+		thread.join();
+	}
+}
+
+int TaskPool::parallelFor(int count, const Body& body, Clock::time_point deadline, int grain)
+{
+	if (count <= 0)
+	{
+		return 0;
+	}
+
+	m_body = &body;
+	m_deadline = deadline;
+	m_grain = std::max(grain, 1);
+	m_ran = 0;
+	m_cancelled = false;
+	{
+		std::lock_guard<std::mutex> lock(m_workers[0]->mutex);
+		m_workers[0]->ranges.push_back(Range{ 0, count });
+	}
+	m_remaining = count;
+
+	if (!m_threads.empty())
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_wakeMutex);
+			m_generation++;
+		}
+		m_wake.notify_all();
+	}
+
+	// Help until everything has run, then wait for the others to let go of the body.
+	runLoop(0);
+	waitUntil([this]() { return m_active == 0; });
+	m_body = nullptr;
+	return m_ran;
+}
+
+void TaskPool::work(int worker)
+{
+	unsigned seen = 0;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_wakeMutex);
+			m_wake.wait(lock, [&]() { return m_stopping || m_generation != seen; });
+			if (m_stopping)
+			{
+				return;
+			}
+			seen = m_generation;
+		}
+		runLoop(worker);
+	}
+}
+
+void TaskPool::runLoop(int worker)
+{
+	// m_active goes up before m_remaining is checked, so parallelFor() can't return while this might touch the loop.
+	m_active++;
+	while (m_remaining > 0)
+	{
+		// Note the splits so far first, so one made after we looked for a range still wakes us.
+		unsigned pushes = m_pushes;
+		Range range;
+		if (takeRange(worker, range))
+		{
+			runRange(worker, range);
+		}
+		else
+		{
+			waitUntil([this, pushes]() { return m_remaining <= 0 || m_pushes != pushes; });
+		}
+	}
+	if (--m_active == 0 && m_sleeping > 0)
+	{
+		notifyIdle();
+	}
+}
+
+bool TaskPool::takeRange(int worker, Range& range)
+{
+	// Our own newest range first, since it's the one we just split off and is likely still in cache.
+	{
+		Worker& own = *m_workers[worker];
+		std::lock_guard<std::mutex> lock(own.mutex);
+		if (!own.ranges.empty())
+		{
+			range = own.ranges.back();
+			own.ranges.pop_back();
+			return true;
+		}
+	}
+
+	// Otherwise the oldest (so biggest) range of the next worker that has one.
+	int count = (int)m_workers.size();
+	for (int i = 1; i < count; i++)
+	{
+		Worker& victim = *m_workers[(worker + i) % count];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.ranges.empty())
+		{
+			range = victim.ranges.front();
+			victim.ranges.pop_front();
+			return true;
+		}
+	}
+	return false;
+}
+
+void TaskPool::runRange(int worker, Range range)
+{
+	// Split off the second half until what's left is small, so there's always something to steal. Once the loop's
+	// cancelled, what's left is only skipped, so there's no point.
+	Worker& own = *m_workers[worker];
+	while (range.end - range.begin > m_grain && !m_cancelled)
+	{
+		int middle = range.begin + (range.end - range.begin) / 2;
+		{
+			std::lock_guard<std::mutex> lock(own.mutex);
+			own.ranges.push_back(Range{ middle, range.end });
+		}
+		range.end = middle;
+		m_pushes++;
+		if (m_sleeping > 0)
+		{
+			notifyIdle();
+		}
+	}
+
+	int ran = 0;
+	for (int index = range.begin; index < range.end; index++)
+	{
+		if (m_cancelled || (m_deadline != Clock::time_point::max() && Clock::now() >= m_deadline))
+		{
+			m_cancelled = true;
+			break;
+		}
+		(*m_body)(index, worker);
+		ran++;
+	}
+	m_ran += ran;
+	if ((m_remaining -= range.end - range.begin) <= 0 && m_sleeping > 0)
+	{
+		notifyIdle();
+	}
+}
+
+void TaskPool::notifyIdle()
+{
+	// Taking the lock means a thread that checked before the change is asleep by now, so it gets the notification.
+	{
+		std::lock_guard<std::mutex> lock(m_wakeMutex);
+	}
+	m_idle.notify_all();
+}
@@ -0,0 +1,133 @@
+#include "TrailSafety.h"
+
+#include <algorithm>
+
+TrailSafety::TrailSafety() :
+	m_distances(nullptr),
+	m_start()
+{
+}
+
+void TrailSafety::update(const PlayerDistances& distances, const std::vector<Position>& trail, DirectionCode dir)
+{
+	m_distances = &distances;
+	m_start.pos = trail.empty() ? Position() : trail.back();
+	m_start.dir = dir;
+	m_start.out = !trail.empty() && distances.getDistanceHome(m_start.pos) != 0;
+	m_start.arrival = DistanceField::UNREACHABLE;
+	m_start.worst.margin = SafetyMargin::SAFE;
+	m_start.worst.enemyArrival = DistanceField::UNREACHABLE;
+	m_start.worst.homeTime = 0;
+	m_start.worst.legal = !trail.empty();
+
+	// The trail we have now is exposed whatever we do. The first space is ours, so it isn't part of it.
+	if (m_start.out)
+	{
+		for (size_t i = 1; i < trail.size(); i++)
+		{
+			m_start.arrival = std::min(m_start.arrival, distances.getNearestEnemyDistance(trail[i]));
+		}
+	}
+}
+
+SafetyMargin TrailSafety::analyze(const Moves& moves) const
+{
+	Race race = m_start;
+	for (size_t i = 0; i < moves.size() && race.worst.legal; i++)
+	{
+		race.worst.legal = step(race, moves.getCode(i), (int)i + 1);
+	}
+	return finish(race, (int)moves.size());
+}
+
+void TrailSafety::analyzeAll(std::vector<SafetyMargin>& margins) const
+{
+	margins.resize(1 << (2 * Moves::MOVES_PER_TURN));
+	analyzeFrom(m_start, 0, 0, margins);
+}
+
+SafetyMargin TrailSafety::getCurrent() const
+{
+	return finish(m_start, 0);
+}
+
+bool TrailSafety::step(Race& race, DirectionCode code, int moves) const
+{
+	// Returns false if the move is illegal. Spaces outside the fields are off the board: the view always reaches
+	// farther than a turn's moves, except where the board ends.
+	if (code == getOpposite(race.dir))
+	{
+		return false;
+	}
+	race.pos.set(race.pos.x + DIRECTION_X[code], race.pos.y + DIRECTION_Y[code]);
+	race.dir = code;
+	const DistanceField& home = m_distances->getHomeField();
+	const Position& offset = m_distances->getOffset();
+	if (!home.isOnBoard(race.pos.x - offset.x, race.pos.y - offset.y))
+	{
+		return false;
+	}
+
+	if (m_distances->getDistanceHome(race.pos) == 0)
+	{
+		// Home: this trip's race is over, and this is when it ended.
+		if (race.out)
+		{
+			keepWorse(race.worst, race.arrival, moves);
+			race.out = false;
+			race.arrival = DistanceField::UNREACHABLE;
+		}
+		return true;
+	}
+
+	race.out = true;
+	race.arrival = std::min(race.arrival, m_distances->getNearestEnemyDistance(race.pos));
+	return true;
+}
+
+SafetyMargin TrailSafety::finish(const Race& race, int moves) const
+{
+	// A trip still going at the end of the plan races the shortest way home from there.
+	SafetyMargin worst = race.worst;
+	if (race.out && worst.legal)
+	{
+		int distance = m_distances->getDistanceHome(race.pos);
+		int homeTime = distance == DistanceField::UNREACHABLE ? distance : moves + distance;
+		keepWorse(worst, race.arrival, homeTime);
+	}
+	return worst;
+}
+
+void TrailSafety::analyzeFrom(const Race& race, int depth, int packed, std::vector<SafetyMargin>& margins) const
+{
+	// Depth first through the plans, so each prefix is followed once. Illegal prefixes make every plan under them
+	// illegal.
+	if (depth == Moves::MOVES_PER_TURN || !race.worst.legal)
+	{
+		SafetyMargin margin = finish(race, depth);
+		int count = 1 << (2 * (Moves::MOVES_PER_TURN - depth));
+		for (int rest = 0; rest < count; rest++)
+		{
+			margins[packed | rest << (2 * depth)] = margin;
+		}
+		return;
+	}
+
+	for (int code = 0; code < 4; code++)
+	{
+		Race next = race;
+		next.worst.legal = step(next, (DirectionCode)code, depth + 1);
+		analyzeFrom(next, depth + 1, packed | code << (2 * depth), margins);
+	}
+}
+
+void TrailSafety::keepWorse(SafetyMargin& worst, int arrival, int homeTime)
+{
+	int margin = arrival - homeTime;
+	if (margin < worst.margin)
+	{
+		worst.margin = margin;
+		worst.enemyArrival = arrival;
+		worst.homeTime = homeTime;
+	}
+}
@@ -0,0 +1,141 @@
+#include "TranspositionTable.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	const uint64_t VISITS_MASK = TranspositionTable::MAX_VISITS;
+	const int GENERATION_SHIFT = 24;
+	const int TOTAL_SHIFT = 32;
+}
+
+TranspositionTable::TranspositionTable(size_t megabytes) :
+	m_mask(0),
+	m_generation(0)
+{
+	size_t buckets = 1;
+	while (buckets * 2 * sizeof(Bucket) <= megabytes * 1024 * 1024)
+	{
+		buckets *= 2;
+	}
+	m_buckets.reset(new Bucket[buckets]);
+	m_mask = buckets - 1;
+	clear();
+}
+
+void TranspositionTable::clear()
+{
+	for (size_t i = 0; i <= m_mask; i++)
+	{
+		for (Slot& slot : m_buckets[i].slots)
+		{
+			slot.check.store(0, std::memory_order_relaxed);
+			slot.data.store(0, std::memory_order_relaxed);
+		}
+	}
+	m_generation = 0;
+}
+
+void TranspositionTable::newSearch()
+{
+	m_generation = (m_generation + 1) & 0xff;
+}
+
+bool TranspositionTable::probe(uint64_t key, Entry& entry) const
+{
+	const Bucket& bucket = m_buckets[key & m_mask];
+	for (const Slot& slot : bucket.slots)
+	{
+		uint64_t data;
+		if (read(slot, key, data))
+		{
+			entry = unpack(data);
+			return true;
+		}
+	}
+	return false;
+}
+
+TranspositionTable::Entry TranspositionTable::add(uint64_t key, float reward)
+{
+	Bucket& bucket = m_buckets[key & m_mask];
+	for (int i = 0; i < 2; i++)
+	{
+		uint64_t data;
+		if (read(bucket.slots[i], key, data))
+		{
+			Entry entry = unpack(data);
+			entry.visits = std::min<int>(entry.visits + 1, MAX_VISITS);
+			entry.total += reward;
+			write(bucket.slots[i], key, pack(entry, m_generation));
+			if (i == 1)
+			{
+				promote(bucket);
+			}
+			return entry;
+		}
+	}
+
+	// A new state goes in the first slot only if what's there is worth less: nothing, from an earlier search, or with
+	// no more visits than this.
+	Entry entry = { 1, reward };
+	uint64_t deep = bucket.slots[0].data.load(std::memory_order_relaxed);
+	bool replace = deep == 0 || getGeneration(deep) != m_generation || unpack(deep).visits <= entry.visits;
+	write(bucket.slots[replace ? 0 : 1], key, pack(entry, m_generation));
+	return entry;
+}
+
+void TranspositionTable::promote(Bucket& bucket) const
+{
+	// Once the newest state has had more visits than the one kept, they change places, so the always-replace slot
+	// doesn't throw it away.
+	Slot& deep = bucket.slots[0];
+	Slot& recent = bucket.slots[1];
+	uint64_t deepData = deep.data.load(std::memory_order_relaxed);
+	uint64_t deepKey = deep.check.load(std::memory_order_relaxed) ^ deepData;
+	uint64_t recentData = recent.data.load(std::memory_order_relaxed);
+	uint64_t recentKey = recent.check.load(std::memory_order_relaxed) ^ recentData;
+	bool stale = deepData == 0 || getGeneration(deepData) != m_generation;
+	if (recentData != 0 && (stale || unpack(recentData).visits > unpack(deepData).visits))
+	{
+		write(deep, recentKey, recentData);
+		write(recent, deepKey, deepData);
+	}
+}
+
+uint64_t TranspositionTable::pack(const Entry& entry, unsigned generation)
+{
+	uint32_t totalBits;
+	std::memcpy(&totalBits, &entry.total, sizeof(totalBits));
+	return (uint64_t)totalBits << TOTAL_SHIFT | (uint64_t)(generation & 0xff) << GENERATION_SHIFT
+		| ((uint64_t)entry.visits & VISITS_MASK);
+}
+
+TranspositionTable::Entry TranspositionTable::unpack(uint64_t data)
+{
+	Entry entry;
+	uint32_t totalBits = (uint32_t)(data >> TOTAL_SHIFT);
+	std::memcpy(&entry.total, &totalBits, sizeof(totalBits));
+	entry.visits = (int)(data & VISITS_MASK);
+	return entry;
+}
+
+unsigned TranspositionTable::getGeneration(uint64_t data)
+{
+	return (unsigned)(data >> GENERATION_SHIFT) & 0xff;
+}
+
+bool TranspositionTable::read(const Slot& slot, uint64_t key, uint64_t& data)
+{
+	// Empty slots have no data, so they never match, even for a key of 0.
+	data = slot.data.load(std::memory_order_relaxed);
+	uint64_t check = slot.check.load(std::memory_order_relaxed);
+	return data != 0 && (check ^ data) == key;
+}
+
+void TranspositionTable::write(Slot& slot, uint64_t key, uint64_t data)
+{
+	slot.data.store(data, std::memory_order_relaxed);
+	slot.check.store(key ^ data, std::memory_order_relaxed);
+}
@@ -0,0 +1,86 @@
+#include "WorldMap.h"
+
+#include <algorithm>
+
+/**********************************************************************************************************************
+ *********************************************************************************************************************/
+WorldMap::WorldMap() :
+	m_turn(0)
+{
+}
+
+void WorldMap::init(int boardWidth, int boardHeight)
+{
+	// After reset(), resize() fills the board with empty spaces.
+	m_board.reset();
+	m_board.resize(std::max(boardWidth, 0), std::max(boardHeight, 0));
+	m_lastSeen.assign(m_board.cells.size(), NEVER_SEEN);
+	m_turn = 0;
+}
+
+void WorldMap::update(const GameInfo& gameInfo)
+{
+	if (gameInfo.boardWidth != m_board.width || gameInfo.boardHeight != m_board.height)
+	{
+		init(gameInfo.boardWidth, gameInfo.boardHeight);
+	}
+	update(gameInfo.partialBoard);
+}
+
+void WorldMap::update(const PartialBoard& view)
+{
+	// Once the game's over, the parser and the simulator clear the view's cells but leave its size, so there's nothing
+	// to copy. That isn't a turn seen, either.
+	if (view.width <= 0 || view.height <= 0 || view.cells.size() < (size_t)view.width * view.height)
+	{
+		return;
+	}
+	m_turn++;
+
+	// The server clips the view to the board, but don't trust it to.
+	int left = std::max(view.boardOffset.x, 0);
+	int top = std::max(view.boardOffset.y, 0);
+	int right = std::min(view.boardOffset.x + view.width, m_board.width);
+	int bottom = std::min(view.boardOffset.y + view.height, m_board.height);
+	if (left >= right || top >= bottom)
+	{
+		return;
+	}
+
+	// The view numbers its slots differently, so map them to the map's. Make room first, so adding the view's players
+	// can't compact the slots partway through.
+	if (m_board.getSlotCount() + view.getSlotCount() > Board::MAX_SLOTS)
+	{
+		m_board.compactSlots();
+	}
+	// The parser keeps its slots from turn to turn, and new players are added to both in the same order, so usually
+	// they match and rows can be copied as they are.
+	uint8_t slots[Board::MAX_SLOTS];
+	bool same = true;
+	for (int slot = 0; slot < view.getSlotCount(); slot++)
+	{
+		slots[slot] = m_board.getSlot(view.getPlayerId(slot));
+		same = same && slots[slot] == slot;
+	}
+
+	// A row at a time.
+	int count = right - left;
+	for (int y = top; y < bottom; y++)
+	{
+		const Cell* from = view.getRow(y - view.boardOffset.y) + (left - view.boardOffset.x);
+		Cell* to = m_board.getRow(y) + left;
+		if (same)
+		{
+			std::copy_n(from, count, to);
+		}
+		else
+		{
+			for (int x = 0; x < count; x++)
+			{
+				to[x].owner = slots[from[x].owner];
+				to[x].trail = slots[from[x].trail];
+			}
+		}
+		std::fill_n(m_lastSeen.begin() + m_board.getIndex(left, y), count, m_turn);
+	}
+}
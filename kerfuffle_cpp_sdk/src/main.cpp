@@ -10,17 +10,32 @@ int main(int argc, char** argv)
 	std::string persistent = argc > 2 ? argv[2] : "true";
 	const char* host = argc > 3 ? argv[3] : "10.100.139.2";
 	const char* port = argc > 4 ? argv[4] : "80";
+	std::string async = argc > 5 ? argv[5] : "false";
+	const char* recording = argc > 6 ? argv[6] : nullptr;
 	boost::algorithm::to_lower(persistent);
+	boost::algorithm::to_lower(async);
 	bool isPersistent = persistent == "true" || persistent == "1";
+	bool isAsync = async == "true" || async == "1";
 
 	// Create a game client.
 	GameClient client(host, port);
+	if (recording)
+	{
+		client.recordTo(recording);
+	}
 
 	// Create a bot.
 	Bot* bot = new BeastBot();
 
 	// Let the games begin!
-	client.play(bot, botName, isPersistent);
+	if (isAsync)
+	{
+		client.playAsync(bot, botName, isPersistent);
+	}
+	else
+	{
+		client.play(bot, botName, isPersistent);
+	}
 
 	// We don't actually get here (because no one will ever want to quit this game).
 	delete bot;
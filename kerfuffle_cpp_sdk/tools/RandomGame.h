@@ -0,0 +1,43 @@
+#pragma once
+
+// Test games for the tools that time things (benchmarks, decode_bench): a full-size board with players wandering at
+// random, so the territory and trails look like the middle of a game without needing a recording.
+
+#include "Simulator.h"
+
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+typedef std::function<void(Simulator& sim, int turn)> RandomGameCallback;
+
+// Starts a game with the given number of players, named bot0, bot1, ..., and has them all move at random for the given
+// number of turns, or until the game's over. afterTurn, if given, is called after each turn.
+inline Simulator makeRandomGame(unsigned seed, int players, int turns, bool persistent = false,
+	const RandomGameCallback& afterTurn = nullptr)
+{
+	Simulator sim(Simulator::DEFAULT_WIDTH, Simulator::DEFAULT_HEIGHT, persistent, seed);
+	std::vector<std::string> names;
+	for (int i = 0; i < players; i++)
+	{
+		names.push_back("bot" + std::to_string(i));
+	}
+	sim.addStartingPlayers(names);
+
+	std::mt19937 random(seed);
+	const Direction directions[] = { Direction::Up, Direction::Right, Direction::Down, Direction::Left };
+	for (int turn = 0; turn < turns && !sim.isOver(); turn++)
+	{
+		for (int id : sim.getPlayerIds())
+		{
+			sim.setDirection(id, directions[random() % 4]);
+		}
+		sim.turn();
+		if (afterTurn)
+		{
+			afterTurn(sim, turn);
+		}
+	}
+	return sim;
+}
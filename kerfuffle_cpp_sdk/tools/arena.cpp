@@ -0,0 +1,149 @@
+// arena plays bots against each other offline, many games at once, and reports their standings: how often each won,
+// its Elo, and how long its getMoves() took. Games use Simulator in place of the server, on the full-size board, so
+// there's no lobby, network, or waiting between batches.
+//
+// Usage: arena <bots> [options]
+//   bots               The bots to play, as "<type>,<type>,...", from the factories below. A type listed twice plays
+//                      as two bots, e.g. "search,search" to see how much two copies differ by chance alone.
+//   --games <n>        Games to play. Defaults to 100.
+//   --players <n>      Players in each game. Defaults to 2.
+//   --batches <n>      The most batches of moves in a game. Defaults to 300.
+//   --turn-time <ms>   How long each getMoves() can take. Later moves miss the batch. Defaults to 100.
+//   --threads <n>      Games played at once. Defaults to the number of cores.
+//   --size <w>x<h>     The board size. Defaults to 162x108.
+//   --view <n>         The view radius around each player. Defaults to the server's formula (12 and up).
+//   --seed <n>         Picks the seats and seeds the games. Defaults to 0.
+//   --quiet            Only print the standings.
+//
+// Add your own bot types to the factories below, e.g. a SearchBot with different Settings to tune them.
+
+#include "Arena.h"
+#include "BeastBot.h"
+#include "SearchBot.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+	int usage()
+	{
+		std::cout << "Usage: arena <bots> [--games n] [--players n] [--batches n] [--turn-time ms] [--threads n] "
+			"[--size WxH] [--view n] [--seed n] [--quiet]" << std::endl;
+		return 2;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::map<std::string, Arena::BotFactory> factories;
+	factories["beast"] = []() { return new BeastBot(); };
+	factories["search"] = []() { return new SearchBot(); };
+	factories["search-notable"] = []()
+	{
+		// Without the transposition table, to see what it's worth at the same time per turn.
+		SearchBot::Settings settings;
+		settings.useTable = false;
+		return new SearchBot(settings);
+	};
+
+	if (argc < 2)
+	{
+		return usage();
+	}
+
+	Arena::Options options;
+	bool quiet = false;
+	for (int i = 2; i < argc; i++)
+	{
+		std::string option = argv[i];
+		if (option == "--quiet")
+		{
+			quiet = true;
+			continue;
+		}
+		if (i + 1 >= argc)
+		{
+			return usage();
+		}
+
+		const char* value = argv[++i];
+		if (option == "--games")
+		{
+			options.games = std::atoi(value);
+		}
+		else if (option == "--players")
+		{
+			options.playersPerGame = std::atoi(value);
+		}
+		else if (option == "--batches")
+		{
+			options.maxBatches = std::atoi(value);
+		}
+		else if (option == "--turn-time")
+		{
+			options.turnTime = std::chrono::milliseconds(std::atoi(value));
+		}
+		else if (option == "--threads")
+		{
+			options.threads = std::atoi(value);
+		}
+		else if (option == "--size")
+		{
+			if (std::sscanf(value, "%dx%d", &options.width, &options.height) != 2)
+			{
+				return usage();
+			}
+		}
+		else if (option == "--view")
+		{
+			options.viewRadius = std::atoi(value);
+		}
+		else if (option == "--seed")
+		{
+			options.seed = (unsigned)std::strtoul(value, nullptr, 10);
+		}
+		else
+		{
+			return usage();
+		}
+	}
+
+	Arena arena(options);
+	std::map<std::string, int> listed;
+	std::stringstream spec(argv[1]);
+	std::string type;
+	while (std::getline(spec, type, ','))
+	{
+		auto factory = factories.find(type);
+		if (factory == factories.end())
+		{
+			std::cout << "Unknown bot type: " << type << std::endl;
+			return 2;
+		}
+		int copy = ++listed[type];
+		arena.addBot(copy == 1 ? type : type + "-" + std::to_string(copy), factory->second);
+	}
+
+	try
+	{
+		arena.run(quiet ? nullptr : &std::cout);
+	}
+	catch (std::exception& e)
+	{
+		std::cout << e.what() << std::endl;
+		return 1;
+	}
+
+	if (!quiet)
+	{
+		std::cout << std::endl;
+	}
+	arena.printStandings(std::cout);
+	return 0;
+}
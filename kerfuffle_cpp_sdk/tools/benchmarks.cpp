@@ -0,0 +1,805 @@
+// benchmarks times the client's hot paths: decoding game states, rebuilding and searching the players, reading the
+// board, territory math with and without BitBoards, updating a WorldMap, distance fields, finding and estimating
+// captures, racing our trail against the enemies, the bundled bots' getMoves(), and scoring candidates and sharing a
+// TranspositionTable on a TaskPool with 1, 2, 4, ... workers, up to the number of cores. Each one runs for a while in a
+// few samples and reports the median time per operation, so numbers can be compared from build to build.
+//
+// Usage: benchmarks [--filter text] [--min-time seconds] [--json file]
+//   --filter    Only run benchmarks whose names contain the text.
+//   --min-time  How long to run each benchmark. Defaults to 0.5 seconds.
+//   --json      Also write the results as JSON to the file ('-' for standard out). It uses the same layout as Google
+//               Benchmark's JSON output, so its comparison tools work on it. With '-', the table goes to standard error.
+//
+// 'make run_benchmarks' builds and runs it, writing benchmarks.json to the build directory.
+
+#include "BeastBot.h"
+#include "BitBoard.h"
+#include "CaptureFinder.h"
+#include "DistanceField.h"
+#include "GameStateParser.h"
+#include "RandomGame.h"
+#include "Simulator.h"
+#include "TaskPool.h"
+#include "TrailSafety.h"
+#include "TranspositionTable.h"
+#include "WorldMap.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	const int SAMPLES = 5;
+	const double CALIBRATION_SECONDS = 0.01;
+
+	// Runs the operation count times and returns something computed from the work, so the compiler can't skip it.
+	typedef std::function<long long(long long count)> Operation;
+
+	struct Benchmark
+	{
+		std::string name;
+		long long itemsPerOp; // For operations that handle many things at once, e.g. every space on the board.
+		Operation run;
+	};
+
+	struct Result
+	{
+		std::string name;
+		long long iterations;
+		double nsPerOp;    // The median of the samples.
+		double minNsPerOp;
+		long long itemsPerOp;
+	};
+
+	volatile long long g_sink;
+
+	double timeRun(const Operation& run, long long count)
+	{
+		Clock::time_point start = Clock::now();
+		g_sink = run(count);
+		return std::chrono::duration<double>(Clock::now() - start).count();
+	}
+
+	Result measure(const Benchmark& benchmark, double minSeconds)
+	{
+		// Find a count that takes long enough to time well, then take the samples.
+		long long count = 1;
+		double seconds = timeRun(benchmark.run, count);
+		while (seconds < CALIBRATION_SECONDS && count < (1LL << 40))
+		{
+			count *= 2;
+			seconds = timeRun(benchmark.run, count);
+		}
+		count = std::max<long long>((long long)(count * (minSeconds / SAMPLES) / std::max(seconds, 1e-9)), 1);
+
+		std::vector<double> samples;
+		for (int i = 0; i < SAMPLES; i++)
+		{
+			samples.push_back(timeRun(benchmark.run, count) * 1e9 / count);
+		}
+		std::sort(samples.begin(), samples.end());
+
+		Result result;
+		result.name = benchmark.name;
+		result.iterations = count * SAMPLES;
+		result.nsPerOp = samples[SAMPLES / 2];
+		result.minNsPerOp = samples.front();
+		result.itemsPerOp = benchmark.itemsPerOp;
+		return result;
+	}
+
+	/******************************************************************************************************************
+	 * Inputs
+	 *****************************************************************************************************************/
+
+	// Plays a game with players wandering at random, and returns what the server would send the first of them with
+	// the given view radius.
+	std::string makeGameState(int viewRadius, unsigned seed)
+	{
+		Simulator sim = makeRandomGame(seed, 8, 200);
+		std::string json;
+		sim.setViewRadius(viewRadius);
+		sim.getGameState(sim.getPlayerIds().front(), json);
+		return json;
+	}
+
+	// A game state with an empty board and the given number of players, so parsing it is all players.
+	std::string makePlayersState(int players)
+	{
+		std::ostringstream json;
+		json << "{\"boardWidth\":162,\"boardHeight\":108,\"viewOrigin\":{\"x\":0,\"y\":0},\"board\":[],\"players\":[";
+		for (int i = 0; i < players; i++)
+		{
+			json << (i > 0 ? "," : "") << "{\"name\":\"bot" << i << "\",\"score\":" << 25 + i << ",\"id\":" << i + 1
+				<< ",\"pos\":{\"x\":" << i % 162 << ",\"y\":" << i % 108 << "},\"dir\":{\"x\":1,\"y\":0}}";
+		}
+		json << "],\"over\":false}";
+		return json.str();
+	}
+
+	GameInfo parseGameState(const std::string& json)
+	{
+		GameStateParser parser;
+		GameInfo gameInfo;
+		std::string work = json;
+		parser.parse(&work[0], gameInfo);
+		return gameInfo;
+	}
+
+	// The first space the player owns, scanning from the top row down, or UNKNOWN_POS if they own none.
+	Position findFirstOwned(const Board& board, int id)
+	{
+		for (int y = 0; y < board.height; y++)
+		{
+			for (int x = 0; x < board.width; x++)
+			{
+				if (board.getOwnerId(x, y) == id)
+				{
+					return Position(x, y);
+				}
+			}
+		}
+		return Position(Position::UNKNOWN_POS, Position::UNKNOWN_POS);
+	}
+
+	// A trail that's just left the top of the player's territory: the first space they own, then up to length more
+	// spaces straight up.
+	std::vector<Position> makeTrailHome(const Board& board, int id, int length)
+	{
+		std::vector<Position> trail(1, findFirstOwned(board, id));
+		for (int i = 0; i < length && trail.back().y > 0; i++)
+		{
+			trail.push_back(Position(trail.back().x, trail.back().y - 1));
+		}
+		return trail;
+	}
+
+	/******************************************************************************************************************
+	 * Benchmarks
+	 *****************************************************************************************************************/
+
+	// Copies the response and parses it in place, as GameClient does with each one.
+	Benchmark decode(const std::string& name, const std::string& json, bool useDom)
+	{
+		auto parser = std::make_shared<GameStateParser>();
+		auto gameInfo = std::make_shared<GameInfo>();
+		auto work = std::make_shared<std::string>();
+		Benchmark benchmark = { name, 1, [=](long long count)
+		{
+			long long sum = 0;
+			for (long long i = 0; i < count; i++)
+			{
+				work->assign(json);
+				bool ok = useDom ? parser->parseDom(&(*work)[0], *gameInfo) : parser->parse(&(*work)[0], *gameInfo);
+				sum += ok ? gameInfo->partialBoard.width : 0;
+			}
+			return sum;
+		} };
+		return benchmark;
+	}
+
+	Benchmark findPlayerById(const std::string& name, int players)
+	{
+		auto gameInfo = std::make_shared<GameInfo>(parseGameState(makePlayersState(players)));
+		Benchmark benchmark = { name, players, [=](long long count)
+		{
+			long long sum = 0;
+			for (long long i = 0; i < count; i++)
+			{
+				for (int id = 1; id <= players; id++)
+				{
+					sum += gameInfo->players.findPlayerById(id)->score;
+				}
+			}
+			return sum;
+		} };
+		return benchmark;
+	}
+
+	// Reads every space of a full board through the getters, which go through Board::getIndex().
+	Benchmark scanBoard(const std::string& name, const std::string& json)
+	{
+		auto gameInfo = std::make_shared<GameInfo>(parseGameState(json));
+		const Board& board = gameInfo->partialBoard;
+		Benchmark benchmark = { name, (long long)board.width * board.height, [=](long long count)
+		{
+			const Board& board = gameInfo->partialBoard;
+			long long sum = 0;
+			for (long long i = 0; i < count; i++)
+			{
+				for (int y = 0; y < board.height; y++)
+				{
+					for (int x = 0; x < board.width; x++)
+					{
+						sum += board.getOwnerId(x, y) + board.getTrailId(x, y);
+					}
+				}
+			}
+			return sum;
+		} };
+		return benchmark;
+	}
+
+	// Reads every space of a full board a row at a time, as scanning code can.
+	Benchmark scanRows(const std::string& name, const std::string& json)
+	{
+		auto gameInfo = std::make_shared<GameInfo>(parseGameState(json));
+		const Board& board = gameInfo->partialBoard;
+		Benchmark benchmark = { name, (long long)board.width * board.height, [=](long long count)
+		{
+			const Board& board = gameInfo->partialBoard;
+			long long sum = 0;
+			for (long long i = 0; i < count; i++)
+			{
+				for (int y = 0; y < board.height; y++)
+				{
+					const Cell* row = board.getRow(y);
+					int width = board.width;
+					int rowSum = 0;
+					for (int x = 0; x < width; x++)
+					{
+						rowSum += row[x].owner + row[x].trail;
+					}
+					sum += rowSum;
+				}
+			}
+			return sum;
+		} };
+		return benchmark;
+	}
+
+	// Counts the first player's territory and the spaces it could grow into, by checking each space's neighbors on the
+	// Board, or with BitBoards.
+	Benchmark territory(const std::string& name, const std::string& json, bool useBitBoards)
+	{
+		auto gameInfo = std::make_shared<GameInfo>(parseGameState(json));
+		auto bitBoards = std::make_shared<PlayerBitBoards>();
+		auto frontier = std::make_shared<BitBoard>();
+		int id = gameInfo->players.begin()->second->id;
+		const Board& board = gameInfo->partialBoard;
+		Benchmark benchmark = { name, (long long)board.width * board.height, [=](long long count)
+		{
+			const Board& board = gameInfo->partialBoard;
+			long long sum = 0;
+			for (long long i = 0; i < count; i++)
+			{
+				if (useBitBoards)
+				{
+					bitBoards->update(board);
+					const BitBoard& owned = bitBoards->getTerritory(id);
+					owned.getFrontier(*frontier);
+					sum += owned.count() + frontier->count();
+					continue;
+				}
+
+				auto isOwned = [&](int x, int y)
+				{
+					return x >= 0 && y >= 0 && x < board.width && y < board.height && board.getOwnerId(x, y) == id;
+				};
+				for (int y = 0; y < board.height; y++)
+				{
+					for (int x = 0; x < board.width; x++)
+					{
+						if (isOwned(x, y))
+						{
+							sum++;
+						}
+						else if (isOwned(x - 1, y) || isOwned(x + 1, y) || isOwned(x, y - 1) || isOwned(x, y + 1))
+						{
+							sum++;
+						}
+					}
+				}
+			}
+			return sum;
+		} };
+		return benchmark;
+	}
+
+	Benchmark dilate(const std::string& name, const std::string& json)
+	{
+		auto gameInfo = std::make_shared<GameInfo>(parseGameState(json));
+		auto bitBoards = std::make_shared<PlayerBitBoards>();
+		auto out = std::make_shared<BitBoard>();
+		bitBoards->update(gameInfo->partialBoard);
+		const BitBoard& territory = bitBoards->getAllTerritory();
+		Benchmark benchmark = { name, (long long)territory.getWidth() * territory.getHeight(), [=](long long count)
+		{
+			const BitBoard& territory = bitBoards->getAllTerritory();
+			long long sum = 0;
+			for (long long i = 0; i < count; i++)
+			{
+				territory.dilate(*out);
+				sum += out->getRow(0)[0];
+			}
+			return sum;
+		} };
+		return benchmark;
+	}
+
+	// Searches a full board from every space the players own, around their trails.
+	Benchmark recomputeDistances(const std::string& name, const std::string& json)
+	{
+		auto gameInfo = std::make_shared<GameInfo>(parseGameState(json));
+		auto field = std::make_shared<DistanceField>();
+		const Board& board = gameInfo->partialBoard;
+		field->resize(board.width, board.height);
+		for (int y = 0; y < board.height; y++)
+		{
+			for (int x = 0; x < board.width; x++)
+			{
+				if (board.getOwnerId(x, y) != Player::NO_PLAYER)
+				{
+					field->addSource(x, y, board.getOwnerId(x, y));
+				}
+				field->setBlocked(x, y, board.getTrailId(x, y) != Player::NO_PLAYER);
+			}
+		}
+		Benchmark benchmark = { name, (long long)board.width * board.height, [=](long long count)
+		{
+			long long sum = 0;
+			for (long long i = 0; i < count; i++)
+			{
+				field->recompute();
+				sum += field->getDistance(0, 0);
+			}
+			return sum;
+		} };
+		return benchmark;
+	}
+
+	// The same field, repaired after a trail of a few spaces appears or disappears in the middle of the board.
+	Benchmark repairDistances(const std::string& name, const std::string& json, int spaces)
+	{
+		auto gameInfo = std::make_shared<GameInfo>(parseGameState(json));
+		auto field = std::make_shared<DistanceField>();
+		const Board& board = gameInfo->partialBoard;
+		field->resize(board.width, board.height);
+		for (int y = 0; y < board.height; y++)
+		{
+			for (int x = 0; x < board.width; x++)
+			{
+				if (board.getOwnerId(x, y) != Player::NO_PLAYER)
+				{
+					field->addSource(x, y, board.getOwnerId(x, y));
+				}
+			}
+		}
+		field->recompute();
+		Benchmark benchmark = { name, spaces, [=](long long count)
+		{
+			int width = field->getWidth();
+			int height = field->getHeight();
+			long long sum = 0;
+			for (long long i = 0; i < count; i++)
+			{
+				for (int s = 0; s < spaces; s++)
+				{
+					field->setBlocked(width / 2 - spaces / 2 + s, height / 2, i % 2 == 0);
+				}
+				field->update();
+				sum += field->getDistance(width / 2, height / 2 + 1);
+			}
+			return sum;
+		} };
+		return benchmark;
+	}
+
+	// Updates every player's distances from one turn of a game to the next and back.
+	Benchmark updatePlayerDistances(const std::string& name, unsigned seed)
+	{
+		auto turns = std::make_shared<std::vector<GameInfo> >(2);
+		auto worlds = std::make_shared<std::vector<WorldMap> >(2);
+		int self = 0;
+		makeRandomGame(seed, 8, 100, false, [&](Simulator& sim, int turn)
+		{
+			// With everyone in view, every player's distances are worked out.
+			sim.setViewRadius(Simulator::DEFAULT_WIDTH);
+			self = self != 0 ? self : sim.getPlayerIds().front();
+			GameInfo& gameInfo = (*turns)[turn % 2];
+			sim.getGameInfo(sim.isAlive(self) ? self : sim.getPlayerIds().front(), gameInfo);
+			(*worlds)[turn % 2].update(gameInfo);
+		});
+
+		auto distances = std::make_shared<PlayerDistances>();
+		Benchmark benchmark = { name, (long long)Simulator::DEFAULT_WIDTH * Simulator::DEFAULT_HEIGHT, [=](long long count)
+		{
+			long long sum = 0;
+			for (long long i = 0; i < count; i++)
+			{
+				const GameInfo& gameInfo = (*turns)[i % 2];
+				distances->update((*worlds)[i % 2], gameInfo.players, self);
+				sum += distances->getNearestEnemyDistance(Position(0, 0));
+			}
+			return sum;
+		} };
+		return benchmark;
+	}
+
+	// Finds what the first player would capture by closing a square loop of trail around the top of their territory,
+	// from BitBoards. Or from the board as it is, which includes building the BitBoards.
+	Benchmark findCapture(const std::string& name, const std::string& json, bool useBitBoards)
+	{
+		auto gameInfo = std::make_shared<GameInfo>(parseGameState(json));
+		auto bitBoards = std::make_shared<PlayerBitBoards>();
+		auto finder = std::make_shared<CaptureFinder>();
+		auto captured = std::make_shared<BitBoard>();
+		const Board& board = gameInfo->partialBoard;
+		int selfId = gameInfo->players.begin()->second->id;
+		bitBoards->update(board);
+
+		const BitBoard& owned = bitBoards->getTerritory(selfId);
+		Position pos = findFirstOwned(board, selfId);
+
+		auto trail = std::make_shared<BitBoard>(board.width, board.height);
+		int left = std::max(pos.x - 20, 0);
+		int top = std::max(pos.y - 20, 0);
+		int right = std::min(pos.x + 20, board.width - 1);
+		int bottom = std::min(pos.y + 20, board.height - 1);
+		for (int y = top; y <= bottom; y++)
+		{
+			for (int x = left; x <= right; x++)
+			{
+				if ((x == left || x == right || y == top || y == bottom) && !owned.isSet(x, y))
+				{
+					trail->set(x, y);
+				}
+			}
+		}
+
+		Benchmark benchmark = { name, (long long)board.width * board.height, [=](long long count)
+		{
+			long long sum = 0;
+			for (long long i = 0; i < count; i++)
+			{
+				bool ok = useBitBoards ? finder->find(bitBoards->getTerritory(selfId), *trail, pos, *captured)
+					: finder->find(gameInfo->partialBoard, selfId, pos, *captured);
+				sum += ok ? finder->getServerCount() : 0;
+			}
+			return sum;
+		} };
+		return benchmark;
+	}
+
+	// Estimates the capture for every sequence of moves for a turn, from a trail that's just left the top of the first
+	// player's territory. With update, it includes setting up for the turn.
+	Benchmark estimateCaptures(const std::string& name, const std::string& json, bool withUpdate)
+	{
+		auto gameInfo = std::make_shared<GameInfo>(parseGameState(json));
+		PlayerBitBoards bitBoards;
+		const Board& board = gameInfo->partialBoard;
+		int selfId = gameInfo->players.begin()->second->id;
+		bitBoards.update(board);
+		auto owned = std::make_shared<BitBoard>(bitBoards.getTerritory(selfId));
+		auto trail = std::make_shared<std::vector<Position> >(makeTrailHome(board, selfId, 5));
+
+		auto estimator = std::make_shared<CaptureEstimator>();
+		estimator->update(*owned, *trail);
+		const int sequences = 1 << (2 * Moves::MOVES_PER_TURN);
+		Benchmark benchmark = { name, sequences, [=](long long count)
+		{
+			long long sum = 0;
+			for (long long i = 0; i < count; i++)
+			{
+				if (withUpdate)
+				{
+					estimator->update(*owned, *trail);
+				}
+				for (int packed = 0; packed < sequences; packed++)
+				{
+					Moves moves = Moves::fromPacked((uint16_t)(packed | Moves::MOVES_PER_TURN << Moves::COUNT_SHIFT));
+					sum += estimator->estimate(moves).captured;
+				}
+			}
+			return sum;
+		} };
+		return benchmark;
+	}
+
+	// Races every sequence of moves for a turn against the enemies, from a trail that's just left the top of the first
+	// player's territory: one at a time, or all at once, sharing the work for sequences that start the same way.
+	Benchmark analyzeSafety(const std::string& name, const std::string& json, bool all)
+	{
+		auto gameInfo = std::make_shared<GameInfo>(parseGameState(json));
+		const PartialBoard& board = gameInfo->partialBoard;
+		int selfId = gameInfo->players.begin()->second->id;
+		auto distances = std::make_shared<PlayerDistances>();
+		distances->update(board, gameInfo->players, selfId);
+
+		auto safety = std::make_shared<TrailSafety>();
+		safety->update(*distances, makeTrailHome(board, selfId, 5), DIR_UP);
+		auto margins = std::make_shared<std::vector<SafetyMargin> >();
+		const int sequences = 1 << (2 * Moves::MOVES_PER_TURN);
+		Benchmark benchmark = { name, sequences, [=](long long count)
+		{
+			long long sum = 0;
+			for (long long i = 0; i < count; i++)
+			{
+				if (all)
+				{
+					safety->analyzeAll(*margins);
+					sum += (*margins)[i % sequences].margin;
+					continue;
+				}
+				for (int packed = 0; packed < sequences; packed++)
+				{
+					Moves moves = Moves::fromPacked((uint16_t)(packed | Moves::MOVES_PER_TURN << Moves::COUNT_SHIFT));
+					sum += safety->analyze(moves).margin;
+				}
+			}
+			return sum;
+		} };
+		return benchmark;
+	}
+
+	// Scores every sequence of moves for a turn by playing it out in a copy of a game, spread over a TaskPool. Each
+	// worker copies into its own Simulator. Compare the thread counts for the speedup.
+	Benchmark scoreCandidates(const std::string& name, int workers, unsigned seed)
+	{
+		Simulator sim = makeRandomGame(seed, 8, 100, true);
+		auto game = std::make_shared<Simulator>(sim);
+		auto pool = std::make_shared<TaskPool>(workers);
+		auto scratch = std::make_shared<PerWorker<Simulator> >(*pool, sim);
+		const int self = sim.getPlayerIds().front();
+		const int sequences = 1 << (2 * Moves::MOVES_PER_TURN);
+		Benchmark benchmark = { name, sequences, [=](long long count)
+		{
+			long long sum = 0;
+			for (long long i = 0; i < count; i++)
+			{
+				sum += pool->mapReduce(sequences, 0LL, [&](int packed, int worker)
+				{
+					Simulator& copy = (*scratch)[worker];
+					copy = *game;
+					Moves moves = Moves::fromPacked((uint16_t)(packed | Moves::MOVES_PER_TURN << Moves::COUNT_SHIFT));
+					for (size_t turn = 0; turn < moves.size() && copy.isAlive(self); turn++)
+					{
+						copy.setDirection(self, moves[turn]);
+						copy.turn();
+					}
+					return copy.isAlive(self) ? (long long)copy.getPlayer(self).score : 0LL;
+				}, [](long long total, long long score) { return total + score; });
+			}
+			return sum;
+		} };
+		return benchmark;
+	}
+
+	// Adds to and probes a TranspositionTable shared by a TaskPool's workers, with keys from a Simulator's hash as a game
+	// plays out. Most keys come round again, as transpositions do in a search.
+	Benchmark shareTable(const std::string& name, int workers, unsigned seed)
+	{
+		auto keys = std::make_shared<std::vector<uint64_t> >();
+		makeRandomGame(seed, 8, 256, true, [&](Simulator& sim, int)
+		{
+			keys->push_back(sim.getHash());
+		});
+
+		auto pool = std::make_shared<TaskPool>(workers);
+		auto table = std::make_shared<TranspositionTable>();
+		const int operations = 1024;
+		Benchmark benchmark = { name, operations, [=](long long count)
+		{
+			long long sum = 0;
+			for (long long i = 0; i < count; i++)
+			{
+				sum += pool->mapReduce(operations, 0LL, [&](int index, int)
+				{
+					uint64_t key = (*keys)[(index * 7 + i) % keys->size()];
+					TranspositionTable::Entry entry;
+					if (index % 4 == 0)
+					{
+						entry = table->add(key, 0.5f);
+					}
+					else if (!table->probe(key, entry))
+					{
+						return 0LL;
+					}
+					return (long long)entry.visits;
+				}, [](long long total, long long visits) { return total + visits; });
+			}
+			return sum;
+		} };
+		return benchmark;
+	}
+
+	// Copies a view into the world map, as a bot does each turn.
+	Benchmark updateWorld(const std::string& name, const std::string& json)
+	{
+		auto gameInfo = std::make_shared<GameInfo>(parseGameState(json));
+		auto world = std::make_shared<WorldMap>();
+		world->init(gameInfo->boardWidth, gameInfo->boardHeight);
+		const Board& view = gameInfo->partialBoard;
+		Benchmark benchmark = { name, (long long)view.width * view.height, [=](long long count)
+		{
+			long long sum = 0;
+			for (long long i = 0; i < count; i++)
+			{
+				world->update(*gameInfo);
+				sum += world->getTurn();
+			}
+			return sum;
+		} };
+		return benchmark;
+	}
+
+	Benchmark getMoves(const std::string& name, std::shared_ptr<Bot> bot, const std::string& json)
+	{
+		auto gameInfo = std::make_shared<GameInfo>(parseGameState(json));
+		std::shared_ptr<Player> self = gameInfo->players.begin()->second;
+		bot->setPlayer(self);
+		bot->init(gameInfo->boardWidth, gameInfo->boardHeight);
+		Benchmark benchmark = { name, 1, [=](long long count)
+		{
+			long long sum = 0;
+			for (long long i = 0; i < count; i++)
+			{
+				gameInfo->deadline = Clock::now() + std::chrono::milliseconds(480);
+				sum += bot->getMoves(*gameInfo).size();
+			}
+			return sum;
+		} };
+		return benchmark;
+	}
+
+	std::string escape(const std::string& text)
+	{
+		std::string escaped;
+		for (char c : text)
+		{
+			if (c == '"' || c == '\\')
+			{
+				escaped += '\\';
+			}
+			escaped += c;
+		}
+		return escaped;
+	}
+
+	void writeJson(std::ostream& out, const std::vector<Result>& results)
+	{
+		std::time_t now = std::time(nullptr);
+		char date[32];
+		std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+
+		out << "{\n  \"context\": {\n    \"date\": \"" << date << "\",\n";
+#ifdef __VERSION__
+		out << "    \"compiler\": \"" << escape(__VERSION__) << "\",\n";
+#elif defined(_MSC_FULL_VER)
+		out << "    \"compiler\": \"MSVC " << _MSC_FULL_VER << "\",\n";
+#endif
+#ifdef NDEBUG
+		out << "    \"library_build_type\": \"release\"\n";
+#else
+		out << "    \"library_build_type\": \"debug\"\n";
+#endif
+		out << "  },\n  \"benchmarks\": [\n";
+		for (size_t i = 0; i < results.size(); i++)
+		{
+			const Result& result = results[i];
+			out << "    {\"name\": \"" << escape(result.name) << "\", \"run_type\": \"iteration\", \"iterations\": "
+				<< result.iterations << std::fixed << std::setprecision(3) << ", \"real_time\": " << result.nsPerOp
+				<< ", \"cpu_time\": " << result.nsPerOp << ", \"min_time\": " << result.minNsPerOp
+				<< ", \"time_unit\": \"ns\", \"items_per_second\": " << result.itemsPerOp * 1e9 / result.nsPerOp << "}"
+				<< (i + 1 < results.size() ? "," : "") << "\n";
+		}
+		out << "  ]\n}\n";
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::string filter;
+	double minSeconds = 0.5;
+	std::string jsonPath;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string option = argv[i];
+		if (option == "--filter" && i + 1 < argc)
+		{
+			filter = argv[++i];
+		}
+		else if (option == "--min-time" && i + 1 < argc)
+		{
+			minSeconds = std::atof(argv[++i]);
+		}
+		else if (option == "--json" && i + 1 < argc)
+		{
+			jsonPath = argv[++i];
+		}
+		else
+		{
+			std::cout << "Usage: benchmarks [--filter text] [--min-time seconds] [--json file]" << std::endl;
+			return 2;
+		}
+	}
+
+	// The smallest view, a medium one, and the whole board.
+	const std::string small = makeGameState(12, 1);
+	const std::string medium = makeGameState(30, 2);
+	const std::string max = makeGameState(Simulator::DEFAULT_WIDTH, 3);
+
+	std::vector<Benchmark> benchmarks;
+	benchmarks.push_back(decode("decode/small", small, false));
+	benchmarks.push_back(decode("decode/medium", medium, false));
+	benchmarks.push_back(decode("decode/max", max, false));
+	benchmarks.push_back(decode("decode_dom/small", small, true));
+	benchmarks.push_back(decode("decode_dom/medium", medium, true));
+	benchmarks.push_back(decode("decode_dom/max", max, true));
+	benchmarks.push_back(decode("players/rebuild/8", makePlayersState(8), false));
+	benchmarks.push_back(decode("players/rebuild/64", makePlayersState(64), false));
+	benchmarks.push_back(findPlayerById("players/findPlayerById/8", 8));
+	benchmarks.push_back(findPlayerById("players/findPlayerById/64", 64));
+	benchmarks.push_back(scanBoard("board/getOwnerId+getTrailId/max", max));
+	benchmarks.push_back(scanRows("board/getRow/max", max));
+	benchmarks.push_back(territory("territory/board/max", max, false));
+	benchmarks.push_back(territory("territory/bitboards/max", max, true));
+	benchmarks.push_back(dilate("bitboard/dilate/max", max));
+	benchmarks.push_back(updateWorld("world/update/medium", medium));
+	benchmarks.push_back(updateWorld("world/update/max", max));
+	benchmarks.push_back(recomputeDistances("distance/recompute/max", max));
+	benchmarks.push_back(repairDistances("distance/repair/5/max", max, 5));
+	benchmarks.push_back(repairDistances("distance/repair/25/max", max, 25));
+	benchmarks.push_back(updatePlayerDistances("distance/players/max", 4));
+	benchmarks.push_back(findCapture("capture/board/max", max, false));
+	benchmarks.push_back(findCapture("capture/bitboards/max", max, true));
+	benchmarks.push_back(estimateCaptures("capture/estimate/1024", max, false));
+	benchmarks.push_back(estimateCaptures("capture/estimate/update+1024/max", max, true));
+	benchmarks.push_back(analyzeSafety("safety/analyze/1024/max", max, false));
+	benchmarks.push_back(analyzeSafety("safety/analyzeAll/1024/max", max, true));
+	benchmarks.push_back(getMoves("bot/beast/medium", std::make_shared<BeastBot>(), medium));
+	for (int workers = 1; workers == 1 || workers <= (int)std::thread::hardware_concurrency(); workers *= 2)
+	{
+		benchmarks.push_back(scoreCandidates("pool/score/1024/workers:" + std::to_string(workers), workers, 5));
+		benchmarks.push_back(shareTable("table/add+probe/1024/workers:" + std::to_string(workers), workers, 5));
+	}
+
+	// Keep standard out clean when the JSON goes there.
+	std::ostream& table = jsonPath == "-" ? std::cerr : std::cout;
+	table << std::left << std::setw(40) << "benchmark" << std::right << std::setw(14) << "iterations"
+		<< std::setw(14) << "ns/op" << std::setw(14) << "min ns/op" << std::setw(14) << "ns/item" << std::endl;
+
+	std::vector<Result> results;
+	for (const Benchmark& benchmark : benchmarks)
+	{
+		if (benchmark.name.find(filter) == std::string::npos)
+		{
+			continue;
+		}
+
+		Result result = measure(benchmark, minSeconds);
+		results.push_back(result);
+		table << std::left << std::setw(40) << result.name << std::right << std::setw(14) << result.iterations
+			<< std::fixed << std::setprecision(1) << std::setw(14) << result.nsPerOp << std::setw(14) << result.minNsPerOp
+			<< std::setprecision(3) << std::setw(14) << result.nsPerOp / result.itemsPerOp << std::endl;
+	}
+
+	if (jsonPath == "-")
+	{
+		writeJson(std::cout, results);
+	}
+	else if (!jsonPath.empty())
+	{
+		std::ofstream file(jsonPath);
+		if (!file)
+		{
+			std::cout << "Unable to write " << jsonPath << std::endl;
+			return 1;
+		}
+		writeJson(file, results);
+	}
+	return 0;
+}
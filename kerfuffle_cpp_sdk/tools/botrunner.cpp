@@ -0,0 +1,76 @@
+// botrunner plays many bots from one process, for load testing and self-play against the lobby.
+//
+// Usage: botrunner <bots> [persistent] [host] [port] [threads] [report]
+//   bots        How many bots of each type to run, as "<type>:<count>,...", e.g. "beast:50". A plain number runs
+//               that many BeastBots.
+//   persistent  'true' or 'false' (or 1 or 0). Defaults to 'true'.
+//   host        The hostname of the server. Defaults to 10.100.139.2.
+//   port        The port to use. Defaults to 80.
+//   threads     Threads shared by all the bots. Defaults to the number of cores. A bot thinks on one of these
+//               threads, holding up the other bots' I/O and deadlines meanwhile, so slow bots want more threads.
+//   report      Seconds between reports. Defaults to 30.
+//
+// Add your own bot types to the factories below.
+
+#include "BeastBot.h"
+#include "BotRunner.h"
+#include "SearchBot.h"
+
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include <boost/algorithm/string.hpp>
+
+int main(int argc, char** argv)
+{
+	std::map<std::string, BotRunner::BotFactory> factories;
+	factories["beast"] = []() { return new BeastBot(); };
+	factories["search"] = []() { return new SearchBot(); };
+
+	if (argc < 2)
+	{
+		std::cout << "Usage: botrunner <bots> [persistent] [host] [port] [threads] [report]" << std::endl;
+		return 2;
+	}
+
+	// Get the command line parameters.
+	std::string bots = argv[1];
+	std::string persistent = argc > 2 ? argv[2] : "true";
+	const char* host = argc > 3 ? argv[3] : "10.100.139.2";
+	const char* port = argc > 4 ? argv[4] : "80";
+	int threads = argc > 5 ? std::atoi(argv[5]) : (int)std::thread::hardware_concurrency();
+	int report = argc > 6 ? std::atoi(argv[6]) : 30;
+	boost::algorithm::to_lower(persistent);
+	bool isPersistent = persistent == "true" || persistent == "1";
+
+	BotRunner runner(host, port, threads);
+
+	std::stringstream spec(bots);
+	std::string item;
+	while (std::getline(spec, item, ','))
+	{
+		std::string type = "beast";
+		std::string count = item;
+		size_t colon = item.find(':');
+		if (colon != std::string::npos)
+		{
+			type = item.substr(0, colon);
+			count = item.substr(colon + 1);
+		}
+
+		auto factory = factories.find(type);
+		if (factory == factories.end())
+		{
+			std::cout << "Unknown bot type: " << type << std::endl;
+			return 2;
+		}
+		runner.addBots(type, std::atoi(count.c_str()), factory->second, isPersistent);
+	}
+
+	// Let the games begin!
+	runner.run(std::chrono::seconds(report));
+	return 0;
+}
@@ -0,0 +1,223 @@
+// decode_bench compares the two ways GameStateParser reads a game state: the streaming pass GameClient uses (parse())
+// and the DOM (parseDom()). It checks that both give the same GameInfo, then times them.
+//
+// Usage: decode_bench [responses.txt ...]
+//   responses.txt  Game states captured from the server, one response body per line. Each file is timed separately.
+//
+// Without files, it times game states made by the simulator at the smallest view radius, a medium one, and the largest.
+
+#include "GameStateParser.h"
+#include "RandomGame.h"
+#include "Simulator.h"
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	const double MIN_SECONDS = 0.5; // Run each test at least this long.
+
+	struct ResponseSet
+	{
+		std::string name;
+		std::vector<std::string> responses;
+	};
+
+	std::vector<std::string> readResponses(const char* path)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file)
+		{
+			throw std::runtime_error(std::string("Unable to read ") + path);
+		}
+
+		std::vector<std::string> responses;
+		std::string line;
+		while (std::getline(file, line))
+		{
+			if (!line.empty() && line.back() == '\r')
+			{
+				line.pop_back();
+			}
+			if (!line.empty())
+			{
+				responses.push_back(line);
+			}
+		}
+		return responses;
+	}
+
+	// Plays a game with players wandering at random, then gives the first player the given share of the board so
+	// their view has the matching radius. Captures what the server would send them.
+	ResponseSet makeResponses(const char* name, double share, unsigned seed)
+	{
+		Simulator sim = makeRandomGame(seed, 8, 200);
+		int self = sim.getPlayerIds().front();
+		if (share > 0)
+		{
+			int rows = (int)(sim.getHeight() * share + 0.5);
+			for (int y = 0; y < rows; y++)
+			{
+				for (int x = 0; x < sim.getWidth(); x++)
+				{
+					sim.setCell(x, y, self, sim.getCell(x, y).trail);
+				}
+			}
+			sim.recomputeScores();
+		}
+
+		ResponseSet set;
+		set.name = name;
+		set.responses.push_back(std::string());
+		sim.getGameState(self, set.responses.back());
+		return set;
+	}
+
+	bool sameGameInfo(const GameInfo& a, const GameInfo& b)
+	{
+		const PartialBoard& boardA = a.partialBoard;
+		const PartialBoard& boardB = b.partialBoard;
+		if (a.gameOver != b.gameOver || a.boardWidth != b.boardWidth || a.boardHeight != b.boardHeight ||
+			!(boardA.boardOffset == boardB.boardOffset) || boardA.width != boardB.width || boardA.height != boardB.height ||
+			a.players.size() != b.players.size())
+		{
+			return false;
+		}
+
+		for (int y = 0; y < boardA.height; y++)
+		{
+			for (int x = 0; x < boardA.width; x++)
+			{
+				if (boardA.getOwnerId(x, y) != boardB.getOwnerId(x, y) || boardA.getTrailId(x, y) != boardB.getTrailId(x, y))
+				{
+					return false;
+				}
+			}
+		}
+
+		for (auto& entry : a.players)
+		{
+			auto it = b.players.find(entry.first);
+			if (it == b.players.end())
+			{
+				return false;
+			}
+			const Player& p = *entry.second;
+			const Player& q = *it->second;
+			if (p.id != q.id || p.name != q.name || p.score != q.score || !(p.pos == q.pos) || p.dir.x != q.dir.x || p.dir.y != q.dir.y)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Returns the average time to copy a response into a work buffer and, if parser is set, parse it.
+	double timeParse(const std::vector<std::string>& responses, GameStateParser* parser, bool useDom)
+	{
+		GameInfo gameInfo;
+		std::string work;
+		long long count = 0;
+		Clock::time_point start = Clock::now();
+		double seconds = 0;
+		do
+		{
+			for (const std::string& response : responses)
+			{
+				// The parse is in place, so it needs a fresh copy each time, like a fresh response from the server.
+				work.assign(response);
+				if (parser != nullptr)
+				{
+					if (useDom)
+					{
+						parser->parseDom(&work[0], gameInfo);
+					}
+					else
+					{
+						parser->parse(&work[0], gameInfo);
+					}
+				}
+				count++;
+			}
+			seconds = std::chrono::duration<double>(Clock::now() - start).count();
+		} while (seconds < MIN_SECONDS);
+
+		return seconds * 1e9 / count;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<ResponseSet> sets;
+	try
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			ResponseSet set;
+			set.name = argv[i];
+			set.responses = readResponses(argv[i]);
+			sets.push_back(set);
+		}
+	}
+	catch (std::exception& e)
+	{
+		std::cout << e.what() << std::endl;
+		return 2;
+	}
+
+	if (sets.empty())
+	{
+		sets.push_back(makeResponses("small", 0, 1));
+		sets.push_back(makeResponses("medium", 0.15, 2));
+		sets.push_back(makeResponses("max", 1, 3));
+	}
+
+	std::cout << std::left << std::setw(24) << "responses" << std::right << std::setw(8) << "count" << std::setw(10) << "bytes"
+		<< std::setw(10) << "view" << std::setw(12) << "copy ns" << std::setw(12) << "dom ns" << std::setw(12) << "stream ns"
+		<< std::setw(10) << "speedup" << std::endl;
+
+	GameStateParser parser;
+	for (const ResponseSet& set : sets)
+	{
+		if (set.responses.empty())
+		{
+			continue;
+		}
+
+		// Both ways of parsing must agree before their times mean anything.
+		size_t bytes = 0;
+		GameInfo viaDom;
+		GameInfo viaStream;
+		for (const std::string& response : set.responses)
+		{
+			std::string a = response;
+			std::string b = response;
+			bool domOk = parser.parseDom(&a[0], viaDom);
+			bool streamOk = parser.parse(&b[0], viaStream);
+			if (domOk != streamOk || (domOk && !sameGameInfo(viaDom, viaStream)))
+			{
+				std::cout << set.name << ": the two parsers disagree on " << response.substr(0, 80) << "..." << std::endl;
+				return 1;
+			}
+			bytes += response.size();
+		}
+
+		double copy = timeParse(set.responses, nullptr, false);
+		double dom = timeParse(set.responses, &parser, true);
+		double stream = timeParse(set.responses, &parser, false);
+
+		std::string view = std::to_string(viaStream.partialBoard.width) + "x" + std::to_string(viaStream.partialBoard.height);
+		std::cout << std::left << std::setw(24) << set.name << std::right << std::setw(8) << set.responses.size()
+			<< std::setw(10) << bytes / set.responses.size() << std::setw(10) << view << std::fixed << std::setprecision(0)
+			<< std::setw(12) << copy << std::setw(12) << dom << std::setw(12) << stream << std::setprecision(2)
+			<< std::setw(9) << (dom - copy) / std::max(stream - copy, 1.0) << "x" << std::endl;
+	}
+
+	return 0;
+}
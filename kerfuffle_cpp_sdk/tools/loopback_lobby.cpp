@@ -0,0 +1,144 @@
+// loopback_lobby serves games on localhost so GameClient, main.cpp, and botrunner can be run and measured without the
+// Node lobby. Point them at host 127.0.0.1 and this port.
+//
+// Usage: loopback_lobby [options]
+//   --port <n>          Port to listen on. Defaults to 8080.
+//   --players <n>       Open games start when this many players have joined. Defaults to 2.
+//   --start-wait <ms>   Or once this much time has passed with at least two. Defaults to 5000.
+//   --min-wait <ms>     The least time between batches of moves. Defaults to 40, like the server.
+//   --max-wait <ms>     The most time to wait for everyone's moves. Defaults to 500, like the server.
+//   --game-length <s>   Games shut down after this long. Defaults to 120, like the server.
+//   --size <w>x<h>      The board size. Defaults to 162x108.
+//   --view <n>          The view radius around each player. Defaults to the server's formula (12 and up).
+//   --canned <file>     Game states to send instead of the simulated ones, one response body per line, sent round
+//                       robin. The game is still simulated to decide when players die and the game ends.
+//   --seed <n>          Seeds the simulator and tokens. Defaults to 0.
+//   --quiet             Only report errors.
+//
+// Use --min-wait 0 to run batches as fast as the clients can send moves.
+
+#include "LoopbackLobby.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+	std::vector<std::string> readStates(const char* path)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file)
+		{
+			throw std::runtime_error(std::string("Unable to read ") + path);
+		}
+
+		std::vector<std::string> states;
+		std::string line;
+		while (std::getline(file, line))
+		{
+			if (!line.empty() && line.back() == '\r')
+			{
+				line.pop_back();
+			}
+			if (!line.empty())
+			{
+				states.push_back(line);
+			}
+		}
+		return states;
+	}
+
+	int usage()
+	{
+		std::cout << "Usage: loopback_lobby [--port n] [--players n] [--start-wait ms] [--min-wait ms] [--max-wait ms] "
+			"[--game-length s] [--size WxH] [--view n] [--canned file] [--seed n] [--quiet]" << std::endl;
+		return 2;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	LoopbackLobby::Options options;
+	try
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			std::string option = argv[i];
+			if (option == "--quiet")
+			{
+				options.quiet = true;
+				continue;
+			}
+			if (i + 1 >= argc)
+			{
+				return usage();
+			}
+
+			const char* value = argv[++i];
+			if (option == "--port")
+			{
+				options.port = (unsigned short)std::atoi(value);
+			}
+			else if (option == "--players")
+			{
+				options.playersPerGame = std::atoi(value);
+			}
+			else if (option == "--start-wait")
+			{
+				options.startWait = std::chrono::milliseconds(std::atoi(value));
+			}
+			else if (option == "--min-wait")
+			{
+				options.minTurnWait = std::chrono::milliseconds(std::atoi(value));
+			}
+			else if (option == "--max-wait")
+			{
+				options.maxTurnWait = std::chrono::milliseconds(std::atoi(value));
+			}
+			else if (option == "--game-length")
+			{
+				options.gameLength = std::chrono::seconds(std::atoi(value));
+			}
+			else if (option == "--size")
+			{
+				if (std::sscanf(value, "%dx%d", &options.width, &options.height) != 2)
+				{
+					return usage();
+				}
+			}
+			else if (option == "--view")
+			{
+				options.viewRadius = std::atoi(value);
+			}
+			else if (option == "--canned")
+			{
+				options.cannedStates = readStates(value);
+			}
+			else if (option == "--seed")
+			{
+				options.seed = (unsigned)std::atoi(value);
+			}
+			else
+			{
+				return usage();
+			}
+		}
+
+		boost::asio::io_context ioc;
+		LoopbackLobby lobby(ioc, options);
+		lobby.start();
+		ioc.run();
+	}
+	catch (std::exception& e)
+	{
+		std::cout << "Error: " << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,230 @@
+// replay plays a bot through games recorded by GameClient (see GameClient::recordTo(), or beastbot's record parameter)
+// as fast as it can, without a server. It reports how long getMoves() took each turn and whether the bot chose the
+// same moves it sent when the game was recorded, which makes it handy for profiling and for checking that a change
+// didn't alter the bot's play.
+//
+// Usage: replay <recording> [bot] [--summary] [--repeat n] [--turn-time ms]
+//   recording    A file written by GameClient::recordTo().
+//   bot          The type of bot to replay, from the factories below. Defaults to beast.
+//   --summary    Only print the totals, not every turn.
+//   --repeat     Replay the whole recording n times. Useful for profiling.
+//   --turn-time  The deadline each getMoves() gets, in milliseconds. Defaults to 480, about what a bot gets live: the
+//                server's longest wait less GameClient's margin.
+//
+// Moves sent when the bot was late (with playAsync()) are empty, so those turns always differ. Bots that think until
+// the deadline, like SearchBot, replay at live pace rather than as fast as they can; shorten --turn-time to speed them
+// up, though they'll likely choose differently than they did live.
+
+#include "BeastBot.h"
+#include "GameRecorder.h"
+#include "GameStateParser.h"
+#include "LatencyHistogram.h"
+#include "SearchBot.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+	typedef std::function<Bot*()> BotFactory;
+
+	const int DEFAULT_TURN_TIME = 480;
+	std::string toString(const Moves& moves)
+	{
+		std::string text;
+		for (const Direction& dir : moves)
+		{
+			text += dir.x == 1 ? 'R' : dir.x == -1 ? 'L' : dir.y == 1 ? 'D' : dir.y == -1 ? 'U' : '?';
+		}
+		return text.empty() ? "-" : text;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::map<std::string, BotFactory> factories;
+	factories["beast"] = []() { return new BeastBot(); };
+	factories["search"] = []() { return new SearchBot(); };
+
+	if (argc < 2)
+	{
+		std::cout << "Usage: replay <recording> [bot] [--summary] [--repeat n] [--turn-time ms]" << std::endl;
+		return 2;
+	}
+
+	std::string type = "beast";
+	bool summary = false;
+	int repeat = 1;
+	std::chrono::milliseconds turnTime(DEFAULT_TURN_TIME);
+	for (int i = 2; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--summary") == 0)
+		{
+			summary = true;
+		}
+		else if (std::strcmp(argv[i], "--repeat") == 0 && i + 1 < argc)
+		{
+			repeat = std::max(std::atoi(argv[++i]), 1);
+		}
+		else if (std::strcmp(argv[i], "--turn-time") == 0 && i + 1 < argc)
+		{
+			turnTime = std::chrono::milliseconds(std::max(std::atoi(argv[++i]), 1));
+		}
+		else
+		{
+			type = argv[i];
+		}
+	}
+
+	auto factory = factories.find(type);
+	if (factory == factories.end())
+	{
+		std::cout << "Unknown bot type: " << type << std::endl;
+		return 2;
+	}
+
+	GameRecording recording;
+	try
+	{
+		recording.open(argv[1]);
+	}
+	catch (std::exception& e)
+	{
+		std::cout << e.what() << std::endl;
+		return 1;
+	}
+
+	std::unique_ptr<Bot> bot(factory->second());
+	GameStateParser parser;
+	GameInfo gameInfo;
+	std::string json;
+	std::string botName;
+	std::string gameName;
+	Moves botMoves;
+	Moves recordedMoves;
+	LatencyHistogram decisions;
+	int games = 0;
+	int turns = 0;
+	int differences = 0;
+
+	if (!summary)
+	{
+		std::cout << std::left << std::setw(24) << "game" << std::right << std::setw(6) << "turn" << std::setw(12) << "ms"
+			<< std::setw(8) << "bot" << std::setw(10) << "recorded" << std::endl;
+	}
+
+	int turn = 0;
+	Clock::duration decisionTime;
+
+	// Each turn is reported when the recorded moves show up, or when they turn out to be missing.
+	auto report = [&](const Moves* recorded)
+	{
+		bool same = recorded && botMoves == *recorded;
+		differences += same ? 0 : 1;
+		if (!summary)
+		{
+			std::cout << std::left << std::setw(24) << gameName << std::right << std::setw(6) << turn
+				<< std::fixed << std::setprecision(3) << std::setw(12) << std::chrono::duration<double, std::milli>(decisionTime).count()
+				<< std::setw(8) << toString(botMoves) << std::setw(10) << (recorded ? toString(*recorded) : "?")
+				<< (same ? "" : "  differs") << std::endl;
+		}
+	};
+
+	Clock::time_point start = Clock::now();
+	for (int pass = 0; pass < repeat; pass++)
+	{
+		recording.rewind();
+		GameRecording::Record record;
+		bool starting = false;
+		bool waitingForMoves = false; // The bot has moved and the recorded moves are next.
+
+		while (recording.next(record))
+		{
+			if (waitingForMoves && record.type != RECORD_MOVES)
+			{
+				report(nullptr);
+				waitingForMoves = false;
+			}
+
+			switch (record.type)
+			{
+			case RECORD_GAME:
+			{
+				const char* separator = (const char*)std::memchr(record.data, '\0', record.size);
+				size_t nameSize = separator ? separator - record.data : record.size;
+				botName.assign(record.data, nameSize);
+				gameName = separator ? std::string(separator + 1, record.data + record.size) : std::string();
+				gameInfo.reset();
+				starting = true;
+				turn = 0;
+				games++;
+				break;
+			}
+
+			case RECORD_STATE:
+			{
+				// The parser works in place, and the recording is read only, so parse a copy.
+				json.assign(record.data, record.size);
+				if (!parser.parse(&json[0], gameInfo))
+				{
+					break;
+				}
+
+				if (starting)
+				{
+					bot->setPlayer(gameInfo.players[botName]);
+					bot->init(gameInfo.boardWidth, gameInfo.boardHeight);
+					starting = false;
+				}
+				if (gameInfo.gameOver)
+				{
+					break;
+				}
+
+				turn++;
+				turns++;
+				Clock::time_point before = Clock::now();
+				gameInfo.deadline = before + turnTime;
+				botMoves = bot->getMoves(gameInfo);
+				decisionTime = Clock::now() - before;
+				decisions.record(decisionTime);
+				waitingForMoves = true;
+				break;
+			}
+
+			case RECORD_MOVES:
+				if (waitingForMoves)
+				{
+					GameRecording::getMoves(record, recordedMoves);
+					report(&recordedMoves);
+					waitingForMoves = false;
+				}
+				break;
+
+			default:
+				break;
+			}
+		}
+
+		if (waitingForMoves)
+		{
+			report(nullptr);
+		}
+	}
+	std::chrono::duration<double> elapsed = Clock::now() - start;
+
+	std::cout << std::endl << games << " games, " << turns << " turns in " << std::fixed << std::setprecision(3)
+		<< elapsed.count() << " s, " << differences << " turns differ from the recording" << std::endl;
+	std::cout << "getMoves ms: mean " << decisions.getMean().count() / 1e6 << ", p50 " << decisions.getPercentile(50).count() / 1e6
+		<< ", p99 " << decisions.getPercentile(99).count() / 1e6 << ", max " << decisions.getMax().count() / 1e6 << std::endl;
+	return differences == 0 ? 0 : 1;
+}
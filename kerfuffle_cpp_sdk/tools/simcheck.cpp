@@ -0,0 +1,597 @@
+// simcheck replays a game recorded by the lobby through Simulator and reports the first turn where they disagree.
+//
+// Usage: simcheck <game.log> <game.moves.json>
+//   game.log         The lobby's game-<name>.log.gz, uncompressed (e.g., with 'gunzip -k'). A JSON array of the
+//                    status strings sent to the visualization, one per turn.
+//   game.moves.json  The lobby's game-<name>.moves.json. The moves each player made, one per turn.
+//
+// The game should not be persistent: every player must be present from the first turn so moves line up with turns.
+//
+// Usage: simcheck --captures [games] [seed]
+//   Checks CaptureFinder against Simulator instead: plays random games on boards of random sizes and, each time a
+//   player heads home, compares what CaptureFinder predicted with what Simulator captured, space by space. Defaults
+//   to 1000 games from seed 1. Run it after changing either one.
+//
+// Usage: simcheck --estimates [games] [seed]
+//   Checks CaptureEstimator against CaptureFinder: in the same random games, follows every plan for a batch from the
+//   wanderer's trail, and checks the estimate never captures more than CaptureFinder finds, and matches it exactly on
+//   loops that only touch the territory at their ends. Defaults to 100 games from seed 1. Run it after changing either.
+
+#include "CaptureFinder.h"
+#include "Simulator.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "rapidjson/document.h"
+
+namespace
+{
+	struct RecordedPlayer
+	{
+		int id;
+		std::string name;
+		int score;
+		Position pos;
+		Direction dir;
+		bool missedBatch; // lastPlayed is null when the player didn't send moves in time.
+	};
+
+	struct RecordedTurn
+	{
+		bool over;
+		int width;
+		int height;
+		std::vector<int> ownerIDs; // Server player IDs; 0 means no player.
+		std::vector<int> trailIDs;
+		std::vector<RecordedPlayer> players;
+	};
+
+	std::string readFile(const char* path)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file)
+		{
+			throw std::runtime_error(std::string("Unable to read ") + path);
+		}
+		std::ostringstream contents;
+		contents << file.rdbuf();
+		return contents.str();
+	}
+
+	int parseId(const char*& s, char end)
+	{
+		int id = 0;
+		for (; *s != end && *s != 0; s++)
+		{
+			id = id * 10 + *s - '0';
+		}
+		return id;
+	}
+
+	// Parses a statusString() from the server. The board is run length encoded as "<count>;<owner>,<trail>!...".
+	RecordedTurn parseTurn(const char* json)
+	{
+		rapidjson::Document doc;
+		doc.Parse(json);
+
+		RecordedTurn turn;
+		turn.over = doc.HasMember("over") && doc["over"].GetBool();
+		turn.width = doc["width"].GetInt();
+		turn.height = doc["height"].GetInt();
+
+		const char* board = doc["board"].GetString();
+		while (*board)
+		{
+			int count = parseId(board, ';');
+			board++;
+			int owner = parseId(board, ',');
+			board++;
+			int trail = parseId(board, '!');
+			if (*board == '!')
+			{
+				board++;
+			}
+			turn.ownerIDs.insert(turn.ownerIDs.end(), count, owner);
+			turn.trailIDs.insert(turn.trailIDs.end(), count, trail);
+		}
+
+		for (const auto& playerObj : doc["players"].GetArray())
+		{
+			RecordedPlayer player;
+			player.id = playerObj["id"].GetInt();
+			player.name = playerObj["name"].GetString();
+			player.score = playerObj["score"].GetInt();
+			player.pos.set(playerObj["pos"]["x"].GetInt(), playerObj["pos"]["y"].GetInt());
+			player.dir.set(playerObj["dir"]["x"].GetInt(), playerObj["dir"]["y"].GetInt());
+			player.missedBatch = !playerObj.HasMember("lastPlayed") || playerObj["lastPlayed"].IsNull();
+			turn.players.push_back(player);
+		}
+
+		return turn;
+	}
+
+	int checkRecording(const char* historyPath, const char* movesPath)
+	{
+		std::string historyJson = readFile(historyPath);
+		std::string movesJson = readFile(movesPath);
+
+		rapidjson::Document history;
+		history.Parse(historyJson.c_str());
+		rapidjson::Document moves;
+		moves.Parse(movesJson.c_str());
+		if (!history.IsArray() || history.Size() == 0 || !moves.IsObject())
+		{
+			std::cout << "Unable to parse the recorded game." << std::endl;
+			return 2;
+		}
+
+		// Load the state after the first turn. The server numbers players across games, so map its IDs to ours.
+		RecordedTurn first = parseTurn(history[0].GetString());
+		Simulator sim(first.width, first.height, false);
+		std::map<int, int> simIds;
+		std::vector<int> serverIds(Simulator::MAX_PLAYERS + 1, 0);
+		for (const RecordedPlayer& player : first.players)
+		{
+			int id = sim.restorePlayer(player.name, player.pos, player.dir);
+			simIds[player.id] = id;
+			serverIds[id] = player.id;
+		}
+
+		for (int y = 0; y < first.height; y++)
+		{
+			for (int x = 0; x < first.width; x++)
+			{
+				int index = y * first.width + x;
+				sim.setCell(x, y, first.ownerIDs[index] ? simIds[first.ownerIDs[index]] : 0,
+					first.trailIDs[index] ? simIds[first.trailIDs[index]] : 0);
+			}
+		}
+		sim.recomputeScores();
+
+		std::map<std::string, int> missedStreaks;
+		RecordedTurn previous = first;
+		for (rapidjson::SizeType turnIndex = 1; turnIndex < history.Size(); turnIndex++)
+		{
+			// The server counts missed batches between batches of moves.
+			if (turnIndex % Moves::MOVES_PER_TURN == 0)
+			{
+				for (const RecordedPlayer& player : previous.players)
+				{
+					int& streak = missedStreaks[player.name];
+					streak = player.missedBatch ? streak + 1 : 0;
+					sim.setMovesMissed(simIds[player.id], streak);
+				}
+			}
+
+			for (int id : sim.getPlayerIds())
+			{
+				const SimPlayer& player = sim.getPlayer(id);
+				if (moves.HasMember(player.name.c_str()))
+				{
+					const rapidjson::Value& playerMoves = moves[player.name.c_str()];
+					if (turnIndex < playerMoves.Size() && playerMoves[turnIndex].IsObject())
+					{
+						const rapidjson::Value& move = playerMoves[turnIndex];
+						sim.setDirection(id, Direction(move["x"].GetInt(), move["y"].GetInt()));
+					}
+				}
+			}
+
+			sim.turn();
+
+			// Compare the simulator with the recording.
+			RecordedTurn recorded = parseTurn(history[turnIndex].GetString());
+			std::ostringstream error;
+			if (recorded.over != sim.isOver())
+			{
+				error << "game over is " << sim.isOver() << ", expected " << recorded.over;
+			}
+			else if ((int)recorded.players.size() != sim.getPlayerCount())
+			{
+				error << sim.getPlayerCount() << " players, expected " << recorded.players.size();
+			}
+
+			for (const RecordedPlayer& player : recorded.players)
+			{
+				if (!error.str().empty())
+				{
+					break;
+				}
+
+				int id = simIds.count(player.id) ? simIds[player.id] : 0;
+				const SimPlayer& simPlayer = sim.getPlayer(id);
+				if (!sim.isAlive(id))
+				{
+					error << "player " << player.name << " is dead";
+				}
+				else if (!(simPlayer.pos == player.pos) || simPlayer.score != player.score)
+				{
+					error << "player " << player.name << " at " << simPlayer.pos.x << "," << simPlayer.pos.y << " with score "
+						<< simPlayer.score << ", expected " << player.pos.x << "," << player.pos.y << " with score " << player.score;
+				}
+			}
+
+			for (int y = 0; y < sim.getHeight() && error.str().empty(); y++)
+			{
+				for (int x = 0; x < sim.getWidth(); x++)
+				{
+					int index = y * sim.getWidth() + x;
+					const SimCell& cell = sim.getCell(x, y);
+					if (serverIds[cell.owner] != recorded.ownerIDs[index] || serverIds[cell.trail] != recorded.trailIDs[index])
+					{
+						error << "space " << x << "," << y << " is " << serverIds[cell.owner] << "," << serverIds[cell.trail]
+							<< ", expected " << recorded.ownerIDs[index] << "," << recorded.trailIDs[index];
+						break;
+					}
+				}
+			}
+
+			if (!error.str().empty())
+			{
+				std::cout << "Mismatch after turn " << turnIndex << ": " << error.str() << std::endl;
+				return 1;
+			}
+
+			previous = recorded;
+		}
+
+		std::cout << "Simulator matches all " << history.Size() << " recorded turns." << std::endl;
+		return 0;
+	}
+
+	// Where a wandering player goes next: usually straight on, sometimes turning, never off the board.
+	int pickDirection(const Simulator& sim, const Position& pos, int dir, std::mt19937& random)
+	{
+		if (random() % 4 == 0)
+		{
+			dir = (dir + (random() % 2 ? 1 : 3)) % 4;
+		}
+		for (int turns = 0; turns < 4; turns++)
+		{
+			int x = pos.x + DIRECTION_X[dir];
+			int y = pos.y + DIRECTION_Y[dir];
+			if (x >= 0 && y >= 0 && x < sim.getWidth() && y < sim.getHeight())
+			{
+				break;
+			}
+			dir = (dir + 1) % 4;
+		}
+		return dir;
+	}
+
+	// Adds a player to wander the board, its home in the middle and some islands of its territory about, and a few others
+	// with trails lying about, returned with the homes they pace around. Returns the wanderer's ID.
+	int addPlayers(Simulator& sim, std::mt19937& random, std::vector<std::pair<int, Position> >& homes)
+	{
+		const int width = sim.getWidth();
+		const int height = sim.getHeight();
+		sim.setViewRadius(std::max(width, height));
+		int self = sim.addPlayer("self", width / 2, height / 2);
+
+		homes.clear();
+		for (int i = 0; i < 3; i++)
+		{
+			Position home(3 + random() % (width - 6), 3 + random() % (height - 6));
+			if (std::abs(home.x - width / 2) < 6 && std::abs(home.y - height / 2) < 6)
+			{
+				continue;
+			}
+			int id = sim.addPlayer("other" + std::to_string(i), home.x, home.y);
+			homes.push_back(std::make_pair(id, home));
+			for (int j = 0; j < 10; j++)
+			{
+				int x = random() % width;
+				int y = random() % height;
+				if (sim.getCell(x, y).owner == 0 && sim.getCell(x, y).trail == 0)
+				{
+					sim.setCell(x, y, 0, id);
+				}
+			}
+		}
+
+		// Some islands of the wanderer's territory, so captures can enclose more than one area.
+		for (int i = 0; i < 3; i++)
+		{
+			int left = random() % (width - 3);
+			int top = random() % (height - 3);
+			int islandWidth = 2 + random() % 3;
+			int islandHeight = 2 + random() % 3;
+			for (int y = top; y < std::min(top + islandHeight, height); y++)
+			{
+				for (int x = left; x < std::min(left + islandWidth, width); x++)
+				{
+					if (sim.getCell(x, y).owner == 0 && sim.getCell(x, y).trail == 0)
+					{
+						sim.setCell(x, y, self, 0);
+					}
+				}
+			}
+		}
+		sim.recomputeScores();
+		return self;
+	}
+
+	// Sends the others from addPlayers() back toward their homes.
+	void steerHomes(Simulator& sim, const std::vector<std::pair<int, Position> >& homes)
+	{
+		for (const auto& home : homes)
+		{
+			if (sim.isAlive(home.first))
+			{
+				const Position& pos = sim.getPlayer(home.first).pos;
+				const Position& to = home.second;
+				sim.setDirection(home.first, pos.x != to.x ? (pos.x < to.x ? Direction::Right : Direction::Left)
+					: pos.y <= to.y ? Direction::Down : Direction::Up);
+			}
+		}
+	}
+
+	// Plays games with one player wandering at random among a few who pace around their homes with trails lying about,
+	// and each time the wanderer steps home, checks the spaces Simulator captured against CaptureFinder's prediction.
+	int checkCaptures(int games, unsigned seed)
+	{
+		const Direction directions[] = { Direction::Up, Direction::Right, Direction::Down, Direction::Left };
+		CaptureFinder finder;
+		BitBoard captured;
+		GameInfo gameInfo;
+		std::vector<std::pair<int, Position> > homes;
+		int captures = 0;
+		int overLimit = 0;
+		long long spaces = 0;
+		int mismatches = 0;
+
+		for (int game = 0; game < games; game++)
+		{
+			std::mt19937 random(seed + game);
+			const int width = 40 + random() % 130;
+			const int height = 30 + random() % 80;
+			Simulator sim(width, height, true, seed + game);
+			int self = addPlayers(sim, random, homes);
+
+			int dir = random() % 4;
+			for (int turn = 0; turn < 600 && sim.isAlive(self); turn++)
+			{
+				const SimPlayer& player = sim.getPlayer(self);
+				dir = pickDirection(sim, player.pos, dir, random);
+				sim.setDirection(self, directions[dir]);
+				steerHomes(sim, homes);
+
+				// Stepping home from a trail captures.
+				Position next(player.pos.x + DIRECTION_X[dir], player.pos.y + DIRECTION_Y[dir]);
+				bool capturing = sim.getCell(player.pos.x, player.pos.y).trail == self &&
+					sim.getCell(next.x, next.y).owner == self && sim.getCell(next.x, next.y).trail != self;
+				bool allowed = false;
+				std::vector<SimCell> before;
+				if (capturing)
+				{
+					sim.getGameInfo(self, gameInfo);
+					allowed = finder.find(gameInfo.partialBoard, gameInfo.players["self"]->id, next, captured);
+					before = sim.getCells();
+				}
+
+				sim.turn();
+				if (!capturing || !sim.isAlive(self))
+				{
+					continue;
+				}
+
+				captures++;
+				overLimit += allowed ? 0 : 1;
+				for (int y = 0; y < height; y++)
+				{
+					for (int x = 0; x < width; x++)
+					{
+						int index = sim.getIndex(x, y);
+						bool taken = sim.getCell(x, y).owner == self && before[index].owner != self;
+						bool predicted = allowed && captured.isSet(x, y);
+						spaces += taken ? 1 : 0;
+						if (taken != predicted)
+						{
+							if (mismatches < 10)
+							{
+								std::cout << "Seed " << seed + game << ", turn " << turn << ": space " << x << "," << y
+									<< (taken ? " was captured but not predicted" : " was predicted but not captured")
+									<< std::endl;
+							}
+							mismatches++;
+						}
+					}
+				}
+			}
+		}
+
+		std::cout << "Checked " << captures << " captures (" << overLimit << " over the server's limit), " << spaces
+			<< " spaces captured, " << mismatches << " spaces mismatched." << std::endl;
+		return mismatches == 0 ? 0 : 1;
+	}
+
+	// Plays the same games as checkCaptures(), and at the start of each batch the wanderer spends off its territory,
+	// follows every plan of a whole batch's moves from its trail: each one that gets home must get the same number of
+	// moves from CaptureEstimator, and never more spaces than CaptureFinder finds for the same loop. Loops that only
+	// touch the territory at their ends and don't touch themselves must get exactly CaptureFinder's count.
+	int checkEstimates(int games, unsigned seed)
+	{
+		const Direction directions[] = { Direction::Up, Direction::Right, Direction::Down, Direction::Left };
+		CaptureFinder finder;
+		CaptureEstimator estimator;
+		BitBoard captured;
+		BitBoard owned;
+		BitBoard trailSpaces;
+		std::vector<std::pair<int, Position> > homes;
+		std::vector<Position> trail;
+		std::vector<Position> loop;
+		long long paths = 0;
+		long long homePaths = 0;
+		long long simplePaths = 0;
+		long long exact = 0;
+		int mismatches = 0;
+
+		for (int game = 0; game < games; game++)
+		{
+			std::mt19937 random(seed + game);
+			const int width = 40 + random() % 130;
+			const int height = 30 + random() % 80;
+			Simulator sim(width, height, true, seed + game);
+			int self = addPlayers(sim, random, homes);
+			trail.clear();
+
+			int dir = random() % 4;
+			for (int turn = 0; turn < 600 && sim.isAlive(self); turn++)
+			{
+				const SimPlayer& player = sim.getPlayer(self);
+				owned.resize(width, height);
+				for (int y = 0; y < height; y++)
+				{
+					for (int x = 0; x < width; x++)
+					{
+						if (sim.getCell(x, y).owner == self)
+						{
+							owned.set(x, y);
+						}
+					}
+				}
+
+				// The trail starts from the last space the wanderer owned. Others can take that space, which ends the check
+				// until the wanderer gets home again.
+				if (owned.isSet(player.pos))
+				{
+					trail.assign(1, player.pos);
+				}
+				else if (!trail.empty())
+				{
+					trail.push_back(player.pos);
+				}
+
+				if (turn % Moves::MOVES_PER_TURN == 0 && trail.size() > 1 && owned.isSet(trail.front()))
+				{
+					estimator.update(owned, trail);
+					for (int plan = 0; plan < 1 << (2 * Moves::MOVES_PER_TURN); plan++)
+					{
+						Moves moves = Moves::fromPacked((uint16_t)(Moves::MOVES_PER_TURN << Moves::COUNT_SHIFT | plan));
+						CaptureGain gain = estimator.estimate(moves);
+						paths++;
+
+						// Follow the plan until it gets home, leaves the board or crosses the trail.
+						trailSpaces.resize(width, height);
+						for (size_t i = 1; i < trail.size(); i++)
+						{
+							trailSpaces.set(trail[i]);
+						}
+						loop = trail;
+						Position pos = player.pos;
+						int homeMoves = 0;
+						for (int i = 0; i < (int)moves.size(); i++)
+						{
+							pos.set(pos.x + moves[i].x, pos.y + moves[i].y);
+							if (pos.x < 0 || pos.y < 0 || pos.x >= width || pos.y >= height || trailSpaces.isSet(pos))
+							{
+								break;
+							}
+							loop.push_back(pos);
+							if (owned.isSet(pos))
+							{
+								homeMoves = i + 1;
+								break;
+							}
+							trailSpaces.set(pos);
+						}
+
+						std::ostringstream error;
+						if (gain.moves != homeMoves)
+						{
+							error << "gets home in " << gain.moves << " moves, expected " << homeMoves;
+						}
+						else if (homeMoves > 0)
+						{
+							homePaths++;
+							finder.find(owned, trailSpaces, pos, captured);
+							int count = captured.count();
+
+							// Simple: each space between the loop's ends touches only the spaces before and after it.
+							bool simple = true;
+							for (size_t i = 1; i + 1 < loop.size() && simple; i++)
+							{
+								for (int code = 0; code < 4; code++)
+								{
+									Position next(loop[i].x + DIRECTION_X[code], loop[i].y + DIRECTION_Y[code]);
+									if (next.x >= 0 && next.y >= 0 && next.x < width && next.y < height &&
+										!(next == loop[i - 1]) && !(next == loop[i + 1]) &&
+										(owned.isSet(next) || trailSpaces.isSet(next)))
+									{
+										simple = false;
+										break;
+									}
+								}
+							}
+							simplePaths += simple ? 1 : 0;
+							exact += gain.captured == count ? 1 : 0;
+
+							if (gain.captured > count)
+							{
+								error << "captures " << gain.captured << ", more than CaptureFinder's " << count;
+							}
+							else if (simple && gain.captured != count)
+							{
+								error << "captures " << gain.captured << " on a simple loop, expected " << count;
+							}
+						}
+
+						if (!error.str().empty())
+						{
+							if (mismatches < 10)
+							{
+								std::cout << "Seed " << seed + game << ", turn " << turn << ", plan " << plan << ": "
+									<< error.str() << std::endl;
+							}
+							mismatches++;
+						}
+					}
+				}
+
+				dir = pickDirection(sim, player.pos, dir, random);
+				sim.setDirection(self, directions[dir]);
+				steerHomes(sim, homes);
+				sim.turn();
+			}
+		}
+
+		std::cout << "Checked " << paths << " plans, " << homePaths << " getting home (" << simplePaths
+			<< " on simple loops), " << exact << " estimated exactly, " << mismatches << " mismatched." << std::endl;
+		return mismatches == 0 ? 0 : 1;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc >= 2 && std::strcmp(argv[1], "--captures") == 0)
+	{
+		int games = argc >= 3 ? std::atoi(argv[2]) : 1000;
+		unsigned seed = argc >= 4 ? (unsigned)std::strtoul(argv[3], nullptr, 10) : 1;
+		return checkCaptures(games, seed);
+	}
+	if (argc >= 2 && std::strcmp(argv[1], "--estimates") == 0)
+	{
+		int games = argc >= 3 ? std::atoi(argv[2]) : 100;
+		unsigned seed = argc >= 4 ? (unsigned)std::strtoul(argv[3], nullptr, 10) : 1;
+		return checkEstimates(games, seed);
+	}
+
+	if (argc < 3)
+	{
+		std::cout << "Usage: simcheck <game.log> <game.moves.json>" << std::endl;
+		std::cout << "       simcheck --captures [games] [seed]" << std::endl;
+		std::cout << "       simcheck --estimates [games] [seed]" << std::endl;
+		return 2;
+	}
+	return checkRecording(argv[1], argv[2]);
+}